@@ -4,8 +4,6 @@
 #
 #-------------------------------------------------
 
-QT       += network sql concurrent
-
 QT       -= gui
 
 TARGET = UnityCloudDownloader-Core
@@ -33,57 +31,7 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++14
 
-INCLUDEPATH += includes
-
-SOURCES += \
-    src/profile.cpp \
-    src/buildtarget.cpp \
-    src/project.cpp \
-    src/unityclouddownloadercore.cpp \
-    src/profiledao.cpp \
-    src/database.cpp \
-    src/projectdao.cpp \
-    src/buildtargetdao.cpp \
-    src/unityapiclient.cpp \
-    src/projectsmodel.cpp \
-    src/profilesmodel.cpp \
-    src/buildtargetsmodel.cpp \
-    src/build.cpp \
-    src/buildsmodel.cpp \
-    src/builddao.cpp \
-    src/isynchronizer.cpp \
-    src/abstractsynchronizer.cpp \
-    src/servicelocator.cpp \
-    src/synchronizer.cpp \
-    src/buildref.cpp \
-    src/downloadworker.cpp \
-    src/downloadsdao.cpp
-
-HEADERS += \
-    includes/unityclouddownloader-core_global.h \
-    includes/profile.h \
-    includes/project.h \
-    includes/buildtarget.h \
-    includes/unityclouddownloadercore.h \
-    src/profiledao.h \
-    src/database.h \
-    src/projectdao.h \
-    src/buildtargetdao.h \
-    includes/unityapiclient.h \
-    includes/projectsmodel.h \
-    includes/profilesmodel.h \
-    includes/buildtargetsmodel.h \
-    includes/build.h \
-    includes/buildsmodel.h \
-    src/builddao.h \
-    includes/isynchronizer.h \
-    includes/servicelocator.h \
-    src/synchronizer.h \
-    includes/abstractsynchronizer.h \
-    includes/idatabaseprovider.h \
-    includes/buildref.h \
-    src/downloadworker.h \
-    src/downloadsdao.h
+include(core.pri)
 
 unix {
     target.path = /usr/lib
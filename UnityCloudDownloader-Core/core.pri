@@ -0,0 +1,95 @@
+# Sources of the core library, shared by the library and the tests that build it statically
+
+QT += network sql concurrent
+
+INCLUDEPATH += $$PWD/includes $$PWD/src
+
+win32 {
+    # use the zlib bundled with QtCore
+    INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+} else {
+    LIBS += -lz
+}
+
+SOURCES += \
+    $$PWD/src/profile.cpp \
+    $$PWD/src/buildtarget.cpp \
+    $$PWD/src/project.cpp \
+    $$PWD/src/unityclouddownloadercore.cpp \
+    $$PWD/src/profiledao.cpp \
+    $$PWD/src/database.cpp \
+    $$PWD/src/projectdao.cpp \
+    $$PWD/src/buildtargetdao.cpp \
+    $$PWD/src/unityapiclient.cpp \
+    $$PWD/src/projectsmodel.cpp \
+    $$PWD/src/profilesmodel.cpp \
+    $$PWD/src/buildtargetsmodel.cpp \
+    $$PWD/src/build.cpp \
+    $$PWD/src/buildsmodel.cpp \
+    $$PWD/src/builddao.cpp \
+    $$PWD/src/isynchronizer.cpp \
+    $$PWD/src/abstractsynchronizer.cpp \
+    $$PWD/src/servicelocator.cpp \
+    $$PWD/src/synchronizer.cpp \
+    $$PWD/src/buildref.cpp \
+    $$PWD/src/downloadworker.cpp \
+    $$PWD/src/downloadsdao.cpp \
+    $$PWD/src/settingsdao.cpp \
+    $$PWD/src/bandwidthlimiter.cpp \
+    $$PWD/src/zipstreamextractor.cpp \
+    $$PWD/src/ziparchive.cpp \
+    $$PWD/src/zipformat.cpp \
+    $$PWD/src/archiveextractor.cpp \
+    $$PWD/src/filesystem.cpp \
+    $$PWD/src/filewriter.cpp \
+    $$PWD/src/deltadownload.cpp \
+    $$PWD/src/contentstore.cpp \
+    $$PWD/src/downloadqueue.cpp \
+    $$PWD/src/networksession.cpp \
+    $$PWD/src/responsecachedao.cpp \
+    $$PWD/src/buildlistparser.cpp \
+    $$PWD/src/cachedquery.cpp \
+    $$PWD/src/schemamigrations.cpp
+
+HEADERS += \
+    $$PWD/includes/unityclouddownloader-core_global.h \
+    $$PWD/includes/profile.h \
+    $$PWD/includes/project.h \
+    $$PWD/includes/buildtarget.h \
+    $$PWD/includes/unityclouddownloadercore.h \
+    $$PWD/src/profiledao.h \
+    $$PWD/src/database.h \
+    $$PWD/src/projectdao.h \
+    $$PWD/src/buildtargetdao.h \
+    $$PWD/includes/unityapiclient.h \
+    $$PWD/includes/projectsmodel.h \
+    $$PWD/includes/profilesmodel.h \
+    $$PWD/includes/buildtargetsmodel.h \
+    $$PWD/includes/build.h \
+    $$PWD/includes/buildsmodel.h \
+    $$PWD/src/builddao.h \
+    $$PWD/includes/isynchronizer.h \
+    $$PWD/includes/servicelocator.h \
+    $$PWD/src/synchronizer.h \
+    $$PWD/includes/abstractsynchronizer.h \
+    $$PWD/includes/idatabaseprovider.h \
+    $$PWD/includes/buildref.h \
+    $$PWD/src/downloadworker.h \
+    $$PWD/src/downloadsdao.h \
+    $$PWD/src/sqlhelpers.h \
+    $$PWD/src/settingsdao.h \
+    $$PWD/src/bandwidthlimiter.h \
+    $$PWD/src/zipstreamextractor.h \
+    $$PWD/src/zipformat.h \
+    $$PWD/src/ziparchive.h \
+    $$PWD/src/archiveextractor.h \
+    $$PWD/src/filesystem.h \
+    $$PWD/src/filewriter.h \
+    $$PWD/src/deltadownload.h \
+    $$PWD/src/contentstore.h \
+    $$PWD/src/downloadqueue.h \
+    $$PWD/src/networksession.h \
+    $$PWD/src/responsecachedao.h \
+    $$PWD/src/buildlistparser.h \
+    $$PWD/src/cachedquery.h \
+    $$PWD/src/schemamigrations.h
@@ -35,6 +35,10 @@ signals:
      * @param build the build queued for download.
      */
     void downloadQueued(ucd::Build build);
+    /**
+     * @brief Signal emitted when builds are added to, or leave, the download queue.
+     */
+    void queueChanged();
     /**
      * @brief Signal emitted when a build download is started.
      * @param build the build that started downloading.
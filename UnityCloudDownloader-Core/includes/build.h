@@ -55,6 +55,7 @@ public:
     const QString& artifactName() const { return m_artifactName; }
     qint64 artifactSize() const { return m_artifactSize; }
     const QString& artifactPath() const { return m_artifactPath; }
+    const QString& artifactMd5() const { return m_artifactMd5; }
     bool manualDownload() const { return m_manual; }
 
     QString downloadFolderPath() const;
@@ -69,6 +70,7 @@ public:
     void setArtifactName(QString artifactName);
     void setArtifactSize(qint64 size);
     void setArtifactPath(QString artifactPath);
+    void setArtifactMd5(QString artifactMd5);
     void setManualDownload(bool value);
 
 private:
@@ -81,6 +83,7 @@ private:
     QString m_artifactName;
     qint64 m_artifactSize;
     QString m_artifactPath;
+    QString m_artifactMd5;
     bool m_manual;
 };
 
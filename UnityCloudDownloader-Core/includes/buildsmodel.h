@@ -33,6 +33,7 @@ public:
         ManualDownload,
         BuildRef,
         IsQueued,
+        QueuePosition,
         IsDownloading,
         IsDownloaded,
         DownloadProgress,
@@ -63,9 +64,13 @@ private slots:
     void onBuildsFetched(const QVector<Build> &builds);
     void updateDownloadStatus(const Build &build);
     void updateDownloadProgress(const Build &build);
+    void updateQueuePositions();
     void onSynchronized();
 
 private:
+    void mergeBuilds(const QVector<Build> &builds);
+    bool refreshRow(int row, const Build &build);
+    void insertBuild(const Build &build);
     bool isIndexValid(const QModelIndex &index) const;
 
     QUuid m_buildTargetId;
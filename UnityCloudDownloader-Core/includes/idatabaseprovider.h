@@ -15,7 +15,7 @@ namespace ucd
  *
  * Provider interface for SQL connections.
  * The default SQL connection is limited to the UI thread.
- * Create a new connection on other threads by passing a connection name.
+ * Other threads get their own connection, kept open until the thread finishes.
  */
 class UCD_SHARED_EXPORT IDatabaseProvider
 {
@@ -38,11 +38,10 @@ public:
      */
     virtual QSqlDatabase sqlDatabase() = 0;
     /**
-     * @brief Create a new SQL connection that can be used in the calling thread only.
-     * @param newConnectionName The name of the SQL connection.
-     * @return A new SQL connection.
+     * @brief The SQL connection of the calling thread, opened on first use and then reused.
+     * @return the connection, check it is open before use.
      */
-    virtual QSqlDatabase sqlDatabase(const QString &newConnectionName) = 0;
+    virtual QSqlDatabase threadDatabase() = 0;
 };
 
 }
@@ -5,6 +5,8 @@
 
 #include "unityclouddownloader-core_global.h"
 
+#include <QString>
+
 namespace ucd
 {
 
@@ -29,6 +31,12 @@ public:
      * @return true if the build is queued for download.
      */
     virtual bool isQueued(const Build &build) const = 0;
+    /**
+     * @brief Query the position of a build in the download queue.
+     * @param build the build that is queried.
+     * @return 0 for the next build to download, -1 if the build is not queued.
+     */
+    virtual int queuePosition(const Build &build) const = 0;
     /**
      * @brief Query if the build is downloaded.
      * @param build the build that is queried.
@@ -67,6 +75,36 @@ public:
      * @note This operation is asyncrhonous.
      */
     virtual void refresh() = 0;
+    /**
+     * @brief Query the download bandwidth limit.
+     * @return the limit in bytes per second outside of the scheduled windows, 0 if unlimited.
+     */
+    virtual qint64 bandwidthLimit() const = 0;
+    /**
+     * @brief Set and store the download bandwidth limit, it applies right away.
+     * @param bytesPerSecond the limit outside of the scheduled windows, 0 for unlimited.
+     */
+    virtual void setBandwidthLimit(qint64 bytesPerSecond) = 0;
+    /**
+     * @brief Query the bandwidth schedule.
+     * @return windows like "22:00-06:00=0;09:00-18:00=524288" with their rate in bytes per second.
+     */
+    virtual QString bandwidthSchedule() const = 0;
+    /**
+     * @brief Set and store the bandwidth schedule, it applies right away.
+     * @param schedule windows in the format returned by bandwidthSchedule().
+     */
+    virtual void setBandwidthSchedule(const QString &schedule) = 0;
+    /**
+     * @brief Query the order of the builds waiting for a download.
+     * @return "newest" or "smallest".
+     */
+    virtual QString downloadQueuePolicy() const = 0;
+    /**
+     * @brief Set and store the download queue policy, the queued builds are reordered.
+     * @param policy "newest" or "smallest".
+     */
+    virtual void setDownloadQueuePolicy(const QString &policy) = 0;
 };
 
 }
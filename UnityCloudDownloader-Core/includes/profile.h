@@ -22,6 +22,8 @@ class UCD_SHARED_EXPORT Profile
     Q_PROPERTY(QString name READ name WRITE setName)
     Q_PROPERTY(QString apiKey READ apiKey WRITE setApiKey)
     Q_PROPERTY(QString rootPath READ rootPath WRITE setRootPath)
+    Q_PROPERTY(int maxDownloads READ maxDownloads WRITE setMaxDownloads)
+    Q_PROPERTY(bool deduplicate READ deduplicate WRITE setDeduplicate)
 public:
     Profile();
     Profile(const Profile &other) = default;
@@ -35,12 +37,16 @@ public:
     const QString& name() const { return m_name; }
     const QString& apiKey() const { return m_apiKey; }
     const QString& rootPath() const { return m_rootPath; }
+    int maxDownloads() const { return m_maxDownloads; }
+    bool deduplicate() const { return m_deduplicate; }
     const ProjectList projects() const { return m_projects; }
 
     void setUuid(const QUuid &uuid);
     void setName(const QString &name);
     void setApiKey(const QString &apiKey);
     void setRootPath(const QString &rootPath);
+    void setMaxDownloads(int value);
+    void setDeduplicate(bool value);
     void setProjects(const ProjectList &projects);
 
 private:
@@ -48,6 +54,8 @@ private:
     QString m_name;
     QString m_apiKey;
     QString m_rootPath;
+    int m_maxDownloads; // 0 lets the synchronizer tune the number of concurrent downloads
+    bool m_deduplicate; // builds share their identical files through the content store
     ProjectList m_projects;
 };
 
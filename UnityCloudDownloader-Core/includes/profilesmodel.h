@@ -24,6 +24,8 @@ public:
         Name,
         RootPath,
         ApiKey,
+        MaxDownloads,
+        Deduplicate,
     };
 
     explicit ProfilesModel(QObject *parent = nullptr);
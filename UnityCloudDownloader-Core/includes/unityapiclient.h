@@ -7,11 +7,17 @@
 
 #include "project.h"
 #include "buildtarget.h"
+#include "build.h"
+
+#include <memory>
 
 #include <QObject>
+#include <QHash>
+#include <QUuid>
 #include <QVector>
 
 class QNetworkAccessManager;
+class QNetworkReply;
 
 namespace ucd
 {
@@ -20,6 +26,7 @@ class Profile;
 class Project;
 class BuildTarget;
 class Build;
+class BuildListParser;
 
 class UCD_SHARED_EXPORT UnityApiClient : public QObject
 {
@@ -33,6 +40,14 @@ public:
     const QString& apiKey() const { return m_apiKey; }
     void setApiKey(const QString &apiKey);
 
+    /**
+     * @brief Send build list requests with the validators of the previous response.
+     *
+     * When the server answers that nothing changed, buildsUnchanged is emitted
+     * instead of buildsFetched. The receiver must have stored the previous list.
+     */
+    void setConditionalRequests(bool enabled);
+
     Q_INVOKABLE void testKey(const QString &apiKey);
 
     Q_INVOKABLE void fetchProjects();
@@ -41,7 +56,18 @@ public:
     Q_INVOKABLE void fetchBuildTargets(const Project &project);
     Q_INVOKABLE void fetchBuilds(const QString &orgId, const QString &porjectId, const QString &buildTargetId);
     Q_INVOKABLE void fetchBuilds(const BuildTarget &buildTarget);
-
+    /**
+     * @brief Fetch the builds numbered above sinceBuildNumber, page by page, newest first.
+     *
+     * Pages are requested until one reaches sinceBuildNumber, buildsFetched then
+     * carries the builds of every page. The list may start a little below
+     * sinceBuildNumber and, past the page limit, miss some newer builds.
+     */
+    void fetchBuilds(const BuildTarget &buildTarget, int sinceBuildNumber);
+
+    /**
+     * @brief Warm up the connection to the API for the clients of the calling thread.
+     */
     static void preconnect();
 
 signals:
@@ -50,16 +76,24 @@ signals:
     void projectsFetched(QVector<Project> projects);
     void buildTargetsFetched(QVector<BuildTarget> buildTargets);
     void buildsFetched(QVector<Build> builds, QUuid buildTargetId);
+    void buildsUnchanged(QUuid buildTargetId);
 
 private slots:
     void keyTestFinished();
     void projectsReceived();
     void buildTargetsReceived();
+    void buildsDataReceived();
     void buildsReceived();
 
 private:
+    QNetworkReply* requestBuilds(const BuildTarget &buildTarget, int sinceBuildNumber, int page);
+    void watchBuilds(QNetworkReply *reply, const QUuid &buildTargetId);
+
     QString m_apiKey;
-    QNetworkAccessManager *m_networkManager;
+    QNetworkAccessManager *m_networkManager; // shared by the clients of the thread
+    bool m_conditionalRequests;
+    QHash<QUuid, QVector<Build>> m_pagedBuilds; // builds of the pages received so far
+    QHash<QNetworkReply*, std::shared_ptr<BuildListParser>> m_buildParsers;
 };
 
 }
@@ -3,7 +3,9 @@
 
 #include <QtCore/qglobal.h>
 
-#if defined(UCD_CORE_LIBRARY)
+#if defined(UCD_CORE_STATIC)
+#  define UCD_SHARED_EXPORT
+#elif defined(UCD_CORE_LIBRARY)
 #  define UCD_SHARED_EXPORT Q_DECL_EXPORT
 #else
 #  define UCD_SHARED_EXPORT Q_DECL_IMPORT
@@ -0,0 +1,129 @@
+#include "archiveextractor.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+namespace ucd
+{
+
+enum
+{
+    ProgressInterval = 100,
+};
+
+ArchiveExtractor::ArchiveExtractor(QString filePath, QString destinationPath, ContentStore store, QObject *parent)
+    : QObject(parent)
+    , m_archive(std::move(filePath))
+    , m_destinationPath(std::move(destinationPath))
+    , m_store(std::move(store))
+    , m_totalBytes(0)
+    , m_extractedBytes(0)
+    , m_failedCount(0)
+{
+    connect(&m_watcher, &QFutureWatcher<EntryResult>::resultReadyAt, this, &ArchiveExtractor::onResultReadyAt);
+    connect(&m_watcher, &QFutureWatcher<EntryResult>::finished, this, &ArchiveExtractor::onFinished);
+}
+
+ArchiveExtractor::~ArchiveExtractor()
+{
+    // running tasks use the archive and the entries
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+void ArchiveExtractor::start()
+{
+    m_timer.start();
+    m_progressTimer.start();
+    if (!m_archive.open())
+    {
+        qCritical("Cannot extract %s: %s", m_archive.filePath().toUtf8().data(), m_archive.errorString().toUtf8().data());
+        // keep the signal asynchronous like a regular completion
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection, Q_ARG(bool, false));
+        return;
+    }
+
+    // folders are created upfront so the tasks never race on them
+    QDir destination(m_destinationPath);
+    m_files.clear();
+    m_totalBytes = 0;
+    for (const auto &entry : m_archive.entries())
+    {
+        if (entry.isDirectory())
+        {
+            destination.mkpath(entry.path);
+        }
+        else
+        {
+            destination.mkpath(QFileInfo(destination.filePath(entry.path)).path());
+            m_files.append(entry);
+            m_totalBytes += static_cast<qint64>(entry.uncompressedSize);
+        }
+    }
+
+    // the biggest entries go first so a large file doesn't end up alone at the end
+    std::sort(std::begin(m_files), std::end(m_files),
+              [](const ZipArchive::Entry &lhs, const ZipArchive::Entry &rhs) -> bool { return lhs.compressedSize > rhs.compressedSize; });
+
+    const ZipArchive *archive = &m_archive;
+    const QString destinationPath = m_destinationPath;
+    const ContentStore store = m_store;
+    std::function<EntryResult(const ZipArchive::Entry&)> extractEntry = [archive, destinationPath, store](const ZipArchive::Entry &entry) -> EntryResult
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QString error = archive->extract(entry, destinationPath, store);
+        return EntryResult{static_cast<qint64>(entry.uncompressedSize), timer.elapsed(), error};
+    };
+    m_watcher.setFuture(QtConcurrent::mapped(m_files, extractEntry));
+}
+
+void ArchiveExtractor::onResultReadyAt(int index)
+{
+    const auto result = m_watcher.resultAt(index);
+    const auto &entry = m_files.at(index);
+    if (!result.error.isEmpty())
+    {
+        qCritical("%s", result.error.toUtf8().data());
+        ++m_failedCount;
+        m_watcher.cancel();
+        return;
+    }
+
+    qDebug("Extracted %s (%lld bytes) in %lld ms", entry.path.toUtf8().data(), result.size, result.elapsed);
+    m_extractedBytes += result.size;
+    if (m_progressTimer.elapsed() >= ProgressInterval)
+    {
+        m_progressTimer.restart();
+        qint64 speed = (m_extractedBytes * 1000) / std::max<qint64>(m_timer.elapsed(), 1);
+        emit progressChanged(m_extractedBytes, m_totalBytes, speed);
+    }
+}
+
+void ArchiveExtractor::onFinished()
+{
+    bool success = m_failedCount == 0 && !m_watcher.isCanceled();
+    // links are only created once no task writes anymore, so nothing is written through them
+    for (int i = 0, end = m_files.size(); i < end && success; ++i)
+    {
+        QString error = ZipArchive::linkEntry(m_files.at(i), m_destinationPath);
+        if (!error.isEmpty())
+        {
+            qCritical("%s", error.toUtf8().data());
+            success = false;
+        }
+    }
+    if (success)
+    {
+        qInfo("Extracted %d files from %s in %lld ms",
+              m_files.size(), m_archive.filePath().toUtf8().data(), m_timer.elapsed());
+        emit progressChanged(m_totalBytes, m_totalBytes, 0);
+    }
+    emit finished(success);
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef UCD_ARCHIVEEXTRACTOR_H
+#define UCD_ARCHIVEEXTRACTOR_H
+
+#pragma once
+
+#include "ziparchive.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+
+namespace ucd
+{
+
+/**
+ * @brief Extracts a ZIP archive from disk, inflating its entries in parallel.
+ *
+ * Entries are spread over the global thread pool, results and progress are
+ * reported on the thread owning the extractor.
+ */
+class ArchiveExtractor : public QObject
+{
+    Q_OBJECT
+public:
+    ArchiveExtractor(QString filePath, QString destinationPath, ContentStore store, QObject *parent = nullptr);
+    ~ArchiveExtractor() override;
+
+    void start();
+
+signals:
+    void progressChanged(qint64 extractedBytes, qint64 totalBytes, qint64 speed);
+    void finished(bool success);
+
+private slots:
+    void onResultReadyAt(int index);
+    void onFinished();
+
+private:
+    struct EntryResult
+    {
+        qint64 size;
+        qint64 elapsed;
+        QString error;
+    };
+
+    ZipArchive m_archive;
+    QString m_destinationPath;
+    ContentStore m_store;
+    QVector<ZipArchive::Entry> m_files;
+    QFutureWatcher<EntryResult> m_watcher;
+    QElapsedTimer m_timer;
+    QElapsedTimer m_progressTimer;
+    qint64 m_totalBytes;
+    qint64 m_extractedBytes;
+    int m_failedCount;
+};
+
+}
+
+#endif // UCD_ARCHIVEEXTRACTOR_H
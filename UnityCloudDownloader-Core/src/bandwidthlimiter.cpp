@@ -0,0 +1,139 @@
+#include "bandwidthlimiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QStringList>
+
+namespace ucd
+{
+
+enum
+{
+    MinBurst = 16 * 1024,
+    BurstWindow = 50, // milliseconds worth of tokens the bucket can hold
+};
+
+BandwidthLimiter::BandwidthLimiter()
+    : m_lastRefill(0)
+    , m_tokens(0)
+    , m_rate(0)
+    , m_defaultRate(0)
+{
+    m_clock.start();
+}
+
+QVector<BandwidthLimiter::Window> BandwidthLimiter::parseSchedule(const QString &value)
+{
+    QVector<Window> schedule;
+    // empty entries are skipped by hand, QString::SkipEmptyParts is deprecated since Qt 5.14
+    for (const auto &entry : value.split(QLatin1Char(';')))
+    {
+        if (entry.trimmed().isEmpty())
+            continue;
+
+        auto parts = entry.trimmed().split(QLatin1Char('='));
+        auto times = parts.first().split(QLatin1Char('-'));
+        if (parts.size() != 2 || times.size() != 2)
+        {
+            qWarning("Ignoring bandwidth schedule entry %s", entry.toUtf8().data());
+            continue;
+        }
+
+        Window window;
+        window.start = QTime::fromString(times.at(0).trimmed(), QStringLiteral("HH:mm"));
+        window.end = QTime::fromString(times.at(1).trimmed(), QStringLiteral("HH:mm"));
+        bool ok = false;
+        window.rate = parts.at(1).trimmed().toLongLong(&ok);
+        if (!window.start.isValid() || !window.end.isValid() || !ok || window.rate < 0)
+        {
+            qWarning("Ignoring bandwidth schedule entry %s", entry.toUtf8().data());
+            continue;
+        }
+        schedule.append(window);
+    }
+    return schedule;
+}
+
+qint64 BandwidthLimiter::rate() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rate;
+}
+
+void BandwidthLimiter::setDefaultRate(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_defaultRate = std::max<qint64>(bytesPerSecond, 0);
+}
+
+void BandwidthLimiter::setSchedule(const QVector<Window> &schedule)
+{
+    QMutexLocker locker(&m_mutex);
+    m_schedule = schedule;
+}
+
+void BandwidthLimiter::update(const QTime &now)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 rate = m_defaultRate;
+    for (const auto &window : m_schedule)
+    {
+        bool inside = window.start <= window.end
+                ? (now >= window.start && now < window.end)
+                : (now >= window.start || now < window.end);
+        if (inside)
+        {
+            rate = window.rate;
+            break;
+        }
+    }
+    setRate(rate);
+}
+
+qint64 BandwidthLimiter::acquire(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_rate == 0)
+        return bytes;
+
+    refill();
+    qint64 granted = std::min<qint64>(bytes, static_cast<qint64>(m_tokens));
+    m_tokens -= granted;
+    return granted;
+}
+
+int BandwidthLimiter::delay(qint64 bytes) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_rate == 0)
+        return 1;
+
+    double missing = std::max(static_cast<double>(bytes) - m_tokens, 0.0);
+    // never wait for more than the bucket can hold
+    missing = std::min(missing, static_cast<double>(std::max<qint64>(m_rate * BurstWindow / 1000, MinBurst)));
+    return std::max(static_cast<int>(std::ceil(missing * 1000 / m_rate)), 1);
+}
+
+void BandwidthLimiter::setRate(qint64 bytesPerSecond)
+{
+    if (bytesPerSecond == m_rate)
+        return;
+
+    refill();
+    m_rate = bytesPerSecond;
+    m_tokens = 0;
+}
+
+void BandwidthLimiter::refill()
+{
+    qint64 now = m_clock.nsecsElapsed();
+    // the bucket is never more than a second behind, which also keeps the product in range
+    qint64 elapsed = std::min<qint64>(now - m_lastRefill, 1000000000);
+    m_lastRefill = now;
+
+    const double capacity = static_cast<double>(std::max<qint64>(m_rate * BurstWindow / 1000, MinBurst));
+    m_tokens = std::min(m_tokens + static_cast<double>(m_rate) * elapsed / 1e9, capacity);
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef UCD_BANDWIDTHLIMITER_H
+#define UCD_BANDWIDTHLIMITER_H
+
+#pragma once
+
+#include "unityclouddownloader-core_global.h"
+
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QTime>
+#include <QVector>
+
+namespace ucd
+{
+
+/**
+ * @brief Token bucket shared by every download worker.
+ *
+ * Workers draw tokens before reading from their replies and wait for the
+ * bucket to refill when it is empty. A rate of 0 disables the limit.
+ * All methods are thread safe.
+ */
+class BandwidthLimiter
+{
+public:
+    /**
+     * @brief A time of day window with its own rate, it may wrap around midnight.
+     */
+    struct Window
+    {
+        QTime start;
+        QTime end;
+        qint64 rate;
+    };
+
+    BandwidthLimiter();
+    BandwidthLimiter(const BandwidthLimiter&) = delete;
+    ~BandwidthLimiter() = default;
+
+    BandwidthLimiter& operator=(const BandwidthLimiter&) = delete;
+
+    /**
+     * @brief Parse a schedule such as "09:00-18:00=524288;22:00-06:00=0".
+     * @return the windows, entries that can't be parsed are skipped.
+     */
+    static QVector<Window> parseSchedule(const QString &value);
+
+    qint64 rate() const;
+    void setDefaultRate(qint64 bytesPerSecond);
+    void setSchedule(const QVector<Window> &schedule);
+    /**
+     * @brief Apply the rate of the schedule window that contains the given time.
+     */
+    void update(const QTime &now);
+
+    /**
+     * @brief Take up to the requested number of bytes from the bucket.
+     * @return the number of bytes that can be read now, possibly 0.
+     */
+    qint64 acquire(qint64 bytes);
+    /**
+     * @brief Time until the bucket holds the requested number of bytes.
+     * @return a delay in milliseconds, at least 1.
+     */
+    int delay(qint64 bytes) const;
+
+private:
+    void setRate(qint64 bytesPerSecond);
+    void refill();
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_lastRefill;
+    double m_tokens;
+    qint64 m_rate;
+    qint64 m_defaultRate;
+    QVector<Window> m_schedule;
+};
+
+}
+
+#endif // UCD_BANDWIDTHLIMITER_H
@@ -50,7 +50,8 @@ bool Build::isLike(const Build &other)
             && m_iconPath == other.m_iconPath
             && m_artifactName == other.m_artifactName
             && m_artifactSize == other.m_artifactSize
-            && m_artifactPath == other.m_artifactPath;
+            && m_artifactPath == other.m_artifactPath
+            && m_artifactMd5 == other.m_artifactMd5;
 }
 
 void Build::takeFrom(const Build &other)
@@ -63,6 +64,7 @@ void Build::takeFrom(const Build &other)
     m_artifactName = other.m_artifactName;
     m_artifactSize = other.m_artifactSize;
     m_artifactPath = other.m_artifactPath;
+    m_artifactMd5 = other.m_artifactMd5;
 }
 
 QString Build::downloadFolderPath() const
@@ -137,6 +139,11 @@ void Build::setArtifactPath(QString artifactPath)
     m_artifactPath = std::move(artifactPath);
 }
 
+void Build::setArtifactMd5(QString artifactMd5)
+{
+    m_artifactMd5 = std::move(artifactMd5);
+}
+
 void Build::setManualDownload(bool value)
 {
     m_manual = value;
@@ -154,7 +161,8 @@ QDataStream &operator<<(QDataStream &out, const ucd::Build &value)
             << value.iconPath()
             << value.artifactName()
             << value.artifactSize()
-            << value.artifactPath();
+            << value.artifactPath()
+            << value.artifactMd5();
 
     return out;
 }
@@ -177,6 +185,8 @@ QDataStream &operator>>(QDataStream &in, ucd::Build &dest)
     in >> artifactSize;
     QString artifactPath;
     in >> artifactPath;
+    QString artifactMd5;
+    in >> artifactMd5;
 
     dest.setId(buildNumber);
     dest.setName(name);
@@ -186,6 +196,7 @@ QDataStream &operator>>(QDataStream &in, ucd::Build &dest)
     dest.setArtifactName(artifactName);
     dest.setArtifactSize(artifactSize);
     dest.setArtifactPath(artifactPath);
+    dest.setArtifactMd5(artifactMd5);
 
     return in;
 }
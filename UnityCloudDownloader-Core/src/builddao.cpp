@@ -1,6 +1,8 @@
 #include "builddao.h"
 
 #include "build.h"
+#include "sqlhelpers.h"
+#include "cachedquery.h"
 
 #include <QVariant>
 #include <QSqlQuery>
@@ -18,7 +20,7 @@ void BuildDao::init()
     QSqlQuery query(m_db);
     if (!query.exec("CREATE TABLE IF NOT EXISTS Builds ("
                "buildNumber INT, "
-               "buildTargetId TEXT, "
+               "buildTargetId BLOB, "
                "status TINYINT, "
                "name TEXT, "
                "createTime DATETIME, "
@@ -33,6 +35,8 @@ void BuildDao::init()
         qFatal("%s", error.data());
         throw std::runtime_error(error);
     }
+
+    ensureColumn(m_db, QStringLiteral("Builds"), QStringLiteral("artifactMd5"), QStringLiteral("TEXT"));
 }
 
 bool BuildDao::hasBuild(const Build &build)
@@ -42,12 +46,12 @@ bool BuildDao::hasBuild(const Build &build)
 
 bool BuildDao::hasBuild(const BuildRef &buildRef)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT COUNT(*) WHERE EXISTS(SELECT 1 FROM Builds WHERE "
                   "buildNumber = :buildNumber "
                   "AND buildTargetId = :buildTargetId)");
     query.bindValue(":buildNumber", buildRef.buildNumber());
-    query.bindValue(":buildTargetId", buildRef.buildTargetId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -69,17 +73,17 @@ void BuildDao::addBuild(const Build &build, bool orReplace)
         qCritical("%s", error);
         throw std::runtime_error(error);
     }
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare(QStringLiteral(
                           "INSERT %1INTO Builds ("
                           "buildNumber, buildTargetId, status, name, "
                           "createTime, iconPath, artifactName, artifactSize, "
-                          "artifactPath, manualDownload)"
+                          "artifactPath, artifactMd5, manualDownload)"
                           "VALUES (:buildNumber, :buildTargetId, :status, :name, "
                           ":createTime, :iconPath, :artifactName, :artifactSize, "
-                          ":artifactPath, :manualDownload)").arg(orReplace ? QStringLiteral("OR REPLACE ") : QStringLiteral("")));
+                          ":artifactPath, :artifactMd5, :manualDownload)").arg(orReplace ? QStringLiteral("OR REPLACE ") : QStringLiteral("")));
     query.bindValue(":buildNumber", build.id());
-    query.bindValue(":buildTargetId", build.buildTargetId());
+    query.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
     query.bindValue(":status", build.status());
     query.bindValue(":name", build.name());
     query.bindValue(":createTime", build.createTime());
@@ -87,6 +91,7 @@ void BuildDao::addBuild(const Build &build, bool orReplace)
     query.bindValue(":artifactName", build.artifactName());
     query.bindValue(":artifactSize", build.artifactSize());
     query.bindValue(":artifactPath", build.artifactPath());
+    query.bindValue(":artifactMd5", build.artifactMd5());
     query.bindValue(":manualDownload", build.manualDownload());
     if (!query.exec())
     {
@@ -98,13 +103,14 @@ void BuildDao::addBuild(const Build &build, bool orReplace)
 
 void BuildDao::updateBuild(const Build &build)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("UPDATE Builds SET "
                   "status = :status, "
                   "iconPath = :iconPath, "
                   "artifactName = :artifactName, "
                   "artifactSize = :artifactSize, "
                   "artifactPath = :artifactPath, "
+                  "artifactMd5 = :artifactMd5, "
                   "manualDownload = :manualDownload "
                   "WHERE buildNumber = :buildNumber "
                   "AND buildTargetId = :buildTargetId");
@@ -113,9 +119,10 @@ void BuildDao::updateBuild(const Build &build)
     query.bindValue(":artifactName", build.artifactName());
     query.bindValue(":artifactSize", build.artifactSize());
     query.bindValue(":artifactPath", build.artifactPath());
+    query.bindValue(":artifactMd5", build.artifactMd5());
     query.bindValue(":manualDownload", build.manualDownload());
     query.bindValue(":buildNumber", build.id());
-    query.bindValue(":buildTargetId", build.buildTargetId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -126,13 +133,14 @@ void BuildDao::updateBuild(const Build &build)
 
 void BuildDao::partialUpdate(const Build &build)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("UPDATE Builds SET "
                   "status = :status, "
                   "iconPath = :iconPath, "
                   "artifactName = :artifactName, "
                   "artifactSize = :artifactSize, "
-                  "artifactPath = :artifactPath "
+                  "artifactPath = :artifactPath, "
+                  "artifactMd5 = :artifactMd5 "
                   "WHERE buildNumber = :buildNumber "
                   "AND buildTargetId = :buildTargetId");
     query.bindValue(":status", build.status());
@@ -140,8 +148,9 @@ void BuildDao::partialUpdate(const Build &build)
     query.bindValue(":artifactName", build.artifactName());
     query.bindValue(":artifactSize", build.artifactSize());
     query.bindValue(":artifactPath", build.artifactPath());
+    query.bindValue(":artifactMd5", build.artifactMd5());
     query.bindValue(":buildNumber", build.id());
-    query.bindValue(":buildTargetId", build.buildTargetId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -150,14 +159,94 @@ void BuildDao::partialUpdate(const Build &build)
     }
 }
 
+void BuildDao::upsertBuilds(const QVector<Build> &builds)
+{
+    if (builds.isEmpty())
+        return;
+
+    // a caller already holding a transaction keeps it
+    const bool ownTransaction = m_db.transaction();
+    // ON CONFLICT needs SQLite 3.24, older Qt builds ship an older one, so known builds are
+    // updated like partialUpdate does and only the others are inserted
+    CachedQuery update(m_db);
+    update.prepare("UPDATE Builds SET "
+                   "status = :status, "
+                   "iconPath = :iconPath, "
+                   "artifactName = :artifactName, "
+                   "artifactSize = :artifactSize, "
+                   "artifactPath = :artifactPath, "
+                   "artifactMd5 = :artifactMd5 "
+                   "WHERE buildNumber = :buildNumber "
+                   "AND buildTargetId = :buildTargetId");
+    CachedQuery insert(m_db);
+    insert.prepare("INSERT OR IGNORE INTO Builds ("
+                   "buildNumber, buildTargetId, status, name, "
+                   "createTime, iconPath, artifactName, artifactSize, "
+                   "artifactPath, artifactMd5, manualDownload) "
+                   "VALUES (:buildNumber, :buildTargetId, :status, :name, "
+                   ":createTime, :iconPath, :artifactName, :artifactSize, "
+                   ":artifactPath, :artifactMd5, :manualDownload)");
+    for (const auto &build : builds)
+    {
+        if (build.buildTargetId().isNull())
+        {
+            if (ownTransaction)
+                m_db.rollback();
+            const char error[] = "Trying to add a build with a null build target.";
+            qCritical("%s", error);
+            throw std::runtime_error(error);
+        }
+        update.bindValue(":status", build.status());
+        update.bindValue(":iconPath", build.iconPath());
+        update.bindValue(":artifactName", build.artifactName());
+        update.bindValue(":artifactSize", build.artifactSize());
+        update.bindValue(":artifactPath", build.artifactPath());
+        update.bindValue(":artifactMd5", build.artifactMd5());
+        update.bindValue(":buildNumber", build.id());
+        update.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
+        bool success = update.exec();
+        if (success && update.numRowsAffected() == 0)
+        {
+            insert.bindValue(":buildNumber", build.id());
+            insert.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
+            insert.bindValue(":status", build.status());
+            insert.bindValue(":name", build.name());
+            insert.bindValue(":createTime", build.createTime());
+            insert.bindValue(":iconPath", build.iconPath());
+            insert.bindValue(":artifactName", build.artifactName());
+            insert.bindValue(":artifactSize", build.artifactSize());
+            insert.bindValue(":artifactPath", build.artifactPath());
+            insert.bindValue(":artifactMd5", build.artifactMd5());
+            insert.bindValue(":manualDownload", build.manualDownload());
+            success = insert.exec();
+        }
+        if (!success)
+        {
+            auto error = (update.lastError().isValid() ? update.lastError() : insert.lastError()).text().toUtf8();
+            if (ownTransaction)
+                m_db.rollback();
+            qCritical("%s", error.data());
+            throw std::runtime_error(error);
+        }
+    }
+
+    if (ownTransaction && !m_db.commit())
+    {
+        auto error = m_db.lastError().text().toUtf8();
+        m_db.rollback();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
 void BuildDao::removeBuild(const Build &build)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM Builds "
                   "WHERE buildNumber = :buildNumber "
                   "AND buildTargetId = :buildTargetId");
     query.bindValue(":buildNumber", build.id());
-    query.bindValue(":buildTargetId", build.buildTargetId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(build.buildTargetId()));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -169,7 +258,7 @@ void BuildDao::removeBuild(const Build &build)
 QVector<Build> BuildDao::builds(const QUuid &buildTargetId)
 {
     QVector<Build> builds;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     if (buildTargetId.isNull())
     {
         query.exec("SELECT * FROM Builds");
@@ -177,14 +266,14 @@ QVector<Build> BuildDao::builds(const QUuid &buildTargetId)
     else
     {
         query.prepare("SELECT * FROM Builds WHERE buildTargetId = :buildTargetId ORDER BY buildNumber DESC");
-        query.bindValue(":buildTargetId", buildTargetId.toString());
+        query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
         query.exec();
     }
     while (query.next())
     {
         Build build;
         build.setId(query.value("buildNumber").toInt());
-        build.setBuildTargetId(query.value("buildTargetId").toString());
+        build.setBuildTargetId(uuidFromSql(query.value("buildTargetId")));
         build.setStatus(query.value("status").toInt());
         build.setName(query.value("name").toString());
         build.setCreateTime(query.value("createTime").toDateTime());
@@ -192,6 +281,7 @@ QVector<Build> BuildDao::builds(const QUuid &buildTargetId)
         build.setArtifactName(query.value("artifactName").toString());
         build.setArtifactSize(query.value("artifactSize").toLongLong());
         build.setArtifactPath(query.value("artifactPath").toString());
+        build.setArtifactMd5(query.value("artifactMd5").toString());
         build.setManualDownload(query.value("manualDownload").toBool());
         builds.append(std::move(build));
     }
@@ -202,9 +292,9 @@ QVector<Build> BuildDao::builds(const QUuid &buildTargetId)
 Build BuildDao::build(const QUuid &buildTargetId, int buildNumber)
 {
     Build build;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT * FROM Builds WHERE buildTargetId = :buildTargetId AND buildNumber = :buildNumber");
-    query.bindValue(":buildTargetId", buildTargetId.toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
     query.bindValue(":buildNumber", buildNumber);
     if (!query.exec())
     {
@@ -215,7 +305,7 @@ Build BuildDao::build(const QUuid &buildTargetId, int buildNumber)
     else if (query.next())
     {
         build.setId(query.value("buildNumber").toInt());
-        build.setBuildTargetId(query.value("buildTargetId").toString());
+        build.setBuildTargetId(uuidFromSql(query.value("buildTargetId")));
         build.setStatus(query.value("status").toInt());
         build.setName(query.value("name").toString());
         build.setCreateTime(query.value("createTime").toDateTime());
@@ -223,17 +313,44 @@ Build BuildDao::build(const QUuid &buildTargetId, int buildNumber)
         build.setArtifactName(query.value("artifactName").toString());
         build.setArtifactSize(query.value("artifactSize").toLongLong());
         build.setArtifactPath(query.value("artifactPath").toString());
+        build.setArtifactMd5(query.value("artifactMd5").toString());
         build.setManualDownload(query.value("manualDownload").toBool());
     }
 
     return build;
 }
 
+int BuildDao::settledBuildNumber(const QUuid &buildTargetId)
+{
+    CachedQuery query(m_db);
+    query.prepare("SELECT MAX(buildNumber), "
+                  "MIN(CASE WHEN status IN (:queued, :sentToBuilder, :started, :restarted) THEN buildNumber END) "
+                  "FROM Builds WHERE buildTargetId = :buildTargetId");
+    query.bindValue(":queued", static_cast<int>(Build::Queued));
+    query.bindValue(":sentToBuilder", static_cast<int>(Build::SentToBuilder));
+    query.bindValue(":started", static_cast<int>(Build::Started));
+    query.bindValue(":restarted", static_cast<int>(Build::Restarted));
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+    if (!query.next())
+        return 0;
+
+    // a build still in progress may change, the fetch has to reach back to it
+    if (!query.isNull(1))
+        return query.value(1).toInt() - 1;
+    return query.value(0).toInt();
+}
+
 void BuildDao::removeBuilds(const QUuid &buildTargetId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM Builds WHERE buildTargetId = :buildTargetId");
-    query.bindValue(":buildTargetId", buildTargetId.toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -28,9 +28,18 @@ public:
     void addBuild(const Build &build, bool orReplace = false);
     void updateBuild(const Build &build);
     void partialUpdate(const Build &build);
+    /**
+     * @brief Add the new builds and partially update the known ones, in a single transaction.
+     */
+    void upsertBuilds(const QVector<Build> &builds);
     void removeBuild(const Build &build);
     QVector<Build> builds(const QUuid &buildTargetId);
     Build build(const QUuid &buildTargetId, int buildNumber);
+    /**
+     * @brief Highest build number of a target below which every stored build is finished.
+     * @return 0 if the target has no builds.
+     */
+    int settledBuildNumber(const QUuid &buildTargetId);
 
     void removeBuilds(const QUuid &buildTargetId);
 
@@ -0,0 +1,406 @@
+#include "buildlistparser.h"
+
+#include <cstring>
+
+#include <QDateTime>
+
+namespace ucd
+{
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool isScalarChar(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || c == '-' || c == '+' || c == '.';
+}
+
+static bool matches(const char *begin, const char *end, const char *literal)
+{
+    const auto length = std::strlen(literal);
+    return static_cast<size_t>(end - begin) == length && std::memcmp(begin, literal, length) == 0;
+}
+
+BuildListParser::BuildListParser(const QUuid &buildTargetId)
+    : m_buildTargetId(buildTargetId)
+    , m_expect(Expect::Value)
+    , m_error(false)
+    , m_artifactChosen(false)
+    , m_primaryArtifact(false)
+    , m_hasFile(false)
+    , m_fileSize(0)
+{}
+
+bool BuildListParser::feed(const QByteArray &data)
+{
+    if (m_error)
+        return false;
+
+    if (m_buffer.isEmpty())
+        m_buffer = data;
+    else
+        m_buffer += data;
+    return parse(false);
+}
+
+bool BuildListParser::finish()
+{
+    if (!m_error)
+        parse(true);
+    return !m_error && m_expect == Expect::End;
+}
+
+QVector<Build> BuildListParser::takeBuilds()
+{
+    QVector<Build> builds;
+    builds.swap(m_builds);
+    return builds;
+}
+
+bool BuildListParser::parse(bool atEnd)
+{
+    const char *begin = m_buffer.constData();
+    const char *end = begin + m_buffer.size();
+    const char *p = begin;
+    while (p < end && !m_error)
+    {
+        const char c = *p;
+        if (isSpace(c))
+        {
+            ++p;
+            continue;
+        }
+        if (m_expect == Expect::End)
+        {
+            m_error = true;
+            break;
+        }
+
+        const char *next = p + 1;
+        switch (c)
+        {
+        case '{':
+        case '[':
+            m_error = !open(c == '{');
+            break;
+        case '}':
+        case ']':
+            m_error = !close(c == '}');
+            break;
+        case ',':
+            if (m_expect != Expect::Separator)
+                m_error = true;
+            else
+                m_expect = m_frames.last().isObject ? Expect::Key : Expect::Value;
+            break;
+        case ':':
+            if (m_expect != Expect::Colon)
+                m_error = true;
+            else
+                m_expect = Expect::Value;
+            break;
+        case '"':
+            next = parseString(p, end);
+            break;
+        default:
+            next = parseScalar(p, end, atEnd);
+            break;
+        }
+
+        // the token continues in the next bytes
+        if (!next)
+            break;
+        p = next;
+    }
+
+    if (m_error)
+    {
+        m_buffer.clear();
+        return false;
+    }
+
+    // only the partial token is kept
+    if (p == end)
+        m_buffer.clear();
+    else
+        m_buffer.remove(0, static_cast<int>(p - begin));
+    if (atEnd && !m_buffer.isEmpty())
+        m_error = true;
+    return !m_error;
+}
+
+const char* BuildListParser::parseString(const char *begin, const char *end)
+{
+    const char *first = begin + 1;
+    const char *quote = first;
+    for (;;)
+    {
+        quote = static_cast<const char*>(std::memchr(quote, '"', static_cast<size_t>(end - quote)));
+        if (!quote)
+            return nullptr;
+
+        // an odd number of backslashes escapes the quote
+        const char *slash = quote;
+        while (slash > first && slash[-1] == '\\')
+            --slash;
+        if ((quote - slash) % 2 == 0)
+            break;
+        ++quote;
+    }
+
+    const bool escaped = std::memchr(first, '\\', static_cast<size_t>(quote - first)) != nullptr;
+    if (m_expect == Expect::Key)
+    {
+        m_key = escaped ? decode(first, quote, true).toUtf8() : QByteArray(first, static_cast<int>(quote - first));
+        m_expect = Expect::Colon;
+    }
+    else if (m_expect == Expect::Value)
+    {
+        setString(first, quote, escaped);
+        valueParsed();
+    }
+    else
+    {
+        m_error = true;
+    }
+    return quote + 1;
+}
+
+const char* BuildListParser::parseScalar(const char *begin, const char *end, bool atEnd)
+{
+    const char *p = begin;
+    while (p < end && isScalarChar(*p))
+        ++p;
+    if (p == end && !atEnd)
+        return nullptr;
+
+    if (m_expect != Expect::Value || p == begin)
+    {
+        m_error = true;
+        return p;
+    }
+
+    if (*begin == '-' || (*begin >= '0' && *begin <= '9'))
+    {
+        setNumber(begin, p);
+    }
+    else if (!matches(begin, p, "true") && !matches(begin, p, "false") && !matches(begin, p, "null"))
+    {
+        m_error = true;
+        return p;
+    }
+    valueParsed();
+    return p;
+}
+
+bool BuildListParser::open(bool isObject)
+{
+    if (m_expect != Expect::Value)
+        return false;
+
+    const Context context = childContext(isObject);
+    m_frames.append(Frame{context, isObject, 0});
+    switch (context)
+    {
+    case Context::Build:
+        m_build = Build();
+        m_build.setBuildTargetId(m_buildTargetId);
+        m_artifactChosen = false;
+        break;
+    case Context::Artifact:
+        m_primaryArtifact = false;
+        m_hasFile = false;
+        m_fileName.clear();
+        m_fileSize = 0;
+        m_filePath.clear();
+        m_fileMd5.clear();
+        break;
+    case Context::File:
+        m_hasFile = true;
+        break;
+    default:
+        break;
+    }
+
+    m_expect = isObject ? Expect::Key : Expect::Value;
+    return true;
+}
+
+bool BuildListParser::close(bool isObject)
+{
+    if (m_frames.isEmpty() || m_frames.last().isObject != isObject)
+        return false;
+    if (m_expect != Expect::Separator && m_expect != (isObject ? Expect::Key : Expect::Value))
+        return false;
+
+    switch (m_frames.takeLast().context)
+    {
+    case Context::Build:
+        m_builds.append(std::move(m_build));
+        m_build = Build();
+        break;
+    case Context::Artifact:
+        // the first primary artifact is kept, the key may follow its files
+        if (m_primaryArtifact && !m_artifactChosen)
+        {
+            m_artifactChosen = true;
+            if (m_hasFile)
+            {
+                m_build.setArtifactName(m_fileName);
+                m_build.setArtifactSize(m_fileSize);
+                m_build.setArtifactPath(m_filePath);
+                m_build.setArtifactMd5(m_fileMd5);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    valueParsed();
+    return true;
+}
+
+void BuildListParser::valueParsed()
+{
+    m_expect = m_frames.isEmpty() ? Expect::End : Expect::Separator;
+}
+
+BuildListParser::Context BuildListParser::childContext(bool isObject)
+{
+    if (m_frames.isEmpty())
+        return isObject ? Context::Other : Context::Builds;
+
+    Frame &parent = m_frames.last();
+    const int index = parent.count++;
+    switch (parent.context)
+    {
+    case Context::Builds:
+        return isObject ? Context::Build : Context::Other;
+    case Context::Build:
+        return isObject && m_key == "links" ? Context::Links : Context::Other;
+    case Context::Links:
+        if (isObject && m_key == "icon")
+            return Context::Icon;
+        if (!isObject && m_key == "artifacts")
+            return Context::Artifacts;
+        return Context::Other;
+    case Context::Artifacts:
+        return isObject ? Context::Artifact : Context::Other;
+    case Context::Artifact:
+        return !isObject && m_key == "files" ? Context::Files : Context::Other;
+    case Context::Files:
+        return isObject && index == 0 ? Context::File : Context::Other;
+    default:
+        return Context::Other;
+    }
+}
+
+void BuildListParser::setString(const char *begin, const char *end, bool escaped)
+{
+    if (m_frames.isEmpty())
+        return;
+
+    switch (m_frames.last().context)
+    {
+    case Context::Build:
+        if (m_key == "buildTargetName")
+            m_build.setName(decode(begin, end, escaped));
+        else if (m_key == "buildStatus")
+            m_build.setStatus(Build::statusFromString(decode(begin, end, escaped)));
+        else if (m_key == "created")
+            m_build.setCreateTime(QDateTime::fromString(decode(begin, end, escaped), Qt::ISODateWithMs));
+        break;
+    case Context::Icon:
+        if (m_key == "href")
+            m_build.setIconPath(decode(begin, end, escaped));
+        break;
+    case Context::Artifact:
+        if (m_key == "key")
+            m_primaryArtifact = matches(begin, end, "primary");
+        break;
+    case Context::File:
+        if (m_key == "filename")
+            m_fileName = decode(begin, end, escaped);
+        else if (m_key == "size")
+            m_fileSize = decode(begin, end, escaped).toLongLong();
+        else if (m_key == "href")
+            m_filePath = decode(begin, end, escaped);
+        else if (m_key == "md5sum")
+            m_fileMd5 = decode(begin, end, escaped);
+        break;
+    default:
+        break;
+    }
+}
+
+void BuildListParser::setNumber(const char *begin, const char *end)
+{
+    if (m_frames.isEmpty())
+        return;
+
+    const Context context = m_frames.last().context;
+    if (context == Context::Build && m_key == "build")
+    {
+        // like QJsonValue::toInt, a fractional number isn't a build number
+        const double value = QByteArray(begin, static_cast<int>(end - begin)).toDouble();
+        const int buildNumber = static_cast<int>(value);
+        m_build.setId(buildNumber == value ? buildNumber : 0);
+    }
+    else if (context == Context::File && m_key == "size")
+    {
+        m_fileSize = qRound64(QByteArray(begin, static_cast<int>(end - begin)).toDouble());
+    }
+}
+
+QString BuildListParser::decode(const char *begin, const char *end, bool escaped)
+{
+    if (!escaped)
+        return QString::fromUtf8(begin, static_cast<int>(end - begin));
+
+    QString result;
+    result.reserve(static_cast<int>(end - begin));
+    const char *run = begin;
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (*p != '\\')
+            continue;
+
+        result += QString::fromUtf8(run, static_cast<int>(p - run));
+        if (++p == end)
+        {
+            run = end;
+            break;
+        }
+        switch (*p)
+        {
+        case 'b': result += QLatin1Char('\b'); break;
+        case 'f': result += QLatin1Char('\f'); break;
+        case 'n': result += QLatin1Char('\n'); break;
+        case 'r': result += QLatin1Char('\r'); break;
+        case 't': result += QLatin1Char('\t'); break;
+        case 'u':
+            // surrogate pairs come as two escapes, each one is a UTF-16 unit
+            if (end - p > 4)
+            {
+                bool ok = false;
+                const ushort unit = QByteArray::fromRawData(p + 1, 4).toUShort(&ok, 16);
+                if (ok)
+                    result += QChar(unit);
+                p += 4;
+            }
+            break;
+        default:
+            result += QLatin1Char(*p);
+            break;
+        }
+        run = p + 1;
+    }
+    result += QString::fromUtf8(run, static_cast<int>(end - run));
+    return result;
+}
+
+}
@@ -0,0 +1,103 @@
+#ifndef UCD_BUILDLISTPARSER_H
+#define UCD_BUILDLISTPARSER_H
+
+#pragma once
+
+#include "build.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+namespace ucd
+{
+
+/**
+ * @brief Parses a build list response as its bytes arrive.
+ *
+ * The JSON is tokenized without building a document, only the values a Build
+ * keeps are decoded and every build is filled as its fields go by. Consumed
+ * bytes are dropped, the parser only holds the builds and a partial token.
+ */
+class BuildListParser
+{
+public:
+    explicit BuildListParser(const QUuid &buildTargetId = QUuid());
+
+    /**
+     * @brief Parse the next bytes of the response.
+     * @return false once the response isn't valid JSON.
+     */
+    bool feed(const QByteArray &data);
+    /**
+     * @brief Parse what is left at the end of the response.
+     * @return true if the response was a complete JSON document.
+     */
+    bool finish();
+
+    bool hasError() const { return m_error; }
+    QVector<Build> takeBuilds();
+
+private:
+    enum class Context : char
+    {
+        Builds,
+        Build,
+        Links,
+        Icon,
+        Artifacts,
+        Artifact,
+        Files,
+        File,
+        Other, // values the builds don't keep
+    };
+
+    enum class Expect : char
+    {
+        Value,
+        Key,
+        Colon,
+        Separator,
+        End,
+    };
+
+    struct Frame
+    {
+        Context context;
+        bool isObject;
+        int count; // elements opened, to keep the first file of an artifact
+    };
+
+    bool parse(bool atEnd);
+    const char* parseString(const char *begin, const char *end);
+    const char* parseScalar(const char *begin, const char *end, bool atEnd);
+    bool open(bool isObject);
+    bool close(bool isObject);
+    void valueParsed();
+    void setString(const char *begin, const char *end, bool escaped);
+    void setNumber(const char *begin, const char *end);
+    Context childContext(bool isObject);
+
+    static QString decode(const char *begin, const char *end, bool escaped);
+
+    QUuid m_buildTargetId;
+    QByteArray m_buffer;
+    QVector<Frame> m_frames;
+    Expect m_expect;
+    bool m_error;
+    QByteArray m_key; // key of the value being parsed in the innermost object
+    QVector<Build> m_builds;
+    Build m_build;
+    bool m_artifactChosen; // the primary artifact of the build went by
+    bool m_primaryArtifact;
+    bool m_hasFile;
+    QString m_fileName;
+    qint64 m_fileSize;
+    QString m_filePath;
+    QString m_fileMd5;
+};
+
+}
+
+#endif // UCD_BUILDLISTPARSER_H
@@ -24,6 +24,7 @@ BuildsModel::BuildsModel(QObject *parent)
 {
     auto *synchronizer = ServiceLocator::synchronizer();
     connect(synchronizer, &AbstractSynchronizer::downloadQueued, this, &BuildsModel::updateDownloadStatus);
+    connect(synchronizer, &AbstractSynchronizer::queueChanged, this, &BuildsModel::updateQueuePositions);
     connect(synchronizer, &AbstractSynchronizer::downloadStarted, this, &BuildsModel::updateDownloadStatus);
     connect(synchronizer, &AbstractSynchronizer::downloadUpdated, this, &BuildsModel::updateDownloadProgress);
     connect(synchronizer, &AbstractSynchronizer::downloadCompleted, this, &BuildsModel::updateDownloadStatus);
@@ -60,19 +61,30 @@ bool BuildsModel::updateBuild(int row, const Build &build)
     if (row >= m_builds.size())
         return false;
 
+    if (refreshRow(row, build))
+        BuildDao(ServiceLocator::database()).partialUpdate(m_builds.at(row));
+    return true;
+}
+
+void BuildsModel::addBuild(const Build &build)
+{
+    BuildDao(ServiceLocator::database()).addBuild(build);
+    insertBuild(build);
+}
+
+bool BuildsModel::refreshRow(int row, const Build &build)
+{
     auto &currentBuild = m_builds[row];
 
     if (currentBuild.isLike(build))
-        return true;
+        return false;
 
     currentBuild.takeFrom(build);
-
-    BuildDao(ServiceLocator::database()).partialUpdate(currentBuild);
     emit dataChanged(index(row), index(row));
     return true;
 }
 
-void BuildsModel::addBuild(const Build &build)
+void BuildsModel::insertBuild(const Build &build)
 {
     // we insert builds by descending build number
     auto insertIt = std::find_if(
@@ -83,7 +95,6 @@ void BuildsModel::addBuild(const Build &build)
     auto index = static_cast<int>(insertIt - std::begin(m_builds));
 
     beginInsertRows(QModelIndex(), index, index);
-    BuildDao(ServiceLocator::database()).addBuild(build);
     m_builds.insert(index, build);
     endInsertRows();
 }
@@ -129,6 +140,8 @@ QVariant BuildsModel::data(const QModelIndex &index, int role) const
         return QVariant::fromValue(ucd::BuildRef{build});
     case Roles::IsQueued:
         return ServiceLocator::synchronizer()->isQueued(build);
+    case Roles::QueuePosition:
+        return ServiceLocator::synchronizer()->queuePosition(build);
     case Roles::IsDownloading:
         return ServiceLocator::synchronizer()->isDownloading(build);
     case Roles::IsDownloaded:
@@ -202,6 +215,7 @@ QHash<int, QByteArray> BuildsModel::roleNames() const
     roles[Roles::ManualDownload] = "manualDownload";
     roles[Roles::BuildRef] = "buildRef";
     roles[Roles::IsQueued] = "isQueued";
+    roles[Roles::QueuePosition] = "queuePosition";
     roles[Roles::IsDownloading] = "isDownloading";
     roles[Roles::IsDownloaded] = "isDownloaded";
     roles[Roles::DownloadProgress] = "downloadProgress";
@@ -232,6 +246,13 @@ void BuildsModel::fetchMore(const QModelIndex &parent)
 
 void BuildsModel::onBuildsFetched(const QVector<Build> &builds)
 {
+    BuildDao(ServiceLocator::database()).upsertBuilds(builds);
+    mergeBuilds(builds);
+}
+
+void BuildsModel::mergeBuilds(const QVector<Build> &builds)
+{
+    // the stored builds are up to date, only the rows change
     int count = m_builds.size();
 
     while (count--)
@@ -251,7 +272,7 @@ void BuildsModel::onBuildsFetched(const QVector<Build> &builds)
         }
         else // update existing project
         {
-            updateBuild(count, *cloudBuildIt);
+            refreshRow(count, *cloudBuildIt);
         }
     }
 
@@ -264,7 +285,7 @@ void BuildsModel::onBuildsFetched(const QVector<Build> &builds)
                     std::end(m_builds),
                     [cloudId](const auto &project) -> bool { return project.id() == cloudId; }))
         {
-            addBuild(cloudBuild);
+            insertBuild(cloudBuild);
         }
     }
 }
@@ -303,10 +324,17 @@ void BuildsModel::updateDownloadProgress(const Build &build)
     }
 }
 
+void BuildsModel::updateQueuePositions()
+{
+    if (m_builds.isEmpty())
+        return;
+    emit dataChanged(index(0), index(m_builds.size() - 1), QVector<int>{ Roles::QueuePosition });
+}
+
 void BuildsModel::onSynchronized()
 {
     auto builds = BuildDao(ServiceLocator::database()).builds(m_buildTargetId);
-    onBuildsFetched(builds);
+    mergeBuilds(builds);
 }
 
 bool BuildsModel::isIndexValid(const QModelIndex &index) const
@@ -2,6 +2,8 @@
 
 #include "buildtarget.h"
 #include "builddao.h"
+#include "sqlhelpers.h"
+#include "cachedquery.h"
 
 #include <QVariant>
 #include <QSqlQuery>
@@ -18,8 +20,8 @@ void BuildTargetDao::init()
 {
     QSqlQuery query(m_db);
     if (!query.exec("CREATE TABLE IF NOT EXISTS BuildTargets ("
-               "buildTargetId TEXT PRIMARY KEY, "
-               "projectId TEXT, "
+               "buildTargetId BLOB PRIMARY KEY, "
+               "projectId BLOB, "
                "cloudId TEXT, "
                "name TEXT, "
                "platform TEXT, "
@@ -36,14 +38,14 @@ void BuildTargetDao::init()
 
 void BuildTargetDao::addBuildTarget(const BuildTarget &buildTarget)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("INSERT INTO BuildTargets ("
                   "buildTargetId, projectId, cloudId, name, platform, "
                   "sync, minBuilds, maxBuilds, maxDaysOld) "
                   "VALUES (:buildTargetId, :projectId, :cloudId, :name, :platform, "
                   ":sync, :minBuilds, :maxBuilds, :maxDaysOld)");
-    query.bindValue(":buildTargetId", buildTarget.id().toString());
-    query.bindValue(":projectId", buildTarget.projectId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildTarget.id()));
+    query.bindValue(":projectId", uuidToSql(buildTarget.projectId()));
     query.bindValue(":cloudId", buildTarget.cloudId());
     query.bindValue(":name", buildTarget.name());
     query.bindValue(":platform", buildTarget.platform());
@@ -61,13 +63,13 @@ void BuildTargetDao::addBuildTarget(const BuildTarget &buildTarget)
 
 void BuildTargetDao::updateBuildTarget(const BuildTarget &buildTarget)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("UPDATE BuildTargets SET name = :name, platform = :platform, "
                   "sync = :sync, minBuilds = :minBuilds, maxBuilds = :maxBuilds, maxDaysOld = :maxDaysOld "
                   "WHERE buildTargetId = :buildTargetId");
     query.bindValue(":name", buildTarget.name());
     query.bindValue(":platform", buildTarget.platform());
-    query.bindValue(":buildTargetId", buildTarget.id());
+    query.bindValue(":buildTargetId", uuidToSql(buildTarget.id()));
     query.bindValue(":sync", buildTarget.sync());
     query.bindValue(":minBuilds", buildTarget.minBuilds());
     query.bindValue(":maxBuilds", buildTarget.maxBuilds());
@@ -82,9 +84,9 @@ void BuildTargetDao::updateBuildTarget(const BuildTarget &buildTarget)
 
 void BuildTargetDao::removeBuildTarget(const QUuid &buildTargetId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM BuildTargets WHERE buildTargetId = :buildTargetId");
-    query.bindValue(":buildTargetId", buildTargetId.toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -98,7 +100,7 @@ void BuildTargetDao::removeBuildTarget(const QUuid &buildTargetId)
 QVector<BuildTarget> BuildTargetDao::buildTargets(const QUuid &projectId, bool includeBuilds)
 {
     QVector<BuildTarget> buildTargets;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     if (projectId.isNull())
     {
         query.exec("SELECT * FROM BuildTargets");
@@ -106,14 +108,14 @@ QVector<BuildTarget> BuildTargetDao::buildTargets(const QUuid &projectId, bool i
     else
     {
         query.prepare("SELECT * FROM BuildTargets WHERE projectId = :projectId");
-        query.bindValue(":projectId", projectId.toString());
+        query.bindValue(":projectId", uuidToSql(projectId));
         query.exec();
     }
     while (query.next())
     {
         BuildTarget buildTarget;
-        buildTarget.setId(query.value("buildTargetId").toString());
-        buildTarget.setProjectId(query.value("projectId").toString());
+        buildTarget.setId(uuidFromSql(query.value("buildTargetId")));
+        buildTarget.setProjectId(uuidFromSql(query.value("projectId")));
         buildTarget.setCloudId(query.value("cloudId").toString());
         buildTarget.setName(query.value("name").toString());
         buildTarget.setPlatform(query.value("platform").toString());
@@ -135,14 +137,19 @@ BuildTarget BuildTargetDao::buildTarget(const QUuid &buildTargetId, bool include
 {
     BuildTarget buildTarget;
 
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT * FROM BuildTargets WHERE buildTargetId = :buildTargetId");
-    query.bindValue(":buildTargetId", buildTargetId.toString());
-    query.exec();
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
     if (query.next())
     {
-        buildTarget.setId(query.value("buildTargetId").toString());
-        buildTarget.setProjectId(query.value("projectId").toString());
+        buildTarget.setId(uuidFromSql(query.value("buildTargetId")));
+        buildTarget.setProjectId(uuidFromSql(query.value("projectId")));
         buildTarget.setCloudId(query.value("cloudId").toString());
         buildTarget.setName(query.value("name").toString());
         buildTarget.setPlatform(query.value("platform").toString());
@@ -166,9 +173,9 @@ BuildTarget BuildTargetDao::buildTarget(const QUuid &buildTargetId, bool include
 
 bool BuildTargetDao::hasSynchedBuildTargets(const QUuid &projectId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT COUNT(*) WHERE EXISTS(SELECT 1 FROM BuildTargets WHERE projectId = :projectId AND sync = 1)");
-    query.bindValue(":projectId", projectId.toString());
+    query.bindValue(":projectId", uuidToSql(projectId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -185,13 +192,13 @@ bool BuildTargetDao::hasSynchedBuildTargets(const QUuid &projectId)
 
 void BuildTargetDao::removeBuildTargets(const QUuid &projectId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT buildTargetId FROM BuildTargets WHERE projectId = :projectId");
-    query.bindValue(":projectId", projectId.toString());
+    query.bindValue(":projectId", uuidToSql(projectId));
     query.exec();
     while (query.next())
     {
-        removeBuildTarget(query.value(0).toString());
+        removeBuildTarget(uuidFromSql(query.value(0)));
     }
 }
 
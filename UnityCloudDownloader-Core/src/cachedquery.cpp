@@ -0,0 +1,98 @@
+#include "cachedquery.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QVector>
+
+namespace ucd
+{
+
+enum
+{
+    MaxIdleStatements = 4, // per SQL text, more are only needed by nested queries
+};
+
+using Statements = QHash<QString, QVector<QSqlQuery>>;
+
+// connections are used by one thread each, the lock only guards the map
+static QMutex s_mutex;
+static QHash<QString, Statements> s_statements;
+
+static bool isCompiled(const QSqlQuery &query)
+{
+    if (!query.driver() || !query.driver()->isOpen())
+        return false;
+    const QVariant handle = query.result() ? query.result()->handle() : QVariant();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3_stmt*") != 0)
+        return false;
+    return *static_cast<void* const*>(handle.constData()) != nullptr;
+}
+
+CachedQuery::CachedQuery(const QSqlDatabase &database)
+    : QSqlQuery(database)
+    , m_connectionName(database.connectionName())
+{}
+
+CachedQuery::~CachedQuery()
+{
+    release();
+}
+
+bool CachedQuery::prepare(const QString &sql)
+{
+    release();
+
+    {
+        QMutexLocker locker(&s_mutex);
+        auto &idle = s_statements[m_connectionName][sql];
+        while (!idle.isEmpty())
+        {
+            QSqlQuery statement = idle.takeLast();
+            // closing the connection finalized the statement, it must be prepared again
+            if (!isCompiled(statement))
+                continue;
+            QSqlQuery::operator=(statement);
+            m_sql = sql;
+            return true;
+        }
+    }
+
+    if (!QSqlQuery::prepare(sql))
+        return false;
+    m_sql = sql;
+    return true;
+}
+
+void CachedQuery::clear(const QString &connectionName)
+{
+    Statements statements;
+    {
+        QMutexLocker locker(&s_mutex);
+        statements = s_statements.take(connectionName);
+    }
+    // the statements are finalized outside the lock
+    statements.clear();
+}
+
+void CachedQuery::release()
+{
+    if (m_sql.isEmpty())
+        return;
+
+    finish();
+    QMutexLocker locker(&s_mutex);
+    auto connectionIt = s_statements.find(m_connectionName);
+    // the connection was cleared while the query ran
+    if (connectionIt != s_statements.end())
+    {
+        auto &idle = (*connectionIt)[m_sql];
+        if (idle.size() < MaxIdleStatements)
+            idle.append(*this);
+    }
+    m_sql.clear();
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef UCD_CACHEDQUERY_H
+#define UCD_CACHEDQUERY_H
+
+#pragma once
+
+#include <QSqlQuery>
+#include <QString>
+
+class QSqlDatabase;
+
+namespace ucd
+{
+
+/**
+ * @brief A query whose prepared statements are reused.
+ *
+ * The statements are cached per connection and keyed by their SQL text.
+ * prepare takes a compiled statement from the cache when one is free, it
+ * goes back to the cache when the query is destroyed or prepared again, so
+ * only the parameters need binding. Statements finalized by closing their
+ * connection are dropped on reuse. Queries run with exec(sql) aren't cached.
+ */
+class CachedQuery : public QSqlQuery
+{
+public:
+    explicit CachedQuery(const QSqlDatabase &database);
+    ~CachedQuery();
+
+    CachedQuery(const CachedQuery&) = delete;
+    CachedQuery& operator=(const CachedQuery&) = delete;
+
+    bool prepare(const QString &sql);
+
+    /**
+     * @brief Drop the statements of a connection, call it before removing the connection.
+     */
+    static void clear(const QString &connectionName);
+
+private:
+    void release();
+
+    QString m_connectionName;
+    QString m_sql; // statement to give back to the cache, empty if none
+};
+
+}
+
+#endif // UCD_CACHEDQUERY_H
@@ -0,0 +1,116 @@
+#include "contentstore.h"
+
+#include "filesystem.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+namespace ucd
+{
+
+enum
+{
+    CopySize = 1024 * 1024,
+};
+
+ContentStore::ContentStore(const QString &rootPath)
+    : m_path(QDir(rootPath).filePath(QStringLiteral(".store")))
+{}
+
+bool ContentStore::add(const QString &filePath, const QByteArray &digest) const
+{
+    if (!isEnabled())
+        return false;
+
+    const QString blob = blobPath(digest, QFile::permissions(filePath));
+    QDir().mkpath(QFileInfo(blob).path());
+
+    // new content, the file itself becomes the stored copy
+    if (createHardLink(filePath, blob))
+        return true;
+    if (!QFile::exists(blob))
+        return false;
+
+    // the content is already stored, the file is replaced by a link to it
+    const QString linkPath = filePath + QStringLiteral(".link");
+    QFile::remove(linkPath);
+    if (!createHardLink(blob, linkPath))
+        return false;
+    if (!QFile::remove(filePath) || !QFile::rename(linkPath, filePath))
+    {
+        QFile::remove(linkPath);
+        return false;
+    }
+    return true;
+}
+
+bool ContentStore::setPermissions(const QString &filePath, QFileDevice::Permissions permissions) const
+{
+    if (QFile::permissions(filePath) == permissions)
+        return true;
+    if (hardLinkCount(filePath) <= 1)
+        return QFile::setPermissions(filePath, permissions);
+
+    // the inode is shared with a blob and other builds, only this path gets the new permissions
+    const QString copyPath = filePath + QStringLiteral(".copy");
+    QFile::remove(copyPath);
+    QFile source(filePath);
+    QFile copy(copyPath);
+    if (!source.open(QIODevice::ReadOnly) || !copy.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray buffer(CopySize, Qt::Uninitialized);
+    QCryptographicHash hash(algorithm());
+    forever
+    {
+        qint64 count = source.read(buffer.data(), buffer.size());
+        if (count == 0)
+            break;
+        if (count < 0 || copy.write(buffer.constData(), count) != count)
+        {
+            copy.remove();
+            return false;
+        }
+        hash.addData(buffer.constData(), static_cast<int>(count));
+    }
+    source.close();
+    copy.close();
+
+    if (!copy.setPermissions(permissions) || !QFile::remove(filePath) || !copy.rename(filePath))
+    {
+        copy.remove();
+        return false;
+    }
+    add(filePath, hash.result());
+    return true;
+}
+
+qint64 ContentStore::collectGarbage() const
+{
+    if (!isEnabled())
+        return 0;
+
+    // a blob linked only from the store is not part of any build anymore
+    qint64 reclaimed = 0;
+    QDirIterator it(m_path, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        const QString blob = it.next();
+        if (hardLinkCount(blob) != 1)
+            continue;
+        qint64 size = it.fileInfo().size();
+        if (QFile::remove(blob))
+            reclaimed += size;
+    }
+    return reclaimed;
+}
+
+QString ContentStore::blobPath(const QByteArray &digest, QFileDevice::Permissions permissions) const
+{
+    const QString hex = QString::fromLatin1(digest.toHex());
+    return QStringLiteral("%1/%2/%3-%4").arg(m_path, hex.left(2), hex, QString::number(static_cast<int>(permissions), 16));
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef UCD_CONTENTSTORE_H
+#define UCD_CONTENTSTORE_H
+
+#pragma once
+
+#include <QString>
+#include <QCryptographicHash>
+#include <QFileDevice>
+
+namespace ucd
+{
+
+/**
+ * @brief Content addressed store shared by the builds of a profile.
+ *
+ * Extracted files are hard linked to a blob named after their SHA-256, so
+ * identical files of different builds take the disk space only once. Blobs
+ * live in a hidden folder of the profile root, which keeps them on the same
+ * volume as the builds. Blobs are keyed by the permissions of the file too,
+ * since every link shares them. A default constructed store is disabled.
+ */
+class ContentStore
+{
+public:
+    ContentStore() = default;
+    explicit ContentStore(const QString &rootPath);
+
+    static QCryptographicHash::Algorithm algorithm() { return QCryptographicHash::Sha256; }
+
+    bool isEnabled() const { return !m_path.isEmpty(); }
+    const QString& path() const { return m_path; }
+
+    /**
+     * @brief Share a file with its stored copy, or store it if it is new.
+     * @return false if the file stays a regular copy.
+     */
+    bool add(const QString &filePath, const QByteArray &digest) const;
+    /**
+     * @brief Change the permissions of a file without changing the files it is linked to.
+     *
+     * A linked file gets its own copy first, which is stored again under its new permissions.
+     * @return false if the permissions can't be changed.
+     */
+    bool setPermissions(const QString &filePath, QFileDevice::Permissions permissions) const;
+    /**
+     * @brief Remove the blobs no build links to anymore.
+     * @return the number of bytes reclaimed.
+     */
+    qint64 collectGarbage() const;
+
+private:
+    QString blobPath(const QByteArray &digest, QFileDevice::Permissions permissions) const;
+
+    QString m_path;
+};
+
+}
+
+#endif // UCD_CONTENTSTORE_H
@@ -5,9 +5,16 @@
 #include "buildtargetdao.h"
 #include "builddao.h"
 #include "downloadsdao.h"
+#include "settingsdao.h"
+#include "responsecachedao.h"
+#include "cachedquery.h"
+#include "schemamigrations.h"
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QThreadStorage>
 #include <QUuid>
 #include <QVariant>
 #include <QDir>
@@ -15,13 +22,52 @@
 namespace ucd
 {
 
+/**
+ * @brief Removes the connection of a thread when the thread finishes.
+ */
+class ThreadConnection
+{
+public:
+    explicit ThreadConnection(QString name)
+        : name(std::move(name))
+    {}
+    ~ThreadConnection()
+    {
+        CachedQuery::clear(name);
+        QSqlDatabase::removeDatabase(name);
+    }
+
+    const QString name;
+};
+
 class DatabasePrivate
 {
 public:
     QString storagePath;
     QString connectionName;
+    QThreadStorage<ThreadConnection*> threadConnections;
 };
 
+static QSqlDatabase addConnection(const QString &filePath, const QString &connectionName)
+{
+    auto database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    database.setDatabaseName(filePath);
+    // writers of other threads hold the lock briefly, wait for them instead of failing
+    database.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    return database;
+}
+
+static void configure(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    // with the write-ahead log, commits only sync on checkpoints
+    for (const char *pragma : {"PRAGMA synchronous = NORMAL", "PRAGMA temp_store = MEMORY"})
+    {
+        if (!query.exec(pragma))
+            qWarning("%s: %s", pragma, query.lastError().text().toUtf8().data());
+    }
+}
+
 Database::Database(const QString &storagePath, QObject *parent)
     : QObject(parent)
     , p(std::make_unique<DatabasePrivate>())
@@ -29,16 +75,22 @@ Database::Database(const QString &storagePath, QObject *parent)
     auto filePath = QDir(storagePath).filePath("data.sqlite");
     p->storagePath = filePath;
     p->connectionName = QUuid::createUuid().toString();
-    auto database = QSqlDatabase::addDatabase("QSQLITE", p->connectionName);
-    database.setDatabaseName(filePath);
+    auto database = addConnection(filePath, p->connectionName);
     if (!database.open())
     {
         throw std::runtime_error("Cannot open database");
     }
+
+    // the journal mode is stored in the file, readers then no longer wait for writers
+    QSqlQuery query(database);
+    if (!query.exec("PRAGMA journal_mode = WAL"))
+        qWarning("Cannot enable the write-ahead log: %s", query.lastError().text().toUtf8().data());
+    configure(database);
 }
 
 Database::~Database()
 {
+    CachedQuery::clear(p->connectionName);
     auto database = QSqlDatabase::database(p->connectionName);
     database.close();
 }
@@ -51,6 +103,9 @@ void Database::init()
     BuildTargetDao(database).init();
     BuildDao(database).init();
     DownloadsDao(database).init();
+    SettingsDao(database).init();
+    ResponseCacheDao(database).init();
+    migrateSchema(database);
 }
 
 bool Database::hasProfiles() const
@@ -70,11 +125,32 @@ QSqlDatabase Database::sqlDatabase()
     return QSqlDatabase::database(p->connectionName);
 }
 
-QSqlDatabase Database::sqlDatabase(const QString &newConnectionName)
+QSqlDatabase Database::threadDatabase()
 {
-    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", newConnectionName);
-    db.setDatabaseName(p->storagePath);
-    return db;
+    if (QThread::currentThread() == thread())
+        return sqlDatabase();
+
+    if (!p->threadConnections.hasLocalData())
+    {
+        const QString connectionName = QUuid::createUuid().toString();
+        bool opened;
+        {
+            auto database = addConnection(p->storagePath, connectionName);
+            opened = database.open();
+            if (opened)
+                configure(database);
+            else
+                qCritical("Cannot open database connection: %s", database.lastError().text().toUtf8().data());
+        }
+        if (!opened)
+        {
+            QSqlDatabase::removeDatabase(connectionName);
+            return {};
+        }
+        p->threadConnections.setLocalData(new ThreadConnection(connectionName));
+    }
+
+    return QSqlDatabase::database(p->threadConnections.localData()->name);
 }
 
 }
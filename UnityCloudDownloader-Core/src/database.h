@@ -30,7 +30,7 @@ public:
     bool hasProfiles() const override;
 
     QSqlDatabase sqlDatabase() override;
-    QSqlDatabase sqlDatabase(const QString &newConnectionName) override;
+    QSqlDatabase threadDatabase() override;
 
 private:
     std::unique_ptr<DatabasePrivate> p;
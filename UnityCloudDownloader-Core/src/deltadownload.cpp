@@ -0,0 +1,538 @@
+#include "deltadownload.h"
+
+#include "bandwidthlimiter.h"
+#include "filesystem.h"
+#include "zipformat.h"
+#include "zipstreamextractor.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <zlib.h>
+
+namespace ucd
+{
+
+enum
+{
+    ReadSize = 256 * 1024,
+    CopySize = 1024 * 1024,
+    ParallelRanges = 4,
+    MaxRangeGap = 256 * 1024,
+    MaxFetchPercent = 75,
+    MinReadBufferSize = 64 * 1024,
+    MaxReadBufferSize = 4 * 1024 * 1024,
+};
+
+DeltaDownload::DeltaDownload(QNetworkAccessManager *network,
+                             BandwidthLimiter *bandwidthLimiter,
+                             Build build,
+                             QString seedPath,
+                             QString storagePath,
+                             ContentStore store,
+                             QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+    , m_bandwidthLimiter(bandwidthLimiter)
+    , m_throttleTimer(new QTimer(this))
+    , m_build(std::move(build))
+    , m_seedPath(std::move(seedPath))
+    , m_storagePath(std::move(storagePath))
+    , m_store(std::move(store))
+    , m_buffer(ReadSize, Qt::Uninitialized)
+    , m_directory{0, 0, 0}
+    , m_seedsCopied(false)
+    , m_nextRange(0)
+    , m_receivedBytes(0)
+    , m_totalBytes(0)
+    , m_finished(false)
+{
+    m_throttleTimer->setSingleShot(true);
+    m_throttleTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_throttleTimer, &QTimer::timeout, this, &DeltaDownload::onThrottleElapsed);
+    connect(&m_matchWatcher, &QFutureWatcher<bool>::finished, this, &DeltaDownload::onSeedMatched);
+    connect(&m_copyWatcher, &QFutureWatcher<bool>::finished, this, &DeltaDownload::onSeedCopied);
+}
+
+DeltaDownload::~DeltaDownload()
+{
+    m_matchWatcher.cancel();
+    m_matchWatcher.waitForFinished();
+    m_copyWatcher.cancel();
+    m_copyWatcher.waitForFinished();
+    for (auto &range : m_ranges)
+    {
+        auto *reply = range.reply;
+        range.reply = nullptr;
+        if (reply != nullptr)
+        {
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+}
+
+void DeltaDownload::start()
+{
+    // the end of the archive tells where its central directory is
+    const qint64 artifactSize = m_build.artifactSize();
+    auto *reply = requestRange(std::max<qint64>(artifactSize - ZipArchive::tailSize(), 0), artifactSize);
+    connect(reply, &QNetworkReply::finished, this, &DeltaDownload::onTailFinished);
+}
+
+void DeltaDownload::onTailFinished()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+    if (m_finished)
+        return;
+
+    const qint64 artifactSize = m_build.artifactSize();
+    const qint64 tailOffset = std::max<qint64>(artifactSize - ZipArchive::tailSize(), 0);
+    if (reply->error() || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+    {
+        fail(QStringLiteral("the server doesn't accept ranges"));
+        return;
+    }
+    emit firstByteReceived();
+
+    const QByteArray tail = reply->readAll();
+    if (tail.size() != artifactSize - tailOffset || !ZipArchive::readDirectory(tail, &m_directory))
+    {
+        fail(QStringLiteral("the artifact has no central directory"));
+        return;
+    }
+    if (m_directory.offset + m_directory.size > static_cast<quint64>(artifactSize))
+    {
+        fail(QStringLiteral("the central directory is out of the artifact"));
+        return;
+    }
+
+    if (m_directory.offset >= static_cast<quint64>(tailOffset))
+    {
+        readEntries(tail.mid(static_cast<int>(m_directory.offset - tailOffset), static_cast<int>(m_directory.size)));
+    }
+    else
+    {
+        auto *directoryReply = requestRange(static_cast<qint64>(m_directory.offset), static_cast<qint64>(m_directory.offset + m_directory.size));
+        connect(directoryReply, &QNetworkReply::finished, this, &DeltaDownload::onDirectoryFinished);
+    }
+}
+
+void DeltaDownload::onDirectoryFinished()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+    if (m_finished)
+        return;
+
+    if (reply->error() || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+    {
+        fail(QStringLiteral("cannot fetch the central directory"));
+        return;
+    }
+
+    readEntries(reply->readAll());
+}
+
+void DeltaDownload::onSeedMatched()
+{
+    if (m_finished)
+        return;
+
+    planRanges(m_matchWatcher.future().results().toVector());
+}
+
+void DeltaDownload::onSeedCopied()
+{
+    if (m_finished)
+        return;
+
+    const auto copied = m_copyWatcher.future().results();
+    if (!std::all_of(std::begin(copied), std::end(copied), [](bool success) -> bool { return success; }))
+    {
+        fail(QStringLiteral("a seed file changed while it was copied"));
+        return;
+    }
+    m_seedsCopied = true;
+    completeIfDone();
+}
+
+void DeltaDownload::onRangeReadyRead()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    int index = rangeIndex(reply);
+    if (index < 0 || m_finished)
+        return;
+
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+    {
+        fail(QStringLiteral("the server ignored the range"));
+        return;
+    }
+
+    readRange(index);
+}
+
+void DeltaDownload::onRangeFinished()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    int index = rangeIndex(reply);
+    if (index < 0)
+    {
+        reply->deleteLater();
+        return;
+    }
+
+    readRange(index);
+}
+
+void DeltaDownload::onThrottleElapsed()
+{
+    for (int i = 0, end = static_cast<int>(m_ranges.size()); i < end && !m_finished; ++i)
+    {
+        if (m_ranges[static_cast<size_t>(i)].reply != nullptr)
+            readRange(i);
+    }
+}
+
+QNetworkReply* DeltaDownload::requestRange(qint64 offset, qint64 end)
+{
+    QNetworkRequest request(m_build.artifactPath());
+    request.setRawHeader("Range", QByteArray("bytes=") + QByteArray::number(offset) + '-' + QByteArray::number(end - 1));
+    return m_network->get(request);
+}
+
+void DeltaDownload::readEntries(const QByteArray &records)
+{
+    QString error = ZipArchive::readEntries(records, m_directory.entryCount, &m_entries);
+    if (!error.isEmpty())
+    {
+        fail(error);
+        return;
+    }
+
+    m_files.clear();
+    for (const auto &entry : m_entries)
+    {
+        if (!entry.isDirectory())
+            m_files.append(entry);
+    }
+
+    // the seed is only read to find the unchanged files, nothing is written before the plan is accepted
+    const QString seedPath = m_seedPath;
+    std::function<bool(const ZipArchive::Entry&)> matchSeed = [seedPath](const ZipArchive::Entry &entry) -> bool
+    {
+        QFile seed(QDir(seedPath).filePath(entry.path));
+        if (!seed.open(QIODevice::ReadOnly) || static_cast<quint64>(seed.size()) != entry.uncompressedSize)
+            return false;
+
+        QByteArray buffer(CopySize, Qt::Uninitialized);
+        quint32 crc = crc32(0, Z_NULL, 0);
+        forever
+        {
+            qint64 count = seed.read(buffer.data(), buffer.size());
+            if (count == 0)
+                break;
+            if (count < 0)
+                return false;
+            crc = crc32(crc, reinterpret_cast<const Bytef*>(buffer.constData()), static_cast<uInt>(count));
+        }
+        return crc == entry.crc;
+    };
+    m_matchWatcher.setFuture(QtConcurrent::mapped(m_files, matchSeed));
+}
+
+void DeltaDownload::copySeeds(const QVector<bool> &reused)
+{
+    // folders are created upfront so the tasks never race on them
+    QDir destination(m_storagePath);
+    for (const auto &entry : m_entries)
+    {
+        destination.mkpath(entry.isDirectory() ? entry.path : QFileInfo(destination.filePath(entry.path)).path());
+    }
+
+    // unchanged entries inside a fetched range are extracted from it, only the others are copied
+    QVector<ZipArchive::Entry> files;
+    for (int i = 0, end = m_files.size(); i < end; ++i)
+    {
+        if (i >= reused.size() || !reused.at(i))
+            continue;
+
+        const qint64 offset = static_cast<qint64>(m_files.at(i).localHeaderOffset);
+        auto rangeIt = std::find_if(std::begin(m_ranges), std::end(m_ranges), [offset](const Range &range) -> bool
+        {
+            return offset >= range.offset && offset < range.end;
+        });
+        if (rangeIt == std::end(m_ranges))
+            files.append(m_files.at(i));
+    }
+    if (files.isEmpty())
+    {
+        m_seedsCopied = true;
+        return;
+    }
+
+    // the crc is checked again while copying in case the seed changed since it was matched.
+    // with a content store the seed is only read, then linked once its crc matched
+    const QString seedPath = m_seedPath;
+    const QString storagePath = m_storagePath;
+    const ContentStore store = m_store;
+    std::function<bool(const ZipArchive::Entry&)> copySeed = [seedPath, storagePath, store](const ZipArchive::Entry &entry) -> bool
+    {
+        QFile seed(QDir(seedPath).filePath(entry.path));
+        if (!seed.open(QIODevice::ReadOnly) || static_cast<quint64>(seed.size()) != entry.uncompressedSize)
+            return false;
+
+        // the destination may be a link shared with the store, it is replaced rather than rewritten
+        QFile out(QDir(storagePath).filePath(entry.path));
+        out.remove();
+        const bool linking = store.isEnabled();
+        if (!linking && !out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+
+        QByteArray buffer(CopySize, Qt::Uninitialized);
+        QCryptographicHash hash(ContentStore::algorithm());
+        quint32 crc = crc32(0, Z_NULL, 0);
+        forever
+        {
+            qint64 count = seed.read(buffer.data(), buffer.size());
+            if (count == 0)
+                break;
+            if (count < 0 || (!linking && out.write(buffer.constData(), count) != count))
+            {
+                out.remove();
+                return false;
+            }
+            crc = crc32(crc, reinterpret_cast<const Bytef*>(buffer.constData()), static_cast<uInt>(count));
+            if (linking)
+                hash.addData(buffer.constData(), static_cast<int>(count));
+        }
+
+        if (crc != entry.crc)
+        {
+            out.remove();
+            return false;
+        }
+        if (!linking)
+            return true;
+
+        // the seed may predate the store, it is added along with its new link
+        seed.close();
+        out.remove();
+        if (!createHardLink(seed.fileName(), out.fileName()) && !QFile::copy(seed.fileName(), out.fileName()))
+            return false;
+        store.add(out.fileName(), hash.result());
+        return true;
+    };
+    m_copyWatcher.setFuture(QtConcurrent::mapped(files, copySeed));
+}
+
+void DeltaDownload::planRanges(const QVector<bool> &reused)
+{
+    // every entry ends where the next one starts, the last one at the central directory
+    QVector<quint64> starts;
+    starts.reserve(m_entries.size());
+    for (const auto &entry : m_entries)
+    {
+        starts.append(entry.localHeaderOffset);
+    }
+    std::sort(std::begin(starts), std::end(starts));
+
+    QVector<QPair<qint64, qint64>> spans;
+    for (int i = 0, end = m_files.size(); i < end; ++i)
+    {
+        if (i < reused.size() && reused.at(i))
+            continue;
+
+        const quint64 offset = m_files.at(i).localHeaderOffset;
+        auto nextIt = std::upper_bound(std::begin(starts), std::end(starts), offset);
+        const quint64 entryEnd = nextIt == std::end(starts) ? m_directory.offset : *nextIt;
+        spans.append(qMakePair(static_cast<qint64>(offset), static_cast<qint64>(entryEnd)));
+    }
+    std::sort(std::begin(spans), std::end(spans));
+
+    // close changed entries are fetched together, the unchanged ones in between are extracted again
+    m_ranges.clear();
+    m_totalBytes = 0;
+    for (const auto &span : spans)
+    {
+        if (!m_ranges.empty() && span.first - m_ranges.back().end <= MaxRangeGap)
+        {
+            m_totalBytes += std::max<qint64>(span.second - m_ranges.back().end, 0);
+            m_ranges.back().end = std::max(m_ranges.back().end, span.second);
+        }
+        else
+        {
+            m_totalBytes += span.second - span.first;
+            m_ranges.push_back(Range{nullptr, span.first, span.second, nullptr, false});
+        }
+    }
+
+    if (m_totalBytes * 100 > m_build.artifactSize() * MaxFetchPercent)
+    {
+        fail(QStringLiteral("only %1% of the artifact can be reused").arg(100 - (m_totalBytes * 100) / m_build.artifactSize()));
+        return;
+    }
+
+    qInfo("Delta download of %s fetches %lld of %lld bytes in %d ranges",
+          m_build.artifactName().toUtf8().data(), m_totalBytes, m_build.artifactSize(), static_cast<int>(m_ranges.size()));
+    // the copied files and the fetched ranges never overlap, so both run at once
+    copySeeds(reused);
+    if (m_ranges.empty())
+    {
+        completeIfDone();
+        return;
+    }
+
+    for (m_nextRange = 0; m_nextRange < static_cast<int>(m_ranges.size()) && m_nextRange < ParallelRanges; ++m_nextRange)
+    {
+        startRange(m_nextRange);
+    }
+}
+
+void DeltaDownload::startRange(int index)
+{
+    auto &range = m_ranges[static_cast<size_t>(index)];
+    range.extractor = std::make_unique<ZipStreamExtractor>(m_storagePath, m_store);
+    range.reply = requestRange(range.offset, range.end);
+    connect(range.reply, &QNetworkReply::readyRead, this, &DeltaDownload::onRangeReadyRead);
+    connect(range.reply, &QNetworkReply::finished, this, &DeltaDownload::onRangeFinished);
+}
+
+void DeltaDownload::readRange(int index)
+{
+    auto &range = m_ranges[static_cast<size_t>(index)];
+    auto *reply = range.reply;
+
+    // a bounded read buffer makes the socket stop reading, so throttling pushes back on the sender
+    const qint64 rate = m_bandwidthLimiter->rate();
+    const qint64 readBufferSize = rate == 0 ? 0 : qBound<qint64>(MinReadBufferSize, rate / 4, MaxReadBufferSize);
+    if (reply->readBufferSize() != readBufferSize)
+        reply->setReadBufferSize(readBufferSize);
+
+    while (range.offset < range.end)
+    {
+        qint64 available = std::min<qint64>(reply->bytesAvailable(), m_buffer.size());
+        if (available <= 0)
+            break;
+
+        qint64 granted = m_bandwidthLimiter->acquire(available);
+        if (granted == 0)
+        {
+            if (!m_throttleTimer->isActive())
+                m_throttleTimer->start(m_bandwidthLimiter->delay(available));
+            return;
+        }
+
+        qint64 bytesRead = reply->read(m_buffer.data(), granted);
+        if (bytesRead <= 0)
+            break;
+
+        qint64 count = std::min(bytesRead, range.end - range.offset);
+        if (!range.extractor->write(m_buffer.constData(), count))
+        {
+            fail(range.extractor->errorString());
+            return;
+        }
+        range.offset += count;
+        m_receivedBytes += count;
+    }
+
+    if (!reply->isFinished() || (reply->bytesAvailable() > 0 && range.offset < range.end))
+        return;
+
+    range.reply = nullptr;
+    range.done = true;
+    reply->deleteLater();
+    if (range.offset < range.end || !range.extractor->atEntryBoundary())
+    {
+        fail(reply->error() ? reply->errorString() : QStringLiteral("a range ended early"));
+        return;
+    }
+    range.extractor = nullptr;
+
+    if (m_nextRange < static_cast<int>(m_ranges.size()))
+    {
+        startRange(m_nextRange++);
+    }
+    else
+    {
+        completeIfDone();
+    }
+}
+
+int DeltaDownload::rangeIndex(const QNetworkReply *reply) const
+{
+    if (reply == nullptr)
+        return -1;
+
+    for (int i = 0, end = static_cast<int>(m_ranges.size()); i < end; ++i)
+    {
+        if (m_ranges[static_cast<size_t>(i)].reply == reply)
+            return i;
+    }
+    return -1;
+}
+
+void DeltaDownload::completeIfDone()
+{
+    if (m_seedsCopied && std::all_of(std::begin(m_ranges), std::end(m_ranges), [](const Range &range) -> bool { return range.done; }))
+        complete();
+}
+
+void DeltaDownload::complete()
+{
+    // the ranges stop before the central directory, the unix modes come from its entries
+    for (const auto &entry : m_files)
+    {
+        QString error = entry.unixMode != 0 ? zip::applyUnixMode(m_storagePath, entry.path, entry.unixMode, m_store) : QString();
+        if (!error.isEmpty())
+        {
+            fail(error);
+            return;
+        }
+    }
+
+    m_finished = true;
+    m_throttleTimer->stop();
+    emit finished(true);
+}
+
+void DeltaDownload::fail(const QString &reason)
+{
+    if (m_finished)
+        return;
+
+    qInfo("Delta download of %s is not possible, %s", m_build.artifactName().toUtf8().data(), reason.toUtf8().data());
+    m_finished = true;
+    m_throttleTimer->stop();
+    // nothing writes to the build folder once the failure is reported, so it can be cleared
+    m_matchWatcher.cancel();
+    m_copyWatcher.cancel();
+    m_matchWatcher.waitForFinished();
+    m_copyWatcher.waitForFinished();
+    for (auto &range : m_ranges)
+    {
+        auto *reply = range.reply;
+        range.reply = nullptr;
+        range.extractor = nullptr;
+        if (reply != nullptr)
+        {
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+    emit finished(false);
+}
+
+}
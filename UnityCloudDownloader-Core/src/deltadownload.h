@@ -0,0 +1,116 @@
+#ifndef UCD_DELTADOWNLOAD_H
+#define UCD_DELTADOWNLOAD_H
+
+#pragma once
+
+#include "build.h"
+#include "contentstore.h"
+#include "ziparchive.h"
+
+#include <memory>
+#include <vector>
+
+#include <QObject>
+#include <QFutureWatcher>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+namespace ucd
+{
+
+class BandwidthLimiter;
+class ZipStreamExtractor;
+
+/**
+ * @brief Downloads a ZIP artifact by reusing the files of a previous build.
+ *
+ * The central directory of the new artifact is fetched first. Entries whose
+ * file is found unchanged in the seed folder, same size and CRC-32, are copied
+ * from there. Only the byte ranges of the other entries are requested, and
+ * they are extracted as they arrive. The seed is only read until the plan is
+ * accepted, nothing is written if it can't save enough of the transfer and
+ * the caller then downloads the whole artifact.
+ * With an enabled content store, unchanged files are hard linked instead of
+ * copied.
+ */
+class DeltaDownload : public QObject
+{
+    Q_OBJECT
+public:
+    DeltaDownload(QNetworkAccessManager *network,
+                  BandwidthLimiter *bandwidthLimiter,
+                  Build build,
+                  QString seedPath,
+                  QString storagePath,
+                  ContentStore store,
+                  QObject *parent = nullptr);
+    ~DeltaDownload() override;
+
+    void start();
+
+    qint64 receivedBytes() const { return m_receivedBytes; }
+    qint64 totalBytes() const { return m_totalBytes; }
+
+signals:
+    void finished(bool success);
+    /**
+     * @brief The server answered the first request, the directory is on its way.
+     */
+    void firstByteReceived();
+
+private slots:
+    void onTailFinished();
+    void onDirectoryFinished();
+    void onSeedMatched();
+    void onSeedCopied();
+    void onRangeReadyRead();
+    void onRangeFinished();
+    void onThrottleElapsed();
+
+private:
+    struct Range
+    {
+        QNetworkReply *reply;
+        qint64 offset; // next byte expected
+        qint64 end; // one past the last byte of the range
+        std::unique_ptr<ZipStreamExtractor> extractor;
+        bool done;
+    };
+
+    QNetworkReply* requestRange(qint64 offset, qint64 end);
+    void readEntries(const QByteArray &records);
+    void planRanges(const QVector<bool> &reused);
+    void copySeeds(const QVector<bool> &reused);
+    void startRange(int index);
+    void readRange(int index);
+    int rangeIndex(const QNetworkReply *reply) const;
+    void completeIfDone();
+    void complete();
+    void fail(const QString &reason);
+
+    QNetworkAccessManager *m_network;
+    BandwidthLimiter *m_bandwidthLimiter;
+    QTimer *m_throttleTimer;
+    Build m_build;
+    QString m_seedPath;
+    QString m_storagePath;
+    ContentStore m_store;
+    QByteArray m_buffer;
+    ZipArchive::Directory m_directory;
+    QVector<ZipArchive::Entry> m_entries;
+    QVector<ZipArchive::Entry> m_files;
+    QFutureWatcher<bool> m_matchWatcher;
+    QFutureWatcher<bool> m_copyWatcher;
+    bool m_seedsCopied;
+    std::vector<Range> m_ranges;
+    int m_nextRange;
+    qint64 m_receivedBytes;
+    qint64 m_totalBytes;
+    bool m_finished;
+};
+
+}
+
+#endif // UCD_DELTADOWNLOAD_H
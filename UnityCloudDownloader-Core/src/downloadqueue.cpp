@@ -0,0 +1,156 @@
+#include "downloadqueue.h"
+
+#include "build.h"
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+
+namespace ucd
+{
+
+bool DownloadQueue::Entry::operator<(const Entry &other) const
+{
+    return std::make_tuple(static_cast<int>(priority), round, order, sequence)
+            < std::make_tuple(static_cast<int>(other.priority), other.round, other.order, other.sequence);
+}
+
+DownloadQueue::DownloadQueue()
+    : m_servedRounds{}
+    , m_policy(Policy::NewestFirst)
+    , m_sequence(0)
+{}
+
+DownloadQueue::Policy DownloadQueue::parsePolicy(const QString &value)
+{
+    if (value.compare(QLatin1String("smallest"), Qt::CaseInsensitive) == 0)
+        return Policy::SmallestFirst;
+    if (!value.isEmpty() && value.compare(QLatin1String("newest"), Qt::CaseInsensitive) != 0)
+        qWarning("Unknown download queue policy %s", value.toUtf8().data());
+    return Policy::NewestFirst;
+}
+
+void DownloadQueue::setPolicy(Policy policy)
+{
+    if (policy == m_policy)
+        return;
+
+    m_policy = policy;
+    std::set<Entry> entries;
+    entries.swap(m_entries);
+    m_index.clear();
+    for (auto entry : entries)
+    {
+        entry.order = orderOf(entry);
+        insert(entry);
+    }
+}
+
+bool DownloadQueue::push(const Build &build, Priority priority)
+{
+    BuildRef buildRef(build);
+    if (contains(buildRef))
+        return false;
+
+    const QUuid targetId = build.buildTargetId();
+    if (priority == Priority::Latest)
+    {
+        // a target has a single latest build, the older one waits with the backfill
+        auto latestIt = m_latest.find(targetId);
+        if (latestIt != m_latest.end() && latestIt.value().buildNumber() > build.id())
+        {
+            priority = Priority::Backfill;
+        }
+        else if (latestIt != m_latest.end())
+        {
+            Entry demoted = *m_index.value(latestIt.value());
+            erase(m_index.value(latestIt.value()));
+            demoted.priority = Priority::Backfill;
+            auto &rounds = m_targetRounds[static_cast<int>(Priority::Backfill)];
+            demoted.round = std::max(rounds.value(targetId), m_servedRounds[static_cast<int>(Priority::Backfill)]);
+            rounds[targetId] = demoted.round + 1;
+            demoted.order = orderOf(demoted);
+            insert(demoted);
+        }
+        if (priority == Priority::Latest)
+            m_latest.insert(targetId, buildRef);
+    }
+
+    Entry entry;
+    entry.build = buildRef;
+    entry.priority = priority;
+    entry.round = 0;
+    entry.sequence = m_sequence++;
+    entry.createTime = build.createTime().toMSecsSinceEpoch();
+    entry.size = build.artifactSize();
+    // manual downloads are served in request order, the others take turns per target
+    if (priority != Priority::Manual)
+    {
+        auto &rounds = m_targetRounds[static_cast<int>(priority)];
+        entry.round = std::max(rounds.value(targetId), m_servedRounds[static_cast<int>(priority)]);
+        rounds[targetId] = entry.round + 1;
+    }
+    entry.order = orderOf(entry);
+    insert(entry);
+    return true;
+}
+
+bool DownloadQueue::remove(const BuildRef &build)
+{
+    auto indexIt = m_index.find(build);
+    if (indexIt == m_index.end())
+        return false;
+    erase(indexIt.value());
+    return true;
+}
+
+DownloadQueue::const_iterator DownloadQueue::take(const_iterator it)
+{
+    auto &served = m_servedRounds[static_cast<int>(it->priority)];
+    served = std::max(served, it->round);
+    return erase(it);
+}
+
+int DownloadQueue::position(const BuildRef &build) const
+{
+    auto indexIt = m_index.find(build);
+    if (indexIt == m_index.end())
+        return -1;
+    return static_cast<int>(std::distance(m_entries.cbegin(), indexIt.value()));
+}
+
+void DownloadQueue::insert(Entry entry)
+{
+    auto result = m_entries.insert(std::move(entry));
+    m_index.insert(result.first->build, result.first);
+}
+
+DownloadQueue::const_iterator DownloadQueue::erase(const_iterator it)
+{
+    const BuildRef build = it->build;
+    m_index.remove(build);
+    auto latestIt = m_latest.find(build.buildTargetId());
+    if (latestIt != m_latest.end() && latestIt.value() == build)
+        m_latest.erase(latestIt);
+
+    auto next = m_entries.erase(it);
+    if (m_entries.empty())
+    {
+        // nothing is waiting, the next builds start a fresh round
+        for (auto &rounds : m_targetRounds)
+            rounds.clear();
+        m_servedRounds.fill(0);
+    }
+    return next;
+}
+
+qint64 DownloadQueue::orderOf(const Entry &entry) const
+{
+    if (entry.priority == Priority::Manual)
+        return 0;
+    if (m_policy == Policy::SmallestFirst)
+        return entry.size;
+    return -entry.createTime;
+}
+
+}
@@ -0,0 +1,120 @@
+#ifndef UCD_DOWNLOADQUEUE_H
+#define UCD_DOWNLOADQUEUE_H
+
+#pragma once
+
+#include "buildref.h"
+
+#include <array>
+#include <set>
+
+#include <QHash>
+#include <QMap>
+#include <QUuid>
+
+namespace ucd
+{
+
+class Build;
+
+/**
+ * @brief Orders the builds waiting for a download worker.
+ *
+ * Builds are served by priority class first. Within a class the builds of
+ * every target take turns, a target that queued many builds only gets one
+ * per round, then the policy orders the builds of a round. Only the newest
+ * queued build of a target keeps the Latest class, the others are demoted
+ * to Backfill. Push, take, remove and lookup are O(log n).
+ */
+class DownloadQueue
+{
+public:
+    enum class Priority : int
+    {
+        Manual, // requested by the user, served in request order
+        Latest, // newer than anything downloaded for its target
+        Backfill, // older builds the target keeps
+    };
+
+    enum class Policy : int
+    {
+        NewestFirst,
+        SmallestFirst,
+    };
+
+    struct Entry
+    {
+        BuildRef build;
+        Priority priority;
+        quint64 round;
+        qint64 order; // policy key, lower first
+        quint64 sequence;
+        qint64 createTime; // msecs since epoch
+        qint64 size;
+
+        bool operator<(const Entry &other) const;
+    };
+
+    using const_iterator = std::set<Entry>::const_iterator;
+
+    DownloadQueue();
+
+    /**
+     * @brief Parse a policy setting, "newest" or "smallest".
+     */
+    static Policy parsePolicy(const QString &value);
+
+    Policy policy() const { return m_policy; }
+    /**
+     * @brief Change the policy, the queued builds are reordered.
+     */
+    void setPolicy(Policy policy);
+
+    /**
+     * @brief Queue a build.
+     * @return false if the build was already queued.
+     */
+    bool push(const Build &build, Priority priority);
+    /**
+     * @brief Remove a build from the queue.
+     * @return false if the build wasn't queued.
+     */
+    bool remove(const BuildRef &build);
+    /**
+     * @brief Dequeue a build, it must be an iterator of this queue.
+     * @return the iterator following the build.
+     */
+    const_iterator take(const_iterator it);
+
+    bool contains(const BuildRef &build) const { return m_index.contains(build); }
+    /**
+     * @brief Position of a build in the queue, 0 is served next.
+     * @return -1 if the build isn't queued.
+     * @note Counting the builds ahead is linear.
+     */
+    int position(const BuildRef &build) const;
+
+    int size() const { return m_index.size(); }
+    bool isEmpty() const { return m_index.isEmpty(); }
+    const_iterator begin() const { return m_entries.cbegin(); }
+    const_iterator end() const { return m_entries.cend(); }
+
+private:
+    enum { ClassCount = 3 };
+
+    void insert(Entry entry);
+    const_iterator erase(const_iterator it);
+    qint64 orderOf(const Entry &entry) const;
+
+    std::set<Entry> m_entries;
+    QMap<BuildRef, const_iterator> m_index;
+    QHash<QUuid, BuildRef> m_latest; // the queued Latest build of each target
+    std::array<QHash<QUuid, quint64>, ClassCount> m_targetRounds; // next round of each target
+    std::array<quint64, ClassCount> m_servedRounds; // round of the last build taken
+    Policy m_policy;
+    quint64 m_sequence;
+};
+
+}
+
+#endif // UCD_DOWNLOADQUEUE_H
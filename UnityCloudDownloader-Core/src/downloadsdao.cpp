@@ -1,5 +1,8 @@
 #include "downloadsdao.h"
 
+#include "sqlhelpers.h"
+#include "cachedquery.h"
+
 #include <QVariant>
 #include <QSqlError>
 
@@ -14,7 +17,7 @@ void DownloadsDao::init()
 {
     QSqlQuery query(m_db);
     if (!query.exec("CREATE TABLE IF NOT EXISTS Downloads ("
-                    "buildTargetId TEXT, "
+                    "buildTargetId BLOB, "
                     "buildNumber INT, "
                     "status INT, "
                     "PRIMARY KEY(buildTargetId, buildNumber))"))
@@ -23,12 +26,19 @@ void DownloadsDao::init()
         qFatal("%s", error.data());
         throw std::runtime_error(error);
     }
+
+    // md5 of the downloaded artifact, as hex
+    ensureColumn(m_db, QStringLiteral("Downloads"), QStringLiteral("digest"), QStringLiteral("TEXT"));
+    // retry state of failed downloads, nextRetry is in msecs since epoch and 0 once given up
+    ensureColumn(m_db, QStringLiteral("Downloads"), QStringLiteral("attempts"), QStringLiteral("INT DEFAULT 0"));
+    ensureColumn(m_db, QStringLiteral("Downloads"), QStringLiteral("failure"), QStringLiteral("INT DEFAULT 0"));
+    ensureColumn(m_db, QStringLiteral("Downloads"), QStringLiteral("nextRetry"), QStringLiteral("INT DEFAULT 0"));
 }
 
 QVector<BuildRef> DownloadsDao::downloadedBuilds(QUuid buildTargetId)
 {
     QVector<BuildRef> builds;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     if (buildTargetId.isNull())
     {
         query.prepare("SELECT buildTargetId, buildNumber "
@@ -42,7 +52,7 @@ QVector<BuildRef> DownloadsDao::downloadedBuilds(QUuid buildTargetId)
                       "FROM Downloads "
                       "WHERE buildTargetId = :buildTargetId "
                       "AND status = :status");
-        query.bindValue(":buildTargetId", buildTargetId.toString());
+        query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
         query.bindValue(":status", Status::Downloaded);
     }
     if (!query.exec())
@@ -54,7 +64,7 @@ QVector<BuildRef> DownloadsDao::downloadedBuilds(QUuid buildTargetId)
 
     while (query.next())
     {
-        QUuid targetId = buildTargetId.isNull() ? query.value("buildTargetId").toUuid() : buildTargetId;
+        QUuid targetId = buildTargetId.isNull() ? uuidFromSql(query.value("buildTargetId")) : buildTargetId;
         int buildNumber = query.value("buildNumber").toInt();
         builds.append(BuildRef(targetId, buildNumber));
     }
@@ -62,15 +72,20 @@ QVector<BuildRef> DownloadsDao::downloadedBuilds(QUuid buildTargetId)
     return builds;
 }
 
-void DownloadsDao::addDownload(BuildRef buildRef)
+void DownloadsDao::addDownload(BuildRef buildRef, const QByteArray &digest)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("UPDATE Downloads SET "
-                  "status = :status "
+                  "status = :status, "
+                  "digest = :digest, "
+                  "attempts = 0, "
+                  "failure = 0, "
+                  "nextRetry = 0 "
                   "WHERE buildTargetId = :buildTargetId "
                   "AND buildNumber = :buildNumber");
     query.bindValue(":status", Status::Downloaded);
-    query.bindValue(":buildTargetId", buildRef.buildTargetId().toString());
+    query.bindValue(":digest", QString::fromLatin1(digest));
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
     query.bindValue(":buildNumber", buildRef.buildNumber());
     if (!query.exec())
     {
@@ -85,14 +100,17 @@ void DownloadsDao::addDownload(BuildRef buildRef)
     query.prepare("INSERT INTO Downloads ("
                   "buildTargetId, "
                   "buildNumber, "
-                  "status) "
+                  "status, "
+                  "digest) "
                   "VALUES ("
                   ":buildTargetId, "
                   ":buildNumber, "
-                  ":status)");
-    query.bindValue(":buildTargetId", buildRef.buildTargetId().toString());
+                  ":status, "
+                  ":digest)");
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
     query.bindValue(":buildNumber", buildRef.buildNumber());
     query.bindValue(":status", Status::Downloaded);
+    query.bindValue(":digest", QString::fromLatin1(digest));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -103,12 +121,91 @@ void DownloadsDao::addDownload(BuildRef buildRef)
 
 void DownloadsDao::removeDownload(BuildRef buildRef)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM Downloads "
                   "WHERE buildTargetId = :buildTargetId "
                   "AND buildNumber = :buildNumber");
-    query.bindValue(":buildTargetId", buildRef.buildTargetId().toString());
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
+    query.bindValue(":buildNumber", buildRef.buildNumber());
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+QVector<DownloadsDao::Retry> DownloadsDao::retries()
+{
+    QVector<Retry> retries;
+    CachedQuery query(m_db);
+    query.prepare("SELECT buildTargetId, buildNumber, attempts, failure, nextRetry "
+                  "FROM Downloads "
+                  "WHERE status = :status");
+    query.bindValue(":status", Status::Failed);
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+
+    while (query.next())
+    {
+        Retry retry;
+        retry.buildRef = BuildRef(uuidFromSql(query.value("buildTargetId")), query.value("buildNumber").toInt());
+        retry.attempts = query.value("attempts").toInt();
+        retry.failure = query.value("failure").toInt();
+        qint64 nextRetry = query.value("nextRetry").toLongLong();
+        if (nextRetry > 0)
+            retry.nextRetry = QDateTime::fromMSecsSinceEpoch(nextRetry);
+        retries.append(retry);
+    }
+
+    return retries;
+}
+
+void DownloadsDao::setRetry(const Retry &retry)
+{
+    CachedQuery query(m_db);
+    query.prepare("INSERT OR REPLACE INTO Downloads ("
+                  "buildTargetId, "
+                  "buildNumber, "
+                  "status, "
+                  "attempts, "
+                  "failure, "
+                  "nextRetry) "
+                  "VALUES ("
+                  ":buildTargetId, "
+                  ":buildNumber, "
+                  ":status, "
+                  ":attempts, "
+                  ":failure, "
+                  ":nextRetry)");
+    query.bindValue(":buildTargetId", uuidToSql(retry.buildRef.buildTargetId()));
+    query.bindValue(":buildNumber", retry.buildRef.buildNumber());
+    query.bindValue(":status", Status::Failed);
+    query.bindValue(":attempts", retry.attempts);
+    query.bindValue(":failure", retry.failure);
+    query.bindValue(":nextRetry", retry.nextRetry.isValid() ? retry.nextRetry.toMSecsSinceEpoch() : 0);
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+void DownloadsDao::removeRetry(BuildRef buildRef)
+{
+    CachedQuery query(m_db);
+    query.prepare("DELETE FROM Downloads "
+                  "WHERE buildTargetId = :buildTargetId "
+                  "AND buildNumber = :buildNumber "
+                  "AND status = :status");
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
     query.bindValue(":buildNumber", buildRef.buildNumber());
+    query.bindValue(":status", Status::Failed);
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
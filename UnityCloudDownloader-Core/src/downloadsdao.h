@@ -5,6 +5,7 @@
 
 #include "buildref.h"
 
+#include <QDateTime>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QVector>
@@ -18,17 +19,33 @@ class DownloadsDao
     {
         Unknown,
         Downloaded,
+        Failed,
     };
 public:
+    /**
+     * @brief Retry state of a build whose download failed.
+     */
+    struct Retry
+    {
+        BuildRef buildRef;
+        int attempts;
+        int failure; // a DownloadWorker::Failure
+        QDateTime nextRetry; // invalid once the build is given up on
+    };
+
     DownloadsDao(const QSqlDatabase &database);
     ~DownloadsDao() = default;
 
     void init();
 
     QVector<BuildRef> downloadedBuilds(QUuid buildTargetId = {});
-    void addDownload(BuildRef buildRef);
+    void addDownload(BuildRef buildRef, const QByteArray &digest = QByteArray());
     void removeDownload(BuildRef buildRef);
 
+    QVector<Retry> retries();
+    void setRetry(const Retry &retry);
+    void removeRetry(BuildRef buildRef);
+
 private:
     QSqlDatabase m_db;
 };
@@ -8,33 +8,78 @@
 #include "projectdao.h"
 #include "buildtarget.h"
 #include "buildtargetdao.h"
+#include "bandwidthlimiter.h"
+#include "zipstreamextractor.h"
+#include "archiveextractor.h"
+#include "filesystem.h"
+#include "filewriter.h"
+#include "deltadownload.h"
+#include "downloadsdao.h"
+#include "networksession.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QDir>
 #include <QFile>
-#include <QProcess>
+#include <QStorageInfo>
+#include <QTimer>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 namespace ucd
 {
 
 enum
 {
-    BufferReserve = 15000,
+    BufferReserve = 256 * 1024,
+    SegmentThreshold = 32 * 1024 * 1024,
+    MinSegmentSize = 4 * 1024 * 1024,
+    MaxSegments = 8,
+    SegmentProbeInterval = 2000,
+    MinReadBufferSize = 64 * 1024,
+    MaxReadBufferSize = 4 * 1024 * 1024,
+    StreamReadSize = 1024 * 1024,
+    StreamCatchUpBudget = 4 * 1024 * 1024,
 };
 
-DownloadWorker::DownloadWorker(QObject *parent)
+static const qint64 UnknownEnd = std::numeric_limits<qint64>::max();
+
+DownloadWorker::DownloadWorker(BandwidthLimiter *bandwidthLimiter, QObject *parent)
     : QObject(parent)
-    , m_connectionId(QUuid::createUuid())
     , m_busy(false)
-    , m_network(new QNetworkAccessManager(this))
-    , m_reply(nullptr)
+    , m_network(nullptr)
+    , m_bandwidthLimiter(bandwidthLimiter)
+    , m_throttleTimer(new QTimer(this))
+    , m_writer(new FileWriter(this))
+    , m_delta(nullptr)
     , m_lastSize(0)
+    , m_rejected(false)
+    , m_firstByteReceived(false)
+    , m_rangesSupported(false)
+    , m_segmentsSettled(false)
+    , m_segmentTarget(1)
+    , m_segmentBytes(0)
+    , m_lastThroughput(0)
+    , m_streamedOffset(0)
+    , m_hash(QCryptographicHash::Md5)
+    , m_hashing(false)
 {
     m_buffer.reserve(BufferReserve);
+    m_throttleTimer->setSingleShot(true);
+    m_throttleTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_throttleTimer, &QTimer::timeout, this, &DownloadWorker::onThrottleElapsed);
+    connect(m_writer, &FileWriter::bufferReleased, this, &DownloadWorker::onBufferReleased, Qt::QueuedConnection);
     connect(this, &DownloadWorker::downloadRequested, this, &DownloadWorker::onDownloadRequested, Qt::QueuedConnection);
+    connect(this, &DownloadWorker::pauseRequested, this, &DownloadWorker::onPauseRequested, Qt::QueuedConnection);
     connect(this, &DownloadWorker::progressRequested, this, &DownloadWorker::onProgressRequested, Qt::QueuedConnection);
+    m_writer->start();
 }
 
 DownloadWorker::~DownloadWorker()
@@ -46,6 +91,12 @@ void DownloadWorker::download(const Build &build)
     emit downloadRequested(build);
 }
 
+void DownloadWorker::pause(const Build &build)
+{
+    if (m_busy)
+        emit pauseRequested(build);
+}
+
 void DownloadWorker::requestProgress()
 {
     if (m_busy)
@@ -54,103 +105,384 @@ void DownloadWorker::requestProgress()
 
 void DownloadWorker::onDownloadRequested(Build build)
 {
+    // the worker is constructed on the synchronizer thread, it takes the session of its own thread here
+    if (m_network == nullptr)
+        m_network = NetworkSession::manager();
     m_build = build;
+    m_firstByteReceived = false;
 
     // setup storage path
-    QSqlDatabase db = ServiceLocator::databaseProvider()->sqlDatabase(m_connectionId.toString());
-    if (!db.open())
+    QSqlDatabase db = ServiceLocator::databaseProvider()->threadDatabase();
+    if (!db.isOpen())
     {
         qCritical("Cannot open dabatase connection");
-        emit downloadFailed(build);
+        m_busy = false;
+        emit downloadFailed(build, Failure::Local);
+        return;
+    }
+    BuildTarget buildTarget;
+    Project project;
+    Profile profile;
+    // the latest build downloaded before this one is the seed of a delta download
+    int seedNumber = 0;
+    try
+    {
+        buildTarget = BuildTargetDao(db).buildTarget(build.buildTargetId());
+        project = ProjectDao(db).project(buildTarget.projectId());
+        profile = ProfileDao(db).profile(project.profileId());
+        for (const auto &buildRef : DownloadsDao(db).downloadedBuilds(build.buildTargetId()))
+        {
+            if (buildRef.buildNumber() < build.id())
+                seedNumber = std::max(seedNumber, buildRef.buildNumber());
+        }
+    }
+    catch (const std::runtime_error &)
+    {
+        // the error is logged by the dao, an exception must not leave the slot
+    }
+    if (buildTarget.id().isNull() || project.id().isNull() || profile.uuid().isNull())
+    {
+        qCritical("Cannot find where to store build %d", build.id());
+        m_busy = false;
+        emit downloadFailed(build, Failure::Local);
         return;
     }
-    auto buildTarget = BuildTargetDao(db).buildTarget(build.buildTargetId());
-    auto project = ProjectDao(db).project(buildTarget.projectId());
-    auto profile = ProfileDao(db).profile(project.profileId());
-    db.close();
 
-    auto storageDir = QDir(QStringLiteral("%1/%2/%3/%4").arg(
-                               profile.rootPath(),
-                               project.cloudId(),
-                               buildTarget.cloudId(),
-                               QString::number(build.id())));
+    const auto targetPath = QStringLiteral("%1/%2/%3").arg(profile.rootPath(), project.cloudId(), buildTarget.cloudId());
+    auto storageDir = QDir(QStringLiteral("%1/%2").arg(targetPath, QString::number(build.id())));
     m_storagePath = storageDir.absolutePath();
     storageDir.mkpath(m_storagePath);
+    m_store = profile.deduplicate() ? ContentStore(profile.rootPath()) : ContentStore();
     m_filePath = storageDir.filePath(build.artifactName());
+
+    // a partial file means a full download was started, it is resumed instead
+    const QString seedPath = QStringLiteral("%1/%2").arg(targetPath, QString::number(seedNumber));
+    if (seedNumber > 0
+            && isArchive()
+            && build.artifactSize() >= SegmentThreshold
+            && !QFile::exists(m_filePath)
+            && QDir(seedPath).exists())
+    {
+        m_delta = new DeltaDownload(m_network, m_bandwidthLimiter, build, seedPath, m_storagePath, m_store, this);
+        connect(m_delta, &DeltaDownload::finished, this, &DownloadWorker::onDeltaFinished);
+        connect(m_delta, &DeltaDownload::firstByteReceived, this, &DownloadWorker::onDeltaFirstByte);
+        m_progressTimer.start();
+        m_lastSize = 0;
+        m_delta->start();
+        return;
+    }
+
+    startDownload();
+}
+
+void DownloadWorker::onPauseRequested(Build build)
+{
+    // the request may come after the build completed, and the worker moved on
+    if (!m_busy || !(BuildRef(build) == BuildRef(m_build)))
+        return;
+
+    if (m_delta != nullptr)
+    {
+        // a delta download has no partial file, it starts over from the directory when resumed
+        m_delta->disconnect(this);
+        m_delta->deleteLater();
+        m_delta = nullptr;
+        m_progressTimer.invalidate();
+    }
+    else if (m_outFile != nullptr && !m_segments.isEmpty())
+    {
+        stopDownload();
+    }
+    else
+    {
+        return;
+    }
+
+    qInfo("Paused download of %s", m_filePath.toUtf8().data());
+    m_busy = false;
+    emit downloadPaused(m_build);
+}
+
+void DownloadWorker::onDeltaFirstByte()
+{
+    if (!m_firstByteReceived)
+    {
+        m_firstByteReceived = true;
+        emit firstByteReceived(m_build);
+    }
+}
+
+void DownloadWorker::onDeltaFinished(bool success)
+{
+    m_delta->deleteLater();
+    m_delta = nullptr;
+
+    if (!success)
+    {
+        // the copied seeds may be links to the seed build, the full download must not write through them
+        QDir(m_storagePath).removeRecursively();
+        QDir().mkpath(m_storagePath);
+        startDownload();
+        return;
+    }
+
+    // every file was copied from the seed or extracted from the fetched ranges
+    emit downloadUpdated(m_build, 1, 0);
+    m_progressTimer.invalidate();
+    m_busy = false;
+    emit downloadCompleted(m_build, QByteArray());
+}
+
+void DownloadWorker::startDownload()
+{
+    const Build &build = m_build;
     m_outFile = std::make_unique<QFile>(m_filePath);
-    if (!m_outFile->open(QIODevice::WriteOnly | QIODevice::Truncate))
+    // the file is not truncated so a previous partial download can be resumed,
+    // writes are batched here so the file doesn't need its own buffer
+    if (!m_outFile->open(QIODevice::ReadWrite | QIODevice::Unbuffered))
     {
         m_outFile = nullptr;
         qCritical("Cannot create file %s for writing", m_filePath.toUtf8().data());
-        emit downloadFailed(build);
+        m_busy = false;
+        emit downloadFailed(build, Failure::Local);
         return;
     }
 
+    m_segments.clear();
+    m_etag.clear();
+    m_lastModified.clear();
+    m_rejected = false;
+    m_rangesSupported = false;
+    m_segmentsSettled = false;
+    m_segmentTarget = 1;
+    m_segmentTimer.invalidate();
+    m_segmentBytes = 0;
+    m_lastThroughput = 0;
+
+    const qint64 artifactSize = build.artifactSize();
+    if (!readResumeState())
+    {
+        // without a validator the partial file could belong to another version of the artifact, start over
+        discardPartial();
+        m_segments.append(Segment{nullptr, 0, artifactSize > 0 ? artifactSize : UnknownEnd, false});
+    }
+
+    // fail right away rather than after writing gigabytes to a full disk
+    const qint64 remaining = artifactSize - downloadedBytes();
+    QStorageInfo storage(m_storagePath);
+    if (artifactSize > 0 && storage.isValid() && storage.bytesAvailable() < remaining)
+    {
+        qCritical("Not enough space to download %s, %lld bytes needed and %lld available",
+                  m_filePath.toUtf8().data(), remaining, storage.bytesAvailable());
+        failDownload(Failure::Local);
+        return;
+    }
+    // reserving the blocks upfront keeps the file contiguous when several downloads write at once
+    if (artifactSize > 0 && !preallocateFile(*m_outFile, artifactSize))
+    {
+        qCritical("Cannot allocate %lld bytes for %s", artifactSize, m_filePath.toUtf8().data());
+        failDownload(Failure::Local);
+        return;
+    }
+    // from now on the file is written from the writer thread
+    m_writer->setFile(m_outFile.get());
+
+    // the artifact is hashed and extracted as its bytes arrive, a resumed prefix is read back from disk
+    restartStreaming();
+
+    if (downloadedBytes() > 0)
+        qInfo("Resuming download of %s at %lld bytes", m_filePath.toUtf8().data(), downloadedBytes());
+
     // start download
-    QNetworkRequest request(build.artifactPath());
-    m_reply = m_network->get(request);
-    connect(m_reply, &QNetworkReply::readyRead, this, &DownloadWorker::onReadyRead);
-    connect(m_reply, &QNetworkReply::finished, this, &DownloadWorker::onDownloadFinished);
-    connect(m_reply, &QNetworkReply::finished, m_reply, &QNetworkReply::deleteLater);
+    for (int i = 0, end = m_segments.size(); i < end; ++i)
+    {
+        startSegment(i);
+    }
     m_progressTimer.start();
-    m_lastSize = 0;
+    m_lastSize = downloadedBytes();
 }
 
-void DownloadWorker::onReadyRead()
+void DownloadWorker::restartDownload()
 {
-    qint64 bytesRead = 0;
-    while ((bytesRead = m_reply->read(m_buffer.data(), m_buffer.capacity())) > 0)
+    // the replies of the abandoned segments are ignored from now on
+    auto segments = m_segments;
+    m_segments.clear();
+    for (const auto &segment : segments)
     {
-        m_outFile->write(m_buffer.data(), bytesRead);
+        if (segment.reply == nullptr)
+            continue;
+        if (!segment.reply->isFinished())
+            segment.reply->abort();
+        segment.reply->deleteLater();
     }
+
+    discardPartial();
+    m_rangesSupported = false;
+    m_segmentsSettled = false;
+    m_segmentTarget = 1;
+    m_segmentTimer.invalidate();
+    m_segmentBytes = 0;
+    m_lastThroughput = 0;
+
+    const qint64 artifactSize = m_build.artifactSize();
+    m_segments.append(Segment{nullptr, 0, artifactSize > 0 ? artifactSize : UnknownEnd, false});
+    startSegment(0);
 }
 
-void DownloadWorker::onDownloadFinished()
+void DownloadWorker::onMetaDataChanged()
 {
-    emit downloadUpdated(m_build, 1, 0);
-    m_progressTimer.invalidate();
-    QSqlDatabase::removeDatabase(m_connectionId.toString());
-    m_outFile->close();
-    m_outFile = nullptr;
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    int index = segmentIndex(reply);
+    if (index < 0 || m_rejected)
+        return;
 
-    if (m_reply->error())
+    const qint64 artifactSize = m_build.artifactSize();
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode == 206)
     {
-        qCritical("Download failed %s", m_reply->errorString().toUtf8().data());
-        m_reply = nullptr;
-        m_busy = false;
-        emit downloadFailed(m_build);
+        // validate that the partial content starts where the segment is and matches the artifact
+        static const QRegularExpression contentRangeExp(QStringLiteral("^bytes (\\d+)-(\\d+)/(\\d+|\\*)$"));
+        auto match = contentRangeExp.match(QString::fromLatin1(reply->rawHeader("Content-Range")));
+        bool valid = match.hasMatch() && match.captured(1).toLongLong() == m_segments.at(index).offset;
+        if (valid && match.captured(3) != QStringLiteral("*"))
+            valid = match.captured(3).toLongLong() == artifactSize;
+        if (!valid)
+        {
+            qCritical("Unexpected content range %s for %s",
+                      reply->rawHeader("Content-Range").data(), m_filePath.toUtf8().data());
+            // the partial file can't be trusted anymore
+            m_rejected = true;
+            discardPartial();
+            reply->abort();
+            return;
+        }
+
+        if (!m_rangesSupported && artifactSize >= SegmentThreshold)
+        {
+            // segments write anywhere in the file, so it is preallocated to its final size
+            m_writer->waitForIdle();
+            m_outFile->resize(artifactSize);
+        }
+        m_rangesSupported = true;
+        m_segments[index].accepted = true;
+    }
+    else if (statusCode == 200)
+    {
+        if (m_segments.size() > 1 || m_segments.at(index).offset > 0)
+        {
+            // the server ignored the range or the artifact changed, this reply replaces every segment
+            qInfo("Server sent full content, restarting download of %s", m_filePath.toUtf8().data());
+            auto segments = m_segments;
+            m_segments.clear();
+            for (const auto &segment : segments)
+            {
+                if (segment.reply != nullptr && segment.reply != reply)
+                {
+                    segment.reply->abort();
+                    segment.reply->deleteLater();
+                }
+            }
+            discardPartial();
+            m_segments.append(Segment{reply, 0, artifactSize > 0 ? artifactSize : UnknownEnd, false});
+            index = 0;
+        }
+        m_rangesSupported = false;
+
+        auto contentLength = reply->header(QNetworkRequest::ContentLengthHeader);
+        if (contentLength.isValid() && contentLength.toLongLong() != artifactSize)
+        {
+            qWarning("Content length %lld does not match the artifact size %lld",
+                     contentLength.toLongLong(), artifactSize);
+            m_segments[index].end = contentLength.toLongLong();
+        }
+        m_segments[index].accepted = true;
+    }
+    else if (statusCode == 416)
+    {
+        // a range from the start can't be satisfied by any retry with a range
+        if (m_segments.at(index).offset == 0)
+        {
+            qCritical("Range not satisfiable for %s", m_filePath.toUtf8().data());
+            failDownload(Failure::Network);
+            return;
+        }
+
+        // the partial file is out of range for the artifact, it starts over right away
+        qInfo("Range not satisfiable, restarting download of %s", m_filePath.toUtf8().data());
+        restartDownload();
+        return;
     }
     else
     {
-        m_reply = nullptr;
-#ifdef Q_OS_WIN
-        auto *unzip = new QProcess(this);
-        QStringList args{
-            QStringLiteral("-nologo"),
-            QStringLiteral("-noprofile"),
-            QStringLiteral("-command"),
-            QStringLiteral("& { Add-Type -A 'System.IO.Compression.FileSystem'; [IO.Compression.ZipFile]::ExtractToDirectory('%1', '%2'); }")
-            .arg(m_filePath, m_storagePath)
-        };
-        unzip->setProgram(QStringLiteral("powershell.exe"));
-        unzip->setArguments(args);
-        void (QProcess::*finished)(int) = &QProcess::finished; // finished is overloaded which prevents auto selection
-        connect(unzip, finished, this, &DownloadWorker::onUnzipFinished);
-        connect(unzip, finished, unzip, &QProcess::deleteLater);
-        unzip->start();
-#else
-        m_busy = false;
-        emit downloadCompleted(m_build);
-#endif
+        // an error page or an unfollowed redirect isn't part of the artifact
+        qWarning("Unexpected status %d for %s", statusCode, m_filePath.toUtf8().data());
+        reply->abort();
+        return;
+    }
+
+    m_etag = reply->rawHeader("ETag");
+    m_lastModified = reply->rawHeader("Last-Modified");
+    writeResumeState();
+}
+
+void DownloadWorker::onReadyRead()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    int index = segmentIndex(reply);
+    if (index < 0 || m_rejected)
+        return;
+
+    readSegment(index);
+}
+
+void DownloadWorker::onSegmentFinished()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    int index = segmentIndex(reply);
+    if (index < 0)
+    {
+        // the segment was replaced or abandoned
+        reply->deleteLater();
+        return;
+    }
+
+    if (reply->error() == QNetworkReply::NoError && reply->bytesAvailable() > 0 && m_segments.at(index).accepted)
+    {
+        // bytes held back by the bandwidth limiter are drained before the segment completes
+        m_segments[index].finished = true;
+        readSegment(index);
+        return;
     }
+
+    finishSegment(index);
+}
+
+void DownloadWorker::onThrottleElapsed()
+{
+    readSegments();
+}
+
+void DownloadWorker::onBufferReleased()
+{
+    readSegments();
 }
 
 void DownloadWorker::onProgressRequested()
 {
-    if (m_reply == nullptr)
+    if (m_delta != nullptr && m_delta->totalBytes() > 0)
+    {
+        qint64 currentSize = m_delta->receivedBytes();
+        auto elapsedTime = m_progressTimer.restart();
+        qint64 speed = (elapsedTime != 0) ? (((currentSize - m_lastSize) * 1000) / elapsedTime) : 0;
+        m_lastSize = currentSize;
+        emit downloadUpdated(m_build, float(currentSize) / m_delta->totalBytes(), speed);
         return;
+    }
 
-    qint64 currentSize = m_outFile->size();
+    if (m_segments.isEmpty() || m_outFile == nullptr)
+        return;
+
+    qint64 currentSize = downloadedBytes();
     float ratio = float(currentSize) / m_build.artifactSize();
     // calculate the speed in bytes per second
     auto elapsedTime = m_progressTimer.restart();
@@ -158,22 +490,658 @@ void DownloadWorker::onProgressRequested()
     m_lastSize = currentSize;
 
     emit downloadUpdated(m_build, ratio, speed);
+
+    adaptSegments();
+}
+
+void DownloadWorker::onExtractionProgress(qint64 extractedBytes, qint64 totalBytes)
+{
+    // the disk throughput of the extraction isn't a download speed
+    float ratio = totalBytes > 0 ? float(extractedBytes) / totalBytes : 1;
+    emit extractionUpdated(m_build, ratio);
 }
 
-void DownloadWorker::onUnzipFinished(int exitCode)
+void DownloadWorker::onExtractionFinished(bool success)
 {
-    if (exitCode == 0)
+    if (success)
     {
         QFile::remove(m_filePath);
         m_busy = false;
-        emit downloadCompleted(m_build);
+        emit downloadCompleted(m_build, m_digest);
     }
     else
     {
         qCritical("unzip failed");
         m_busy = false;
-        emit downloadFailed(m_build);
+        emit downloadFailed(m_build, Failure::Local);
+    }
+}
+
+void DownloadWorker::startSegment(int index)
+{
+    auto &segment = m_segments[index];
+    const qint64 artifactSize = m_build.artifactSize();
+
+    QNetworkRequest request(m_build.artifactPath());
+    // large artifacts are always requested with a range so they can be split once the server accepts it
+    if (segment.offset > 0 || artifactSize >= SegmentThreshold)
+    {
+        QByteArray range = QByteArray("bytes=") + QByteArray::number(segment.offset) + '-';
+        if (segment.end < artifactSize)
+            range += QByteArray::number(segment.end - 1);
+        request.setRawHeader("Range", range);
+        // if the artifact changed since the partial download, the server will reply with the full content
+        if (!m_etag.isEmpty())
+            request.setRawHeader("If-Range", m_etag);
+        else if (!m_lastModified.isEmpty())
+            request.setRawHeader("If-Range", m_lastModified);
+    }
+
+    segment.finished = false;
+    segment.accepted = false;
+    segment.reply = m_network->get(request);
+    connect(segment.reply, &QNetworkReply::metaDataChanged, this, &DownloadWorker::onMetaDataChanged);
+    connect(segment.reply, &QNetworkReply::readyRead, this, &DownloadWorker::onReadyRead);
+    connect(segment.reply, &QNetworkReply::finished, this, &DownloadWorker::onSegmentFinished);
+}
+
+void DownloadWorker::readSegments()
+{
+    // segments are removed as they complete, so walk backward
+    for (int i = m_segments.size() - 1; i >= 0 && !m_rejected; --i)
+    {
+        if (i < m_segments.size() && m_segments.at(i).reply != nullptr)
+            readSegment(i);
+    }
+}
+
+void DownloadWorker::readSegment(int index)
+{
+    auto *reply = m_segments.at(index).reply;
+    // the body is only written once its status was checked
+    if (!m_segments.at(index).accepted)
+        return;
+
+    // a bounded read buffer makes the socket stop reading, so throttling pushes back on the sender
+    const qint64 rate = m_bandwidthLimiter->rate();
+    const qint64 readBufferSize = rate == 0 ? 0 : qBound<qint64>(MinReadBufferSize, rate / 4, MaxReadBufferSize);
+    if (reply->readBufferSize() != readBufferSize)
+        reply->setReadBufferSize(readBufferSize);
+
+    while (m_segments.at(index).offset < m_segments.at(index).end)
+    {
+        qint64 available = std::min<qint64>(reply->bytesAvailable(), m_buffer.capacity());
+        if (available <= 0)
+            break;
+
+        // the disk is behind, bytes stay in the socket until a buffer is released
+        if (m_writer->full())
+            return;
+
+        qint64 granted = m_bandwidthLimiter->acquire(available);
+        if (granted == 0)
+        {
+            if (!m_throttleTimer->isActive())
+                m_throttleTimer->start(m_bandwidthLimiter->delay(available));
+            return;
+        }
+
+        qint64 bytesRead = reply->read(m_buffer.data(), granted);
+        if (bytesRead <= 0)
+            break;
+        if (!m_firstByteReceived)
+        {
+            m_firstByteReceived = true;
+            emit firstByteReceived(m_build);
+        }
+
+        const qint64 offset = m_segments.at(index).offset;
+        qint64 count = std::min(bytesRead, m_segments.at(index).end - offset);
+        if (!writeSegment(index, m_buffer.constData(), count))
+        {
+            failDownload(Failure::Local);
+            return;
+        }
+        m_segmentBytes += count;
+
+        streamPrefix(m_buffer.constData(), offset, count, count + StreamCatchUpBudget);
+    }
+
+    const auto &segment = m_segments.at(index);
+    if (segment.finished && (reply->bytesAvailable() == 0 || segment.offset >= segment.end))
+    {
+        finishSegment(index);
+    }
+    else if (segment.offset >= segment.end && !reply->isFinished())
+    {
+        // the rest of the requested range was handed over to another segment
+        reply->abort();
+    }
+}
+
+bool DownloadWorker::writeSegment(int index, const char *data, qint64 size)
+{
+    auto &segment = m_segments[index];
+    segment.pending.append(data, static_cast<int>(size));
+    segment.offset += size;
+
+    // write whole batches ending on aligned offsets, only the first one of a segment is shorter
+    const qint64 batchSize = FileWriter::blockSize();
+    qint64 start = segment.offset - segment.pending.size();
+    qint64 batchEnd = (start / batchSize + 1) * batchSize;
+    if (segment.offset < batchEnd)
+        return true;
+
+    qint64 count = batchEnd - start + ((segment.offset - batchEnd) / batchSize) * batchSize;
+    if (!queueWrite(start, segment.pending.constData(), count))
+        return false;
+    segment.pending.remove(0, static_cast<int>(count));
+    return true;
+}
+
+bool DownloadWorker::flushSegment(int index)
+{
+    auto &segment = m_segments[index];
+    if (segment.pending.isEmpty())
+        return true;
+
+    bool written = queueWrite(segment.offset - segment.pending.size(), segment.pending.constData(), segment.pending.size());
+    segment.pending.clear();
+    return written;
+}
+
+bool DownloadWorker::flushSegments()
+{
+    bool written = true;
+    for (int i = 0, end = m_segments.size(); i < end; ++i)
+    {
+        written = flushSegment(i) && written;
+    }
+    return written;
+}
+
+void DownloadWorker::finishSegment(int index)
+{
+    const auto &segment = m_segments.at(index);
+    auto *reply = segment.reply;
+    reply->deleteLater();
+
+    if (!flushSegment(index))
+    {
+        failDownload(Failure::Local);
+        return;
+    }
+
+    bool complete = segment.offset >= segment.end
+            || (segment.end == UnknownEnd && reply->error() == QNetworkReply::NoError);
+    if (!complete)
+    {
+        if (reply->error())
+            qCritical("Download failed %s", reply->errorString().toUtf8().data());
+        else
+            qCritical("Download of %s ended before the end of its range", m_filePath.toUtf8().data());
+        failDownload(m_rejected ? Failure::Corrupted : replyFailure(reply));
+        return;
+    }
+
+    m_segments.remove(index);
+    if (m_segments.isEmpty())
+    {
+        completeDownload();
+    }
+    else
+    {
+        // keep the connection count up by taking over part of the largest remaining segment
+        while (m_segments.size() < m_segmentTarget && splitSegment()) {}
+    }
+}
+
+bool DownloadWorker::queueWrite(qint64 offset, const char *data, qint64 size)
+{
+    // positional writes, segments are interleaved in the same file
+    const qint64 batchSize = FileWriter::blockSize();
+    for (qint64 written = 0; written < size;)
+    {
+        qint64 count = std::min(size - written, batchSize - (offset + written) % batchSize);
+        if (!m_writer->write(offset + written, data + written, count))
+        {
+            qCritical("Cannot write %s: %s", m_filePath.toUtf8().data(), m_writer->errorString().toUtf8().data());
+            return false;
+        }
+        written += count;
+    }
+    return true;
+}
+
+int DownloadWorker::segmentIndex(const QNetworkReply *reply) const
+{
+    if (reply == nullptr)
+        return -1;
+
+    for (int i = 0, end = m_segments.size(); i < end; ++i)
+    {
+        if (m_segments.at(i).reply == reply)
+            return i;
+    }
+    return -1;
+}
+
+bool DownloadWorker::splitSegment()
+{
+    if (!m_rangesSupported || m_rejected || m_segments.size() >= MaxSegments)
+        return false;
+
+    auto largestIt = std::max_element(
+                std::begin(m_segments),
+                std::end(m_segments),
+                [](const Segment &lhs, const Segment &rhs) -> bool { return (lhs.end - lhs.offset) < (rhs.end - rhs.offset); });
+    if (largestIt == std::end(m_segments) || largestIt->end == UnknownEnd)
+        return false;
+
+    qint64 remaining = largestIt->end - largestIt->offset;
+    if (remaining < 2 * MinSegmentSize)
+        return false;
+
+    // the current connection keeps the first half and stops once it reaches it
+    qint64 middle = largestIt->offset + remaining / 2;
+    Segment segment{nullptr, middle, largestIt->end, false};
+    largestIt->end = middle;
+    m_segments.append(segment);
+    startSegment(m_segments.size() - 1);
+    return true;
+}
+
+void DownloadWorker::adaptSegments()
+{
+    if (!m_rangesSupported || m_build.artifactSize() < SegmentThreshold)
+        return;
+
+    if (!m_segmentTimer.isValid())
+    {
+        m_segmentTimer.start();
+        m_segmentBytes = 0;
+        return;
+    }
+
+    if (m_segmentTimer.elapsed() < SegmentProbeInterval)
+        return;
+
+    qint64 throughput = (m_segmentBytes * 1000) / std::max<qint64>(m_segmentTimer.restart(), 1);
+    m_segmentBytes = 0;
+    writeResumeState();
+
+    // keep adding connections for as long as each one makes the transfer at least 10% faster
+    if (!m_segmentsSettled && m_segments.size() >= m_segmentTarget)
+    {
+        if (m_lastThroughput == 0 || throughput > m_lastThroughput + m_lastThroughput / 10)
+            m_segmentTarget = std::min<int>(m_segmentTarget + 1, MaxSegments);
+        else
+            m_segmentsSettled = true;
+    }
+    m_lastThroughput = throughput;
+
+    while (m_segments.size() < m_segmentTarget && splitSegment()) {}
+}
+
+qint64 DownloadWorker::downloadedBytes() const
+{
+    const qint64 artifactSize = m_build.artifactSize();
+    if (artifactSize <= 0)
+        return m_segments.isEmpty() ? 0 : m_segments.first().offset;
+
+    qint64 remaining = 0;
+    for (const auto &segment : m_segments)
+    {
+        if (segment.end != UnknownEnd)
+            remaining += segment.end - segment.offset;
+    }
+    return std::max<qint64>(artifactSize - remaining, 0);
+}
+
+qint64 DownloadWorker::completedPrefix() const
+{
+    if (m_segments.isEmpty())
+        return m_outFile->size();
+
+    // every byte before the first missing one is on disk
+    auto firstIt = std::min_element(
+                std::begin(m_segments),
+                std::end(m_segments),
+                [](const Segment &lhs, const Segment &rhs) -> bool { return lhs.offset < rhs.offset; });
+    return firstIt->offset;
+}
+
+bool DownloadWorker::isArchive() const
+{
+    // apk and ipa files are zip files too but must be kept as is
+    return m_build.artifactName().endsWith(QStringLiteral(".zip"), Qt::CaseInsensitive);
+}
+
+void DownloadWorker::restartStreaming()
+{
+    m_extractor = isArchive() ? std::make_unique<ZipStreamExtractor>(m_storagePath, m_store) : nullptr;
+    m_streamSource = nullptr;
+    m_streamedOffset = 0;
+    m_hash.reset();
+    m_hashing = true;
+    m_digest.clear();
+}
+
+void DownloadWorker::streamPrefix(const char *data, qint64 offset, qint64 size, qint64 budget)
+{
+    const qint64 prefix = completedPrefix();
+    while ((m_hashing || m_extractor != nullptr) && m_streamedOffset < prefix && budget > 0)
+    {
+        const char *chunk = nullptr;
+        qint64 count = 0;
+        QByteArray readBack;
+        if (data != nullptr && m_streamedOffset >= offset && m_streamedOffset < offset + size)
+        {
+            // the bytes that were just written are still in memory
+            chunk = data + (m_streamedOffset - offset);
+            count = std::min(offset + size, prefix) - m_streamedOffset;
+        }
+        else
+        {
+            auto holderIt = std::find_if(std::begin(m_segments), std::end(m_segments), [this](const Segment &segment) -> bool
+            {
+                return m_streamedOffset >= segment.offset - segment.pending.size() && m_streamedOffset < segment.offset;
+            });
+            if (holderIt != std::end(m_segments))
+            {
+                // the bytes of another segment are still in its batch
+                chunk = holderIt->pending.constData() + (m_streamedOffset - (holderIt->offset - holderIt->pending.size()));
+                count = std::min(holderIt->offset, prefix) - m_streamedOffset;
+            }
+            else
+            {
+                // bytes written by other segments or by a previous download are read back once the writer wrote them
+                const qint64 written = writtenEnd(prefix);
+                if (written <= m_streamedOffset)
+                    break;
+
+                if (m_streamSource == nullptr)
+                {
+                    m_streamSource = std::make_unique<QFile>(m_filePath);
+                    if (!m_streamSource->open(QIODevice::ReadOnly))
+                        m_streamSource = nullptr;
+                }
+                if (m_streamSource != nullptr)
+                {
+                    m_streamSource->seek(m_streamedOffset);
+                    readBack = m_streamSource->read(std::min<qint64>({written - m_streamedOffset, budget, StreamReadSize}));
+                }
+                if (readBack.isEmpty())
+                {
+                    qWarning("Cannot read %s back for hashing and extraction", m_filePath.toUtf8().data());
+                    m_extractor = nullptr;
+                    m_hashing = false;
+                    return;
+                }
+                chunk = readBack.constData();
+                count = readBack.size();
+            }
+        }
+
+        if (m_hashing)
+            m_hash.addData(chunk, static_cast<int>(count));
+        if (m_extractor != nullptr && !m_extractor->write(chunk, count))
+        {
+            qWarning("Streaming extraction of %s stopped: %s",
+                     m_filePath.toUtf8().data(), m_extractor->errorString().toUtf8().data());
+            m_extractor = nullptr;
+        }
+        m_streamedOffset += count;
+        budget -= count;
+    }
+}
+
+qint64 DownloadWorker::writtenEnd(qint64 limit) const
+{
+    // the first byte from the streamed offset on that is queued for the writer or waiting for its batch
+    auto pending = m_writer->pendingRanges();
+    for (const auto &segment : m_segments)
+    {
+        pending.append(qMakePair(segment.offset - segment.pending.size(), segment.offset));
+    }
+    for (const auto &range : pending)
+    {
+        if (range.second > m_streamedOffset && range.first < limit)
+            limit = std::max(range.first, m_streamedOffset);
+    }
+    return limit;
+}
+
+bool DownloadWorker::finishStreaming()
+{
+    streamPrefix(nullptr, 0, 0, std::numeric_limits<qint64>::max());
+
+    if (m_hashing)
+        m_digest = m_hash.result().toHex();
+
+    bool extracted = m_extractor != nullptr && m_extractor->finish();
+    if (m_extractor != nullptr && !extracted)
+    {
+        qWarning("Streaming extraction of %s failed: %s",
+                 m_filePath.toUtf8().data(), m_extractor->errorString().toUtf8().data());
+    }
+    m_extractor = nullptr;
+    m_streamSource = nullptr;
+    return extracted;
+}
+
+bool DownloadWorker::verifyDigest() const
+{
+    const QString &expected = m_build.artifactMd5();
+    if (expected.isEmpty())
+        return true;
+
+    if (m_digest.isEmpty())
+    {
+        qWarning("Cannot verify %s, its digest is unknown", m_filePath.toUtf8().data());
+        return true;
+    }
+
+    if (expected.compare(QString::fromLatin1(m_digest), Qt::CaseInsensitive) != 0)
+    {
+        qCritical("Checksum mismatch for %s, expected %s but got %s",
+                  m_filePath.toUtf8().data(), expected.toUtf8().data(), m_digest.data());
+        return false;
+    }
+    return true;
+}
+
+void DownloadWorker::completeDownload()
+{
+    m_throttleTimer->stop();
+    if (!m_writer->waitForIdle())
+    {
+        qCritical("Cannot write %s: %s", m_filePath.toUtf8().data(), m_writer->errorString().toUtf8().data());
+        failDownload(Failure::Local);
+        return;
+    }
+    qInfo("Write queue of %s peaked at %d of %d buffers with %lld stalls",
+          m_filePath.toUtf8().data(), m_writer->peakQueueDepth(), m_writer->capacity(), m_writer->stallCount());
+
+    // most of the artifact is already hashed and extracted, only its tail is left
+    bool extracted = finishStreaming();
+    if (!verifyDigest())
+    {
+        // the artifact is corrupted, the retry starts over
+        m_rejected = true;
+        discardPartial();
+        failDownload(Failure::Corrupted);
+        return;
+    }
+
+    emit downloadUpdated(m_build, 1, 0);
+    m_progressTimer.invalidate();
+    m_writer->setFile(nullptr);
+    m_outFile->close();
+    m_outFile = nullptr;
+    QFile::remove(resumeFilePath());
+
+    if (extracted || !isArchive())
+    {
+        if (extracted)
+            QFile::remove(m_filePath);
+        m_busy = false;
+        emit downloadCompleted(m_build, m_digest);
+        return;
     }
+
+    // the archive can't be streamed, extract it from disk instead
+    auto *extractor = new ArchiveExtractor(m_filePath, m_storagePath, m_store, this);
+    connect(extractor, &ArchiveExtractor::progressChanged, this, &DownloadWorker::onExtractionProgress);
+    connect(extractor, &ArchiveExtractor::finished, this, &DownloadWorker::onExtractionFinished);
+    connect(extractor, &ArchiveExtractor::finished, extractor, &ArchiveExtractor::deleteLater);
+    extractor->start();
+}
+
+void DownloadWorker::stopDownload()
+{
+    // abandon the other segments, their replies are ignored from now on
+    for (auto &segment : m_segments)
+    {
+        auto *reply = segment.reply;
+        segment.reply = nullptr;
+        if (reply == nullptr)
+            continue;
+        if (!reply->isFinished())
+            reply->abort();
+        reply->deleteLater();
+    }
+    m_throttleTimer->stop();
+    m_extractor = nullptr;
+    m_streamSource = nullptr;
+
+    // the partial file and its resume state are kept so the retry can pick up from there
+    if (!m_rejected)
+    {
+        flushSegments();
+        writeResumeState();
+    }
+    m_segments.clear();
+
+    // a paused or failed build keeps its progress, only a completed one reports 100%
+    m_progressTimer.invalidate();
+    m_writer->setFile(nullptr);
+    m_outFile->close();
+    m_outFile = nullptr;
+}
+
+void DownloadWorker::failDownload(Failure failure)
+{
+    stopDownload();
+    m_busy = false;
+    emit downloadFailed(m_build, failure);
+}
+
+DownloadWorker::Failure DownloadWorker::replyFailure(const QNetworkReply *reply) const
+{
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode >= 500)
+        return Failure::Server;
+    if (statusCode >= 400)
+        return Failure::Client;
+    return Failure::Network;
+}
+
+QString DownloadWorker::resumeFilePath() const
+{
+    return m_filePath + QStringLiteral(".resume");
+}
+
+bool DownloadWorker::readResumeState()
+{
+    QFile file(resumeFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    auto state = QJsonDocument::fromJson(file.readAll()).object();
+    m_etag = state["etag"].toString().toLatin1();
+    m_lastModified = state["lastModified"].toString().toLatin1();
+    if (m_etag.isEmpty() && m_lastModified.isEmpty())
+        return false;
+
+    const qint64 artifactSize = m_build.artifactSize();
+    const qint64 fileSize = m_outFile->size();
+    QVector<Segment> segments;
+    for (QJsonValue value : state["segments"].toArray())
+    {
+        auto range = value.toArray();
+        Segment segment{nullptr, range.at(0).toVariant().toLongLong(), range.at(1).toVariant().toLongLong(), false};
+        // anything outside of what is on disk means the state is stale
+        if (segment.offset < 0 || segment.offset >= segment.end || segment.offset > fileSize || segment.end > artifactSize)
+            return false;
+        segments.append(segment);
+    }
+
+    if (segments.isEmpty())
+        return false;
+
+    m_segments = segments;
+    m_rangesSupported = fileSize == artifactSize;
+    return true;
+}
+
+void DownloadWorker::writeResumeState() const
+{
+    if ((m_etag.isEmpty() && m_lastModified.isEmpty()) || m_build.artifactSize() <= 0)
+    {
+        // without a validator, a resumed download could mix two versions of the artifact
+        QFile::remove(resumeFilePath());
+        return;
+    }
+
+    if (!m_writer->errorString().isEmpty())
+    {
+        QFile::remove(resumeFilePath());
+        return;
+    }
+
+    // the state only covers blocks the writer completed, the queued ones are fetched again
+    auto missing = m_writer->pendingRanges();
+    for (const auto &segment : m_segments)
+    {
+        // bytes still waiting for their batch are not on disk yet
+        missing.append(qMakePair(segment.offset - segment.pending.size(), segment.end));
+    }
+    std::sort(std::begin(missing), std::end(missing));
+
+    QJsonArray segments;
+    for (int i = 0, end = missing.size(); i < end;)
+    {
+        const qint64 offset = missing.at(i).first;
+        qint64 rangeEnd = missing.at(i).second;
+        // the queued blocks of a segment are right before its pending bytes
+        for (++i; i < end && missing.at(i).first <= rangeEnd; ++i)
+        {
+            rangeEnd = std::max(rangeEnd, missing.at(i).second);
+        }
+        segments.append(QJsonArray{offset, rangeEnd});
+    }
+
+    QJsonObject state;
+    state["etag"] = QString::fromLatin1(m_etag);
+    state["lastModified"] = QString::fromLatin1(m_lastModified);
+    state["segments"] = segments;
+
+    QFile file(resumeFilePath());
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        file.write(QJsonDocument(state).toJson(QJsonDocument::Compact));
+}
+
+void DownloadWorker::discardPartial()
+{
+    m_etag.clear();
+    m_lastModified.clear();
+    m_lastSize = 0;
+    m_writer->waitForIdle();
+    m_outFile->resize(0);
+    m_outFile->seek(0);
+    QFile::remove(resumeFilePath());
+    restartStreaming();
 }
 
 }
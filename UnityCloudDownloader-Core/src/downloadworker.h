@@ -5,6 +5,7 @@
 
 #include "unityclouddownloader-core_global.h"
 #include "build.h"
+#include "contentstore.h"
 
 #include <atomic>
 #include <memory>
@@ -12,52 +13,155 @@
 #include <QObject>
 #include <QByteArray>
 #include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QVector>
 
 class QNetworkAccessManager;
 class QFile;
 class QNetworkReply;
+class QTimer;
 
 namespace ucd
 {
 
+class BandwidthLimiter;
+class DeltaDownload;
+class FileWriter;
+class ZipStreamExtractor;
+
 class DownloadWorker : public QObject
 {
     Q_OBJECT
 public:
-    explicit DownloadWorker(QObject *parent = nullptr);
+    /**
+     * @brief What made a download fail, it decides how the retry is scheduled.
+     */
+    enum class Failure : int
+    {
+        Network, // connection errors and truncated transfers
+        Server, // 5xx responses
+        Client, // 4xx responses, such as an expired artifact link
+        Corrupted, // the transfer completed but its content is wrong
+        Local, // the file can't be written or extracted
+    };
+    Q_ENUM(Failure)
+
+    explicit DownloadWorker(BandwidthLimiter *bandwidthLimiter, QObject *parent = nullptr);
     ~DownloadWorker() override;
 
     bool busy() const { return m_busy; }
 
     void download(const Build &build);
+    /**
+     * @brief Stop the download of a build and keep its partial file, so it can resume later.
+     *
+     * The worker emits downloadPaused if it was still transferring the build.
+     * A build already being extracted finishes instead.
+     */
+    void pause(const Build &build);
     void requestProgress();
 
 signals:
-    void downloadCompleted(ucd::Build build);
-    void downloadFailed(ucd::Build build);
+    void downloadCompleted(ucd::Build build, QByteArray digest);
+    void downloadFailed(ucd::Build build, ucd::DownloadWorker::Failure failure);
     void downloadRequested(ucd::Build build);
+    void downloadPaused(ucd::Build build);
+    void firstByteReceived(ucd::Build build);
+    void pauseRequested(ucd::Build build);
     void downloadUpdated(ucd::Build build, float ratio, qint64 speed);
+    void extractionUpdated(ucd::Build build, float ratio);
     void progressRequested();
 
 private slots:
     void onDownloadRequested(ucd::Build build);
+    void onPauseRequested(ucd::Build build);
+    void onDeltaFirstByte();
+    void onMetaDataChanged();
     void onReadyRead();
-    void onDownloadFinished();
+    void onSegmentFinished();
+    void onThrottleElapsed();
+    void onBufferReleased();
     void onProgressRequested();
-    void onUnzipFinished(int exitCode);
+    void onDeltaFinished(bool success);
+    void onExtractionProgress(qint64 extractedBytes, qint64 totalBytes);
+    void onExtractionFinished(bool success);
 
 private:
-    QUuid m_connectionId;
+    /**
+     * @brief A byte range of the artifact fetched over its own connection.
+     */
+    struct Segment
+    {
+        QNetworkReply *reply;
+        qint64 offset; // next byte to write
+        qint64 end; // one past the last byte of the range
+        bool finished; // the reply finished but throttled bytes are still buffered
+        bool accepted; // the response status allows writing its body
+        QByteArray pending; // received bytes not written yet, they end at offset
+    };
+
+    void startDownload();
+    void restartDownload();
+    void startSegment(int index);
+    void readSegments();
+    void readSegment(int index);
+    bool writeSegment(int index, const char *data, qint64 size);
+    bool flushSegment(int index);
+    bool flushSegments();
+    bool queueWrite(qint64 offset, const char *data, qint64 size);
+    void finishSegment(int index);
+    int segmentIndex(const QNetworkReply *reply) const;
+    bool splitSegment();
+    void adaptSegments();
+    qint64 downloadedBytes() const;
+    qint64 completedPrefix() const;
+    bool isArchive() const;
+    void restartStreaming();
+    void streamPrefix(const char *data, qint64 offset, qint64 size, qint64 budget);
+    qint64 writtenEnd(qint64 limit) const;
+    bool finishStreaming();
+    bool verifyDigest() const;
+    void completeDownload();
+    void stopDownload();
+    void failDownload(Failure failure);
+    Failure replyFailure(const QNetworkReply *reply) const;
+
+    QString resumeFilePath() const;
+    bool readResumeState();
+    void writeResumeState() const;
+    void discardPartial();
+
     std::atomic_bool m_busy;
     QNetworkAccessManager *m_network;
+    BandwidthLimiter *m_bandwidthLimiter;
+    QTimer *m_throttleTimer;
+    FileWriter *m_writer;
+    DeltaDownload *m_delta;
     Build m_build;
     QString m_storagePath;
+    ContentStore m_store;
     QString m_filePath;
     std::unique_ptr<QFile> m_outFile;
     QByteArray m_buffer;
-    QNetworkReply *m_reply;
+    QVector<Segment> m_segments;
+    QByteArray m_etag;
+    QByteArray m_lastModified; // If-Range validator when the server sends no ETag
     QElapsedTimer m_progressTimer;
     qint64 m_lastSize;
+    bool m_rejected;
+    bool m_firstByteReceived;
+    bool m_rangesSupported;
+    bool m_segmentsSettled;
+    int m_segmentTarget;
+    QElapsedTimer m_segmentTimer;
+    qint64 m_segmentBytes;
+    qint64 m_lastThroughput;
+    std::unique_ptr<ZipStreamExtractor> m_extractor;
+    std::unique_ptr<QFile> m_streamSource;
+    qint64 m_streamedOffset;
+    QCryptographicHash m_hash;
+    bool m_hashing;
+    QByteArray m_digest;
 };
 
 }
@@ -0,0 +1,70 @@
+#include "filesystem.h"
+
+#include <QFile>
+#include <QDir>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#endif
+
+namespace ucd
+{
+
+bool preallocateFile(QFile &file, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    int fd = file.handle();
+    if (fd < 0)
+        return false;
+
+    // the size is kept so a partial file still tells how much was downloaded
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0)
+        return true;
+    return errno == EOPNOTSUPP || errno == ENOSYS;
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(size)
+    return true;
+#endif
+}
+
+bool createHardLink(const QString &targetPath, const QString &linkPath)
+{
+#ifdef Q_OS_WIN
+    auto link = QDir::toNativeSeparators(linkPath).toStdWString();
+    auto target = QDir::toNativeSeparators(targetPath).toStdWString();
+    return CreateHardLinkW(link.c_str(), target.c_str(), nullptr) != 0;
+#else
+    return ::link(QFile::encodeName(targetPath).constData(), QFile::encodeName(linkPath).constData()) == 0;
+#endif
+}
+
+int hardLinkCount(const QString &path)
+{
+#ifdef Q_OS_WIN
+    auto nativePath = QDir::toNativeSeparators(path).toStdWString();
+    HANDLE handle = CreateFileW(nativePath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return 0;
+    BY_HANDLE_FILE_INFORMATION info;
+    int count = GetFileInformationByHandle(handle, &info) ? static_cast<int>(info.nNumberOfLinks) : 0;
+    CloseHandle(handle);
+    return count;
+#else
+    struct stat info;
+    if (::stat(QFile::encodeName(path).constData(), &info) != 0)
+        return 0;
+    return static_cast<int>(info.st_nlink);
+#endif
+}
+
+}
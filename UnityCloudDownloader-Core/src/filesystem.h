@@ -0,0 +1,36 @@
+#ifndef UCD_FILESYSTEM_H
+#define UCD_FILESYSTEM_H
+
+#pragma once
+
+#include <QtGlobal>
+
+class QString;
+
+class QFile;
+
+namespace ucd
+{
+
+/**
+ * @brief Reserve the disk blocks of an open file without changing its size.
+ *
+ * This is a no-op where the platform or the file system can't do it.
+ * @return false if the space can't be reserved.
+ */
+bool preallocateFile(QFile &file, qint64 size);
+
+/**
+ * @brief Create a hard link to an existing file.
+ * @return false if the link can't be created, for instance across volumes.
+ */
+bool createHardLink(const QString &targetPath, const QString &linkPath);
+
+/**
+ * @brief Number of hard links to a file, 0 if it can't be read.
+ */
+int hardLinkCount(const QString &path);
+
+}
+
+#endif // UCD_FILESYSTEM_H
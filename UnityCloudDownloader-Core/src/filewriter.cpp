@@ -0,0 +1,210 @@
+#include "filewriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QFile>
+
+namespace ucd
+{
+
+enum
+{
+    BufferCount = 8,
+    BufferSize = 1024 * 1024,
+};
+
+FileWriter::FileWriter(QObject *parent)
+    : QThread(parent)
+    , m_buffers(BufferCount)
+    , m_file(nullptr)
+    , m_starved(false)
+    , m_stopping(false)
+    , m_peakDepth(0)
+    , m_stalls(0)
+{
+    for (int i = 0; i < BufferCount; ++i)
+    {
+        m_freeBuffers.append(i);
+    }
+    setObjectName(QStringLiteral("FileWriter"));
+}
+
+FileWriter::~FileWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_queued.wakeAll();
+    }
+    wait();
+}
+
+int FileWriter::blockSize()
+{
+    return BufferSize;
+}
+
+void FileWriter::setFile(QFile *file)
+{
+    waitForIdle();
+
+    QMutexLocker locker(&m_mutex);
+    m_file = file;
+    m_error.clear();
+    m_peakDepth = 0;
+    m_stalls = 0;
+    if (file == nullptr)
+    {
+        // buffers are only kept around while a file is being written
+        for (auto &buffer : m_buffers)
+        {
+            buffer = nullptr;
+        }
+    }
+}
+
+bool FileWriter::write(qint64 offset, const char *data, qint64 size)
+{
+    Q_ASSERT(size <= BufferSize);
+
+    int index = -1;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_error.isEmpty() || m_file == nullptr)
+            return false;
+        if (m_freeBuffers.isEmpty())
+            ++m_stalls;
+        while (m_freeBuffers.isEmpty())
+        {
+            m_released.wait(&m_mutex);
+        }
+        index = m_freeBuffers.takeLast();
+    }
+
+    // a free buffer is never touched by the writing thread
+    auto &buffer = m_buffers[static_cast<size_t>(index)];
+    if (buffer == nullptr)
+        buffer = std::make_unique<char[]>(BufferSize);
+    std::memcpy(buffer.get(), data, static_cast<size_t>(size));
+
+    QMutexLocker locker(&m_mutex);
+    m_blocks.enqueue(Block{index, offset, size});
+    m_peakDepth = std::max(m_peakDepth, m_blocks.size());
+    m_queued.wakeOne();
+    return true;
+}
+
+bool FileWriter::full()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_freeBuffers.isEmpty())
+        return false;
+
+    // polling again during the same stall doesn't count
+    if (!m_starved)
+        ++m_stalls;
+    m_starved = true;
+    return true;
+}
+
+bool FileWriter::waitForIdle()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_blocks.isEmpty())
+    {
+        m_released.wait(&m_mutex);
+    }
+    return m_error.isEmpty();
+}
+
+QVector<QPair<qint64, qint64>> FileWriter::pendingRanges() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QPair<qint64, qint64>> ranges;
+    ranges.reserve(m_blocks.size());
+    for (const auto &block : m_blocks)
+    {
+        ranges.append(qMakePair(block.offset, block.offset + block.size));
+    }
+    return ranges;
+}
+
+QString FileWriter::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+int FileWriter::capacity() const
+{
+    return BufferCount;
+}
+
+int FileWriter::queueDepth() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blocks.size();
+}
+
+int FileWriter::peakQueueDepth() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_peakDepth;
+}
+
+qint64 FileWriter::stallCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stalls;
+}
+
+void FileWriter::run()
+{
+    forever
+    {
+        Block block;
+        QFile *file = nullptr;
+        bool skip = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_blocks.isEmpty() && !m_stopping)
+            {
+                m_queued.wait(&m_mutex);
+            }
+            if (m_blocks.isEmpty())
+                return;
+            // the block stays queued until it is written so waitForIdle() covers it
+            block = m_blocks.head();
+            file = m_file;
+            skip = !m_error.isEmpty();
+        }
+
+        QString error;
+        if (!skip)
+        {
+            const char *data = m_buffers[static_cast<size_t>(block.buffer)].get();
+            if ((file->pos() != block.offset && !file->seek(block.offset))
+                    || file->write(data, block.size) != block.size)
+            {
+                error = file->errorString();
+            }
+        }
+
+        bool notify = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_blocks.dequeue();
+            m_freeBuffers.append(block.buffer);
+            if (!error.isEmpty() && m_error.isEmpty())
+                m_error = error;
+            notify = m_starved;
+            m_starved = false;
+            m_released.wakeAll();
+        }
+        if (notify)
+            emit bufferReleased();
+    }
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef UCD_FILEWRITER_H
+#define UCD_FILEWRITER_H
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QPair>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+
+class QFile;
+
+namespace ucd
+{
+
+/**
+ * @brief Writes blocks to a file from its own thread.
+ *
+ * Blocks are copied into a fixed ring of buffers and written in the order
+ * they were queued. Callers check full() before producing more data and
+ * are notified with bufferReleased() once a buffer is available again.
+ * The file must not be used by anyone else while writes are pending.
+ */
+class FileWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FileWriter(QObject *parent = nullptr);
+    ~FileWriter() override;
+
+    static int blockSize();
+
+    /**
+     * @brief Set the file subsequent writes go to, waits for the pending ones first.
+     */
+    void setFile(QFile *file);
+    /**
+     * @brief Queue a block of at most blockSize() bytes, blocks while the ring is full.
+     * @return false if a previous write failed.
+     */
+    bool write(qint64 offset, const char *data, qint64 size);
+    /**
+     * @brief Check if the ring is full, bufferReleased() is emitted once it isn't.
+     */
+    bool full();
+    /**
+     * @brief Wait until every queued block reached the file.
+     * @return false if a write failed.
+     */
+    bool waitForIdle();
+    /**
+     * @brief Byte ranges queued but not written yet, as offset and end.
+     */
+    QVector<QPair<qint64, qint64>> pendingRanges() const;
+
+    QString errorString() const;
+    int capacity() const;
+    int queueDepth() const;
+    int peakQueueDepth() const;
+    qint64 stallCount() const;
+
+signals:
+    void bufferReleased();
+
+protected:
+    void run() override;
+
+private:
+    struct Block
+    {
+        int buffer;
+        qint64 offset;
+        qint64 size;
+    };
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_released;
+    std::vector<std::unique_ptr<char[]>> m_buffers;
+    QVector<int> m_freeBuffers;
+    QQueue<Block> m_blocks;
+    QFile *m_file;
+    QString m_error;
+    bool m_starved;
+    bool m_stopping;
+    int m_peakDepth;
+    qint64 m_stalls;
+};
+
+}
+
+#endif // UCD_FILEWRITER_H
@@ -0,0 +1,46 @@
+#include "networksession.h"
+
+#include <QCoreApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QThread>
+#include <QThreadStorage>
+#include <QUrl>
+
+namespace ucd
+{
+
+static QThreadStorage<QNetworkAccessManager*> s_managers;
+
+QNetworkAccessManager *NetworkSession::manager()
+{
+    // the main thread's storage is only released after the application is gone, too late for a manager
+    auto *application = QCoreApplication::instance();
+    if (application != nullptr && QThread::currentThread() == application->thread())
+    {
+        static QPointer<QNetworkAccessManager> mainManager;
+        if (mainManager.isNull())
+        {
+            mainManager = new QNetworkAccessManager(application);
+            QObject::connect(application, &QCoreApplication::aboutToQuit, mainManager.data(), &QObject::deleteLater);
+        }
+        return mainManager.data();
+    }
+
+    if (!s_managers.hasLocalData())
+        s_managers.setLocalData(new QNetworkAccessManager());
+    return s_managers.localData();
+}
+
+void NetworkSession::prepareApiRequest(QNetworkRequest &request)
+{
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+}
+
+void NetworkSession::preconnect(const QUrl &url)
+{
+    manager()->connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)));
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef UCD_NETWORKSESSION_H
+#define UCD_NETWORKSESSION_H
+
+#pragma once
+
+class QNetworkAccessManager;
+class QNetworkRequest;
+class QUrl;
+
+namespace ucd
+{
+
+/**
+ * @brief Network access shared by everything running on a thread.
+ *
+ * QNetworkAccessManager keeps its connections alive and caches TLS sessions,
+ * but only for its own requests. Each thread gets a single manager instead of
+ * one per client, so API calls reuse the connections of the previous ones.
+ * The manager lives until its thread exits, the one of the main thread until
+ * the application quits.
+ */
+class NetworkSession
+{
+public:
+    NetworkSession() = delete;
+
+    /**
+     * @brief The manager of the calling thread, created on first use.
+     */
+    static QNetworkAccessManager* manager();
+    /**
+     * @brief Let an API request multiplex over HTTP/2 when the server offers it.
+     */
+    static void prepareApiRequest(QNetworkRequest &request);
+    /**
+     * @brief Open a TLS connection to the host of the url ahead of the first request.
+     */
+    static void preconnect(const QUrl &url);
+};
+
+}
+
+#endif // UCD_NETWORKSESSION_H
@@ -7,6 +7,8 @@ namespace ucd
 
 Profile::Profile()
     : m_uuid(QUuid::createUuid())
+    , m_maxDownloads(0)
+    , m_deduplicate(false)
 {}
 
 Profile::Profile(Profile &&other) noexcept
@@ -14,6 +16,8 @@ Profile::Profile(Profile &&other) noexcept
     , m_name(std::move(other.m_name))
     , m_apiKey(std::move(other.m_apiKey))
     , m_rootPath(std::move(other.m_rootPath))
+    , m_maxDownloads(other.m_maxDownloads)
+    , m_deduplicate(other.m_deduplicate)
     , m_projects(std::move(other.m_projects))
 {}
 
@@ -51,6 +55,16 @@ void Profile::setRootPath(const QString &rootPath)
     m_rootPath = rootPath;
 }
 
+void Profile::setMaxDownloads(int value)
+{
+    m_maxDownloads = value;
+}
+
+void Profile::setDeduplicate(bool value)
+{
+    m_deduplicate = value;
+}
+
 void Profile::setProjects(const ProjectList &projects)
 {
     m_projects = projects;
@@ -85,7 +99,7 @@ QDataStream &operator>>(QDataStream &in, ucd::ProjectList &dest)
 
 QDataStream &operator<<(QDataStream &out, const ucd::Profile &value)
 {
-    out << value.uuid() << value.name() << value.apiKey() << value.rootPath() << value.projects();
+    out << value.uuid() << value.name() << value.apiKey() << value.rootPath() << value.maxDownloads() << value.deduplicate() << value.projects();
 
     return out;
 }
@@ -100,6 +114,10 @@ QDataStream &operator>>(QDataStream &in, ucd::Profile &dest)
     in >> apiKey;
     QString rootPath;
     in >> rootPath;
+    int maxDownloads;
+    in >> maxDownloads;
+    bool deduplicate;
+    in >> deduplicate;
     ucd::ProjectList projects;
     in >> projects;
 
@@ -107,6 +125,8 @@ QDataStream &operator>>(QDataStream &in, ucd::Profile &dest)
     dest.setName(name);
     dest.setApiKey(apiKey);
     dest.setRootPath(rootPath);
+    dest.setMaxDownloads(maxDownloads);
+    dest.setDeduplicate(deduplicate);
     dest.setProjects(projects);
 
     return in;
@@ -2,6 +2,8 @@
 
 #include "profile.h"
 #include "projectdao.h"
+#include "sqlhelpers.h"
+#include "cachedquery.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
@@ -18,23 +20,28 @@ void ProfileDao::init()
 {
     QSqlQuery query(m_db);
     if (!query.exec("CREATE TABLE IF NOT EXISTS "
-               "Profiles (profileId TEXT PRIMARY KEY, name TEXT, rootPath TEXT, apiKey TEXT)"))
+               "Profiles (profileId BLOB PRIMARY KEY, name TEXT, rootPath TEXT, apiKey TEXT, maxDownloads INT DEFAULT 0, deduplicate BOOLEAN DEFAULT 0)"))
     {
         auto error = query.lastError().text().toUtf8();
         qFatal("%s", error.data());
         throw std::runtime_error(error);
     }
+
+    ensureColumn(m_db, QStringLiteral("Profiles"), QStringLiteral("maxDownloads"), QStringLiteral("INT DEFAULT 0"));
+    ensureColumn(m_db, QStringLiteral("Profiles"), QStringLiteral("deduplicate"), QStringLiteral("BOOLEAN DEFAULT 0"));
 }
 
 void ProfileDao::addProfile(const Profile &profile)
 {
-    QSqlQuery query(m_db);
-    query.prepare("INSERT INTO Profiles (profileId, name, rootPath, apiKey) "
-                  "VALUES (:profileId, :name, :rootPath, :apiKey)");
-    query.bindValue(":profileId", profile.uuid().toString());
+    CachedQuery query(m_db);
+    query.prepare("INSERT INTO Profiles (profileId, name, rootPath, apiKey, maxDownloads, deduplicate) "
+                  "VALUES (:profileId, :name, :rootPath, :apiKey, :maxDownloads, :deduplicate)");
+    query.bindValue(":profileId", uuidToSql(profile.uuid()));
     query.bindValue(":name", profile.name());
     query.bindValue(":rootPath", profile.rootPath());
     query.bindValue(":apiKey", profile.apiKey());
+    query.bindValue(":maxDownloads", profile.maxDownloads());
+    query.bindValue(":deduplicate", profile.deduplicate());
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -45,13 +52,15 @@ void ProfileDao::addProfile(const Profile &profile)
 
 void ProfileDao::updateProfile(const Profile &profile)
 {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE Profiles SET name = :name, rootPath = :rootPath, apiKey = :apiKey "
+    CachedQuery query(m_db);
+    query.prepare("UPDATE Profiles SET name = :name, rootPath = :rootPath, apiKey = :apiKey, maxDownloads = :maxDownloads, deduplicate = :deduplicate "
                   "WHERE profileId = :profileId");
-    query.bindValue(":profileId", profile.uuid().toString());
+    query.bindValue(":profileId", uuidToSql(profile.uuid()));
     query.bindValue(":name", profile.name());
     query.bindValue(":rootPath", profile.rootPath());
     query.bindValue(":apiKey", profile.apiKey());
+    query.bindValue(":maxDownloads", profile.maxDownloads());
+    query.bindValue(":deduplicate", profile.deduplicate());
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -62,9 +71,9 @@ void ProfileDao::updateProfile(const Profile &profile)
 
 void ProfileDao::removeProfile(const QUuid &profileId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM Profiles WHERE profileId = :profileId");
-    query.bindValue(":profileId", profileId.toString());
+    query.bindValue(":profileId", uuidToSql(profileId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -83,10 +92,12 @@ QVector<Profile> ProfileDao::profiles(bool includeProjects)
     while (query.next())
     {
         Profile profile;
-        profile.setUuid(QUuid::fromString(query.value("profileId").toString()));
+        profile.setUuid(uuidFromSql(query.value("profileId")));
         profile.setName(query.value("name").toString());
         profile.setRootPath(query.value("rootPath").toString());
         profile.setApiKey(query.value("apiKey").toString());
+        profile.setMaxDownloads(query.value("maxDownloads").toInt());
+        profile.setDeduplicate(query.value("deduplicate").toBool());
         if (includeProjects)
         {
             profile.setProjects(ProjectDao(m_db).projects(profile.uuid(), true));
@@ -100,9 +111,9 @@ QVector<Profile> ProfileDao::profiles(bool includeProjects)
 Profile ProfileDao::profile(const QUuid &profileId)
 {
     Profile profile;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT * FROM Profiles WHERE profileId = :profileId");
-    query.bindValue(":profileId", profileId.toString());
+    query.bindValue(":profileId", uuidToSql(profileId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -111,10 +122,12 @@ Profile ProfileDao::profile(const QUuid &profileId)
     }
     else if (query.next())
     {
-        profile.setUuid(QUuid::fromString(query.value("profileId").toString()));
+        profile.setUuid(uuidFromSql(query.value("profileId")));
         profile.setName(query.value("name").toString());
         profile.setRootPath(query.value("rootPath").toString());
         profile.setApiKey(query.value("apiKey").toString());
+        profile.setMaxDownloads(query.value("maxDownloads").toInt());
+        profile.setDeduplicate(query.value("deduplicate").toBool());
     }
 
     return profile;
@@ -122,9 +135,9 @@ Profile ProfileDao::profile(const QUuid &profileId)
 
 QString ProfileDao::getApiKey(const QUuid &profileId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT apiKey FROM Profiles WHERE profileId = :profileId");
-    query.bindValue(":profileId", profileId.toString());
+    query.bindValue(":profileId", uuidToSql(profileId));
     query.exec();
 
     if (query.next())
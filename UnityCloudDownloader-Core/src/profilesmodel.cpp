@@ -88,6 +88,10 @@ QVariant ProfilesModel::data(const QModelIndex &index, int role) const
         return profile.uuid();
     case Roles::RootPath:
         return  profile.rootPath();
+    case Roles::MaxDownloads:
+        return profile.maxDownloads();
+    case Roles::Deduplicate:
+        return profile.deduplicate();
     default:
         break;
     }
@@ -114,6 +118,12 @@ bool ProfilesModel::setData(const QModelIndex &index, const QVariant &value, int
     case Roles::RootPath:
         profile.setRootPath(value.toString());
         break;
+    case Roles::MaxDownloads:
+        profile.setMaxDownloads(value.toInt());
+        break;
+    case Roles::Deduplicate:
+        profile.setDeduplicate(value.toBool());
+        break;
     default:
         return false;
     }
@@ -149,6 +159,8 @@ QHash<int, QByteArray> ProfilesModel::roleNames() const
     roles[Roles::ApiKey] = "apiKey";
     roles[Roles::RootPath] = "rootPath";
     roles[Roles::ProfileId] = "id";
+    roles[Roles::MaxDownloads] = "maxDownloads";
+    roles[Roles::Deduplicate] = "deduplicate";
     return roles;
 }
 
@@ -2,6 +2,8 @@
 
 #include "project.h"
 #include "buildtargetdao.h"
+#include "sqlhelpers.h"
+#include "cachedquery.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
@@ -18,8 +20,8 @@ void ProjectDao::init()
 {
     QSqlQuery query(m_db);
     if (!query.exec("CREATE TABLE IF NOT EXISTS Projects ("
-                    "projectId TEXT PRIMARY KEY, "
-                    "profileId TEXT, "
+                    "projectId BLOB PRIMARY KEY, "
+                    "profileId BLOB, "
                     "cloudId TEXT, "
                     "name TEXT, "
                     "orgId TEXT, "
@@ -33,11 +35,11 @@ void ProjectDao::init()
 
 void ProjectDao::addProject(const Project &project)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("INSERT INTO Projects (projectId, profileId, cloudId, name, orgId, iconPath) "
                   "VALUES (:projectId, :profileId, :cloudId, :name, :orgId, :iconPath)");
-    query.bindValue(":projectId", project.id().toString());
-    query.bindValue(":profileId", project.profileId().toString());
+    query.bindValue(":projectId", uuidToSql(project.id()));
+    query.bindValue(":profileId", uuidToSql(project.profileId()));
     query.bindValue(":cloudId", project.cloudId());
     query.bindValue(":name", project.name());
     query.bindValue(":orgId", project.organisationId());
@@ -52,12 +54,12 @@ void ProjectDao::addProject(const Project &project)
 
 void ProjectDao::updateProject(const Project &project)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("UPDATE Projects SET name = :name, iconPath = :iconPath "
                   "WHERE projectId = :projectId");
     query.bindValue(":name", project.name());
     query.bindValue(":iconPath", project.iconPath());
-    query.bindValue(":projectId", project.id());
+    query.bindValue(":projectId", uuidToSql(project.id()));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -68,9 +70,9 @@ void ProjectDao::updateProject(const Project &project)
 
 void ProjectDao::removeProject(const QUuid &projectId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("DELETE FROM Projects WHERE projectId = :projectId");
-    query.bindValue(":projectId", projectId);
+    query.bindValue(":projectId", uuidToSql(projectId));
     if (!query.exec())
     {
         auto error = query.lastError().text().toUtf8();
@@ -84,7 +86,7 @@ void ProjectDao::removeProject(const QUuid &projectId)
 QVector<Project> ProjectDao::projects(const QUuid &profileId, bool includeBuildTargets)
 {
     QVector<Project> projects;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     if (profileId.isNull())
     {
         query.exec("SELECT * FROM Projects");
@@ -92,14 +94,14 @@ QVector<Project> ProjectDao::projects(const QUuid &profileId, bool includeBuildT
     else
     {
         query.prepare("SELECT * FROM Projects WHERE profileId = :profileId");
-        query.bindValue(":profileId", profileId.toString());
+        query.bindValue(":profileId", uuidToSql(profileId));
         query.exec();
     }
     while (query.next())
     {
         Project project;
-        project.setId(QUuid::fromString(query.value("projectId").toString()));
-        project.setProfileId(QUuid::fromString(query.value("profileId").toString()));
+        project.setId(uuidFromSql(query.value("projectId")));
+        project.setProfileId(uuidFromSql(query.value("profileId")));
         project.setCloudId(query.value("cloudId").toString());
         project.setName(query.value("name").toString());
         project.setOrganisationId(query.value("orgId").toString());
@@ -117,14 +119,19 @@ QVector<Project> ProjectDao::projects(const QUuid &profileId, bool includeBuildT
 Project ProjectDao::project(const QUuid &projectId, bool includeBuildTargets)
 {
     Project project;
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT * FROM Projects WHERE projectId = :projectId");
-    query.bindValue(":projectId", projectId.toString());
-    query.exec();
+    query.bindValue(":projectId", uuidToSql(projectId));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
     if (query.next())
     {
         project.setId(projectId);
-        project.setProfileId(QUuid::fromString(query.value("profileId").toString()));
+        project.setProfileId(uuidFromSql(query.value("profileId")));
         project.setCloudId(query.value("cloudId").toString());
         project.setName(query.value("name").toString());
         project.setOrganisationId(query.value("orgId").toString());
@@ -145,13 +152,13 @@ Project ProjectDao::project(const QUuid &projectId, bool includeBuildTargets)
 
 void ProjectDao::removeProjects(const QUuid &profileId)
 {
-    QSqlQuery query(m_db);
+    CachedQuery query(m_db);
     query.prepare("SELECT projectId FROM Projects WHERE profileId = :profileId");
-    query.bindValue(":profileId", profileId.toString());
+    query.bindValue(":profileId", uuidToSql(profileId));
     query.exec();
     while (query.next())
     {
-        auto projectId = QUuid::fromString(query.value("projectId").toString());
+        auto projectId = uuidFromSql(query.value("projectId"));
         removeProject(projectId);
     }
 }
@@ -0,0 +1,80 @@
+#include "responsecachedao.h"
+
+#include "cachedquery.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+
+namespace ucd
+{
+
+ResponseCacheDao::ResponseCacheDao(const QSqlDatabase &database)
+    : m_db(database)
+{}
+
+void ResponseCacheDao::init()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS ResponseCache ("
+                    "cacheKey TEXT PRIMARY KEY, "
+                    "etag TEXT, "
+                    "lastModified TEXT)"))
+    {
+        auto error = query.lastError().text().toUtf8();
+        qFatal("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+ResponseCacheDao::Validators ResponseCacheDao::validators(const QByteArray &cacheKey)
+{
+    CachedQuery query(m_db);
+    query.prepare("SELECT etag, lastModified FROM ResponseCache WHERE cacheKey = :cacheKey");
+    query.bindValue(":cacheKey", QString::fromLatin1(cacheKey));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+
+    Validators validators;
+    if (query.next())
+    {
+        validators.etag = query.value("etag").toString().toLatin1();
+        validators.lastModified = query.value("lastModified").toString().toLatin1();
+    }
+    return validators;
+}
+
+void ResponseCacheDao::setValidators(const QByteArray &cacheKey, const Validators &validators)
+{
+    CachedQuery query(m_db);
+    query.prepare("INSERT OR REPLACE INTO ResponseCache (cacheKey, etag, lastModified) "
+                  "VALUES (:cacheKey, :etag, :lastModified)");
+    query.bindValue(":cacheKey", QString::fromLatin1(cacheKey));
+    query.bindValue(":etag", QString::fromLatin1(validators.etag));
+    query.bindValue(":lastModified", QString::fromLatin1(validators.lastModified));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+void ResponseCacheDao::removeValidators(const QByteArray &cacheKey)
+{
+    CachedQuery query(m_db);
+    query.prepare("DELETE FROM ResponseCache WHERE cacheKey = :cacheKey");
+    query.bindValue(":cacheKey", QString::fromLatin1(cacheKey));
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+} // namespace ucd
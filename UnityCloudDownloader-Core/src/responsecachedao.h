@@ -0,0 +1,41 @@
+#ifndef UCD_RESPONSECACHEDAO_H
+#define UCD_RESPONSECACHEDAO_H
+
+#pragma once
+
+#include <QByteArray>
+#include <QSqlDatabase>
+
+namespace ucd
+{
+
+/**
+ * @brief Validators of the last API responses, to make the next requests conditional.
+ */
+class ResponseCacheDao
+{
+public:
+    struct Validators
+    {
+        QByteArray etag;
+        QByteArray lastModified;
+
+        bool isEmpty() const { return etag.isEmpty() && lastModified.isEmpty(); }
+    };
+
+    ResponseCacheDao(const QSqlDatabase &database);
+    ~ResponseCacheDao() = default;
+
+    void init();
+
+    Validators validators(const QByteArray &cacheKey);
+    void setValidators(const QByteArray &cacheKey, const Validators &validators);
+    void removeValidators(const QByteArray &cacheKey);
+
+private:
+    QSqlDatabase m_db;
+};
+
+}
+
+#endif // UCD_RESPONSECACHEDAO_H
@@ -0,0 +1,148 @@
+#include "schemamigrations.h"
+
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QUuid>
+#include <QVariant>
+
+namespace ucd
+{
+
+/**
+ * @brief A step of the schema, it must not be changed once released.
+ */
+struct Migration
+{
+    int version;
+    const char *description;
+    QSqlError (*apply)(const QSqlDatabase &database);
+};
+
+static QSqlError execAll(const QSqlDatabase &database, std::initializer_list<const char*> statements)
+{
+    QSqlQuery query(database);
+    for (const char *statement : statements)
+    {
+        if (!query.exec(statement))
+            return query.lastError();
+    }
+    return {};
+}
+
+static QSqlError addLookupIndexes(const QSqlDatabase &database)
+{
+    // the primary key of Builds starts with buildNumber, it doesn't serve the lookups by target
+    return execAll(database, {
+                       "CREATE INDEX IF NOT EXISTS BuildsByTarget ON Builds (buildTargetId, buildNumber)",
+                       "CREATE INDEX IF NOT EXISTS BuildTargetsByProject ON BuildTargets (projectId)",
+                       "CREATE INDEX IF NOT EXISTS ProjectsByProfile ON Projects (profileId)",
+                       "CREATE INDEX IF NOT EXISTS DownloadsByStatus ON Downloads (status)",
+                   });
+}
+
+static QSqlError storeBinaryIds(const QSqlDatabase &database)
+{
+    // ids were stored as braced text, they now take their 16 bytes, see uuidToSql
+    static const char *const columns[][2] = {
+        { "Profiles", "profileId" },
+        { "Projects", "projectId" },
+        { "Projects", "profileId" },
+        { "BuildTargets", "buildTargetId" },
+        { "BuildTargets", "projectId" },
+        { "Builds", "buildTargetId" },
+        { "Downloads", "buildTargetId" },
+    };
+
+    QSqlQuery select(database);
+    QSqlQuery update(database);
+    for (const auto &column : columns)
+    {
+        const QString table = QLatin1String(column[0]);
+        const QString name = QLatin1String(column[1]);
+        // there are few distinct ids, each one is rewritten in all its rows at once
+        if (!select.exec(QStringLiteral("SELECT DISTINCT %2 FROM %1 WHERE typeof(%2) = 'text'").arg(table, name)))
+            return select.lastError();
+        QStringList ids;
+        while (select.next())
+            ids.append(select.value(0).toString());
+        select.finish();
+
+        if (!update.prepare(QStringLiteral("UPDATE %1 SET %2 = :binaryId WHERE %2 = :textId").arg(table, name)))
+            return update.lastError();
+        for (const auto &id : ids)
+        {
+            update.bindValue(":binaryId", QUuid(id).toRfc4122());
+            update.bindValue(":textId", id);
+            if (!update.exec())
+                return update.lastError();
+        }
+    }
+    return {};
+}
+
+static const Migration s_migrations[] = {
+    { 1, "lookup indexes", addLookupIndexes },
+    { 2, "binary ids", storeBinaryIds },
+};
+
+static void fail(QSqlDatabase &database, const QSqlError &sqlError)
+{
+    auto error = sqlError.text().toUtf8();
+    database.rollback();
+    qFatal("%s", error.data());
+    throw std::runtime_error(error);
+}
+
+int schemaVersion(const QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (!query.exec("PRAGMA user_version") || !query.next())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qFatal("%s", error.data());
+        throw std::runtime_error(error);
+    }
+    return query.value(0).toInt();
+}
+
+void migrateSchema(const QSqlDatabase &sqlDatabase)
+{
+    QSqlDatabase database(sqlDatabase);
+    const int version = schemaVersion(database);
+    const int latest = std::end(s_migrations)[-1].version;
+    if (version > latest)
+    {
+        qWarning("The database schema (version %d) is newer than this application (version %d)", version, latest);
+        return;
+    }
+
+    for (const auto &migration : s_migrations)
+    {
+        if (migration.version <= version)
+            continue;
+
+        qInfo("Migrating the database to version %d (%s)", migration.version, migration.description);
+        if (!database.transaction())
+            fail(database, database.lastError());
+
+        auto error = migration.apply(database);
+        if (error.type() != QSqlError::NoError)
+            fail(database, error);
+        QSqlQuery query(database);
+        // pragmas don't take bound values
+        if (!query.exec(QStringLiteral("PRAGMA user_version = %1").arg(migration.version)))
+            fail(database, query.lastError());
+        query.finish();
+
+        if (!database.commit())
+            fail(database, database.lastError());
+    }
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef UCD_SCHEMAMIGRATIONS_H
+#define UCD_SCHEMAMIGRATIONS_H
+
+#pragma once
+
+class QSqlDatabase;
+
+namespace ucd
+{
+
+/**
+ * @brief Bring the schema of a database to the latest version.
+ *
+ * The version is kept in the user_version pragma. Each migration runs in
+ * its own transaction along with its version bump, so a failed migration
+ * leaves the database at the previous version. Call it once the DAOs have
+ * created their tables.
+ */
+void migrateSchema(const QSqlDatabase &database);
+
+/**
+ * @brief The schema version of a database, 0 before any migration.
+ */
+int schemaVersion(const QSqlDatabase &database);
+
+}
+
+#endif // UCD_SCHEMAMIGRATIONS_H
@@ -0,0 +1,62 @@
+#include "settingsdao.h"
+
+#include "cachedquery.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+
+namespace ucd
+{
+
+SettingsDao::SettingsDao(const QSqlDatabase &database)
+    : m_db(database)
+{}
+
+void SettingsDao::init()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS Settings ("
+                    "key TEXT PRIMARY KEY, "
+                    "value TEXT)"))
+    {
+        auto error = query.lastError().text().toUtf8();
+        qFatal("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+QVariant SettingsDao::value(const QString &key, const QVariant &defaultValue)
+{
+    CachedQuery query(m_db);
+    query.prepare("SELECT value FROM Settings WHERE key = :key");
+    query.bindValue(":key", key);
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+
+    if (query.next())
+    {
+        return query.value(0);
+    }
+
+    return defaultValue;
+}
+
+void SettingsDao::setValue(const QString &key, const QVariant &value)
+{
+    CachedQuery query(m_db);
+    query.prepare("INSERT OR REPLACE INTO Settings (key, value) VALUES (:key, :value)");
+    query.bindValue(":key", key);
+    query.bindValue(":value", value.toString());
+    if (!query.exec())
+    {
+        auto error = query.lastError().text().toUtf8();
+        qCritical("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+} // namespace ucd
@@ -0,0 +1,29 @@
+#ifndef UCD_SETTINGSDAO_H
+#define UCD_SETTINGSDAO_H
+
+#pragma once
+
+#include <QSqlDatabase>
+#include <QVariant>
+
+namespace ucd
+{
+
+class SettingsDao
+{
+public:
+    SettingsDao(const QSqlDatabase &database);
+    ~SettingsDao() = default;
+
+    void init();
+
+    QVariant value(const QString &key, const QVariant &defaultValue = {});
+    void setValue(const QString &key, const QVariant &value);
+
+private:
+    QSqlDatabase m_db;
+};
+
+}
+
+#endif // UCD_SETTINGSDAO_H
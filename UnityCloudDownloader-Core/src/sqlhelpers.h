@@ -0,0 +1,65 @@
+#ifndef UCD_SQLHELPERS_H
+#define UCD_SQLHELPERS_H
+
+#pragma once
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QUuid>
+#include <QVariant>
+
+#include <stdexcept>
+
+namespace ucd
+{
+
+/**
+ * @brief Bind value of an id column, ids are stored as their 16 bytes.
+ */
+inline QVariant uuidToSql(const QUuid &uuid)
+{
+    return uuid.toRfc4122();
+}
+
+/**
+ * @brief Read an id column, a malformed value gives a null id.
+ */
+inline QUuid uuidFromSql(const QVariant &value)
+{
+    return QUuid::fromRfc4122(value.toByteArray());
+}
+
+/**
+ * @brief Add a column to an existing table if it is missing.
+ *
+ * Tables are created with `CREATE TABLE IF NOT EXISTS`, so databases created
+ * by older versions need their new columns added separately.
+ */
+inline void ensureColumn(const QSqlDatabase &database, const QString &table, const QString &column, const QString &definition)
+{
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral("PRAGMA table_info(%1)").arg(table)))
+    {
+        auto error = query.lastError().text().toUtf8();
+        qFatal("%s", error.data());
+        throw std::runtime_error(error);
+    }
+
+    while (query.next())
+    {
+        if (query.value("name").toString() == column)
+            return;
+    }
+
+    if (!query.exec(QStringLiteral("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, column, definition)))
+    {
+        auto error = query.lastError().text().toUtf8();
+        qFatal("%s", error.data());
+        throw std::runtime_error(error);
+    }
+}
+
+}
+
+#endif // UCD_SQLHELPERS_H
@@ -1,6 +1,7 @@
 #include "synchronizer.h"
 
 #include "build.h"
+#include "contentstore.h"
 #include "builddao.h"
 #include "buildtarget.h"
 #include "buildtargetdao.h"
@@ -9,17 +10,23 @@
 #include "profile.h"
 #include "profiledao.h"
 #include "downloadsdao.h"
+#include "settingsdao.h"
 #include "downloadworker.h"
+#include "downloadqueue.h"
 #include "servicelocator.h"
 #include "unityapiclient.h"
 #include "idatabaseprovider.h"
 
 #include <algorithm>
+#include <limits>
 
 #include <QThread>
+#include <QRandomGenerator>
 #include <QtConcurrent>
 #include <QDir>
+#include <QStorageInfo>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QDebug>
 
 namespace ucd
@@ -30,66 +37,166 @@ enum
     ProgressInterval = 300,
     ThreadJoinTimout = 2000,
     UpdateInterval = 2 * 60 * 1000,
+    DefaultConcurrency = 4,
+    MaxWorkers = 16,
+    TuneSamples = 20, // progress ticks per concurrency tuning step
+    RetryBaseDelay = 30 * 1000,
+    MaxRetryDelay = 60 * 60 * 1000,
+    MaxAttempts = 6,
+    MaxClientAttempts = 3,
+    ExtractionMultiplier = 3, // an archive and its extracted files
+    SpaceCheckInterval = 10 * 1000,
+    FullFetchInterval = 60 * 60 * 1000, // reconciles builds deleted or changed below the high-water mark
 };
 
 Synchronizer::Synchronizer(QObject *parent)
     : AbstractSynchronizer(parent)
-    , m_workerThread(new QThread(this))
-    , m_workers{}
     , m_apiClient(nullptr)
     , m_updateTimer(0)
     , m_progressTick(0)
     , m_fetchCounter(0)
+    , m_autoConcurrency(DefaultConcurrency)
+    , m_concurrencyRaised(false)
+    , m_concurrencySettled(false)
+    , m_lastThroughput(0)
+    , m_throughputSum(0)
+    , m_throughputSamples(0)
 {
     m_apiClient = new UnityApiClient(this);
+    m_apiClient->setConditionalRequests(true);
     connect(m_apiClient, &UnityApiClient::buildsFetched, this, &Synchronizer::onBuildsFetched);
+    connect(m_apiClient, &UnityApiClient::buildsUnchanged, this, &Synchronizer::onBuildsUnchanged);
     m_updateTimer = startTimer(UpdateInterval);
     m_progressTick = startTimer(ProgressInterval);
-    for (int i = 0; i < WorkerCount; ++i)
-    {
-        m_workers[i] = new DownloadWorker();
-        m_workers[i]->moveToThread(m_workerThread);
-        connect(m_workers[i], &DownloadWorker::downloadCompleted, this, &Synchronizer::onDownloadCompleted, Qt::QueuedConnection);
-        connect(m_workers[i], &DownloadWorker::downloadFailed, this, &Synchronizer::onDownloadFailed, Qt::QueuedConnection);
-        connect(m_workers[i], &DownloadWorker::downloadUpdated, this, &Synchronizer::onDownloadUpdated, Qt::QueuedConnection);
-    }
-    m_workerThread->start();
+    loadBandwidthSettings();
+    loadQueueSettings();
 
     auto downloads = DownloadsDao(ServiceLocator::database()).downloadedBuilds();
     std::sort(std::begin(downloads), std::end(downloads));
     m_downloadedBuilds = std::move(downloads);
+
+    // failed downloads wait for their retry time, even across restarts
+    for (const auto &retry : DownloadsDao(ServiceLocator::database()).retries())
+    {
+        m_retries.insert(retry.buildRef, retry);
+        if (retry.nextRetry.isValid() && (!m_nextRetry.isValid() || retry.nextRetry < m_nextRetry))
+            m_nextRetry = retry.nextRetry;
+    }
 }
 
 Synchronizer::~Synchronizer()
 {
     killTimer(m_updateTimer);
     killTimer(m_progressTick);
-    m_workerThread->requestInterruption();
-    m_workerThread->quit();
-    if (!m_workerThread->wait(ThreadJoinTimout))
+    // removed workers may still be winding down, they are children of the synchronizer too
+    const auto threads = m_workerThreads + m_retiringThreads;
+    for (auto *thread : threads)
     {
-        qCritical("Worker thread not ending nicely");
-        m_workerThread->terminate();
+        thread->requestInterruption();
+        thread->quit();
+    }
+    // the threads wind down in parallel, so the timeout applies to the whole pool
+    QElapsedTimer joinTimer;
+    joinTimer.start();
+    for (auto *thread : threads)
+    {
+        if (!thread->wait(static_cast<unsigned long>(std::max<qint64>(ThreadJoinTimout - joinTimer.elapsed(), 0))))
+        {
+            qCritical("Worker thread not ending nicely");
+            thread->terminate();
+            thread->wait();
+        }
     }
 }
 
 void Synchronizer::processQueue()
 {
-    auto workerIt = std::begin(m_workers);
-    const auto workerEnd = std::end(m_workers);
+    QHash<QUuid, int> activeDownloads;
+    for (const auto &buildRef : m_processingBuilds)
+    {
+        ++activeDownloads[profileId(buildRef.buildTargetId())];
+    }
 
-    // dispatch as many downloads as possible
-    for (int i = 0, end = std::min<int>(WorkerCount, m_queuedBuilds.size()); i < end; ++i)
+    QHash<QUuid, Profile> profiles;
+    auto profileOf = [&profiles](const QUuid &profileId) -> const Profile&
     {
-        workerIt = std::find_if(workerIt, workerEnd, [](const auto &worker) -> bool { return !worker->busy(); });
-        if (workerIt == workerEnd)
+        auto profileIt = profiles.find(profileId);
+        if (profileIt == profiles.end())
+            profileIt = profiles.insert(profileId, ProfileDao(ServiceLocator::database()).profile(profileId));
+        return profileIt.value();
+    };
+    // profiles without a configured limit share the automatically tuned one
+    auto concurrencyLimit = [this, &profileOf](const QUuid &profileId) -> int
+    {
+        int maxDownloads = profileOf(profileId).maxDownloads();
+        return maxDownloads > 0 ? maxDownloads : m_autoConcurrency;
+    };
+
+    // dispatch as many downloads as the limits allow, skipping builds of profiles that are at their limit
+    bool dispatched = false;
+    QVector<BuildRef> heldBuilds;
+    for (auto it = m_queue.begin(); it != m_queue.end();)
+    {
+        auto buildProfileId = profileId(it->build.buildTargetId());
+        if (activeDownloads.value(buildProfileId) >= concurrencyLimit(buildProfileId))
+        {
+            ++it;
+            continue;
+        }
+
+        auto *worker = idleWorker();
+        if (worker == nullptr)
             break;
 
-        auto build = m_queuedBuilds.takeFirst();
+        // builds that don't fit on their volume wait in the queue, older builds may make room for them
+        Build build = it->build;
+        if (!reserveSpace(build, profileOf(buildProfileId).rootPath()))
+        {
+            if (!m_spaceTimer.isValid())
+                qWarning() << "Not enough disk space for build" << it->build << ", holding it in the queue";
+            makeRoom(build);
+            m_spaceTimer.start();
+            heldBuilds.append(it->build);
+            ++it;
+            continue;
+        }
+
+        m_processingPriorities.insert(build, it->priority);
+        it = m_queue.take(it);
         m_processingBuilds.append(build);
-        (*workerIt)->download(build);
+        m_buildWorkers.insert(build, worker);
+        ++activeDownloads[buildProfileId];
+        worker->download(build);
         emit downloadStarted(build);
+        dispatched = true;
+    }
+
+    if (heldBuilds.isEmpty())
+        m_spaceTimer.invalidate();
+
+    // manual downloads still waiting take the worker of the least important automatic download,
+    // which is paused and queued again. a waiting manual download may already have a pause on its way
+    int waitingManual = 0;
+    for (auto it = m_queue.begin(); it != m_queue.end() && it->priority == DownloadQueue::Priority::Manual; ++it)
+    {
+        // pausing a download doesn't give disk space back
+        if (heldBuilds.contains(it->build) || waitingManual++ < m_pausingBuilds.size())
+            continue;
+        auto buildProfileId = profileId(it->build.buildTargetId());
+        // when the profile is at its limit, only one of its own downloads makes room
+        const bool profileFull = activeDownloads.value(buildProfileId) >= concurrencyLimit(buildProfileId);
+        int index = preemptionCandidate(profileFull ? buildProfileId : QUuid());
+        if (index < 0)
+            continue;
+        const BuildRef victim = m_processingBuilds.at(index);
+        qInfo() << "Pausing build" << victim << "for the manual download of" << it->build;
+        m_pausingBuilds.append(victim);
+        m_buildWorkers.value(victim)->pause(victim);
     }
+
+    if (dispatched)
+        emit queueChanged();
+    trimWorkers();
 }
 
 void Synchronizer::manualDownload(const Build &build)
@@ -97,14 +204,22 @@ void Synchronizer::manualDownload(const Build &build)
     Build updatedBuild(build);
     updatedBuild.setManualDownload(true);
     BuildDao(ServiceLocator::database()).updateBuild(updatedBuild);
-    // don't download if it is already queued or downloaded
-    if (isDownloading(build) || isQueued(build) || isDownloaded(build))
+    // don't download if it is already downloading or downloaded
+    if (isDownloading(build) || isDownloaded(build))
         return;
-    startDownload(build);
+    // asking again clears the failures, the download is attempted right away
+    if (m_retries.remove(build) > 0)
+        DownloadsDao(ServiceLocator::database()).removeRetry(build);
+    // a build queued by the synchronization moves ahead of it
+    m_queue.remove(build);
+    m_manualRequests[build].start();
+    startDownload(updatedBuild);
 }
 
 void Synchronizer::refresh()
 {
+    loadBandwidthSettings();
+    loadQueueSettings();
     auto profiles = ProfileDao(ServiceLocator::database()).profiles(true);
     for (const Profile &profile : profiles)
     {
@@ -113,19 +228,43 @@ void Synchronizer::refresh()
             for (const BuildTarget &buildTarget : project.buildTargets())
             {
                 if (buildTarget.sync())
-                {
-                    ++m_fetchCounter;
-                    m_apiClient->fetchBuilds(buildTarget);
-                }
+                    fetchBuilds(buildTarget);
                 syncTarget(profile, project, buildTarget);
             }
         }
     }
 }
 
+void Synchronizer::fetchBuilds(const BuildTarget &buildTarget)
+{
+    ++m_fetchCounter;
+    const QUuid buildTargetId = buildTarget.id();
+    auto fullIt = m_fullFetches.find(buildTargetId);
+    if (fullIt != m_fullFetches.end() && !fullIt->hasExpired(FullFetchInterval))
+    {
+        // only the builds above the high-water mark can have changed since the last fetch
+        const int settledBuildNumber = BuildDao(ServiceLocator::database()).settledBuildNumber(buildTargetId);
+        if (settledBuildNumber > 0)
+        {
+            m_partialFetches.insert(buildTargetId);
+            m_apiClient->fetchBuilds(buildTarget, settledBuildNumber);
+            return;
+        }
+    }
+
+    m_partialFetches.remove(buildTargetId);
+    m_fullFetches[buildTargetId].start();
+    m_apiClient->fetchBuilds(buildTarget);
+}
+
 bool Synchronizer::isQueued(const Build &build) const
 {
-    return m_queuedBuilds.contains(build);
+    return m_queue.contains(build) || isRetryPending(build);
+}
+
+int Synchronizer::queuePosition(const Build &build) const
+{
+    return m_queue.position(build);
 }
 
 bool Synchronizer::isDownloaded(const Build &build) const
@@ -167,18 +306,59 @@ qint64 Synchronizer::downloadSpeed(const Build &build) const
     return m_downloadStats[id].second;
 }
 
+qint64 Synchronizer::bandwidthLimit() const
+{
+    return SettingsDao(ServiceLocator::database()).value(QStringLiteral("bandwidthLimit"), 0).toLongLong();
+}
+
+void Synchronizer::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    SettingsDao(ServiceLocator::database()).setValue(QStringLiteral("bandwidthLimit"), std::max<qint64>(bytesPerSecond, 0));
+    loadBandwidthSettings();
+}
+
+QString Synchronizer::bandwidthSchedule() const
+{
+    return SettingsDao(ServiceLocator::database()).value(QStringLiteral("bandwidthSchedule")).toString();
+}
+
+void Synchronizer::setBandwidthSchedule(const QString &schedule)
+{
+    SettingsDao(ServiceLocator::database()).setValue(QStringLiteral("bandwidthSchedule"), schedule.trimmed());
+    loadBandwidthSettings();
+}
+
+QString Synchronizer::downloadQueuePolicy() const
+{
+    return m_queue.policy() == DownloadQueue::Policy::SmallestFirst ? QStringLiteral("smallest") : QStringLiteral("newest");
+}
+
+void Synchronizer::setDownloadQueuePolicy(const QString &policy)
+{
+    const auto parsedPolicy = DownloadQueue::parsePolicy(policy);
+    SettingsDao(ServiceLocator::database()).setValue(QStringLiteral("downloadQueuePolicy"),
+                                                     parsedPolicy == DownloadQueue::Policy::SmallestFirst ? QStringLiteral("smallest") : QStringLiteral("newest"));
+    if (parsedPolicy == m_queue.policy())
+        return;
+
+    m_queue.setPolicy(parsedPolicy);
+    emit queueChanged();
+}
+
 void Synchronizer::queueDownload(const Build &build)
 {
-    m_queuedBuilds.append(build);
+    m_queue.push(build, queuePriority(build));
     emit downloadQueued(build);
+    emit queueChanged();
     processQueue();
 }
 
 void Synchronizer::startDownload(const Build &build)
 {
-    // we don't actually start the download right away, instead we insert it at the begining of the queue
-    m_queuedBuilds.prepend(build);
+    // we don't actually start the download right away, manual downloads are served before the others
+    m_queue.push(build, DownloadQueue::Priority::Manual);
     emit downloadQueued(build);
+    emit queueChanged();
     processQueue();
 }
 
@@ -190,14 +370,34 @@ void Synchronizer::timerEvent(QTimerEvent *event)
     }
     else if (event->timerId() == m_progressTick)
     {
+        m_bandwidthLimiter.update(QTime::currentTime());
         for (auto *worker : m_workers)
         {
             worker->requestProgress();
         }
+
+        qint64 throughput = 0;
+        for (const auto &stats : m_downloadStats)
+        {
+            throughput += stats.second;
+        }
+        m_throughputSum += throughput;
+        if (m_nextRetry.isValid() && m_nextRetry <= QDateTime::currentDateTime())
+        {
+            requeueRetries();
+        }
+        if (m_spaceTimer.isValid() && m_spaceTimer.hasExpired(SpaceCheckInterval))
+        {
+            processQueue();
+        }
+        if (++m_throughputSamples >= TuneSamples)
+        {
+            tuneConcurrency();
+        }
     }
 }
 
-void Synchronizer::onDownloadCompleted(Build build)
+void Synchronizer::onDownloadCompleted(Build build, QByteArray digest)
 {
     if (!m_processingBuilds.removeOne(build))
     {
@@ -210,42 +410,78 @@ void Synchronizer::onDownloadCompleted(Build build)
                 build);
     m_downloadedBuilds.insert(insertIt, build);
     m_downloadStats.remove(build);
-    DownloadsDao(ServiceLocator::database()).addDownload(build);
+    m_retries.remove(build);
+    m_manualRequests.remove(build);
+    releaseBuild(build);
+    DownloadsDao(ServiceLocator::database()).addDownload(build, digest);
     emit downloadCompleted(build);
     processQueue();
 }
 
-void Synchronizer::onDownloadFailed(Build build)
+void Synchronizer::onDownloadFailed(Build build, DownloadWorker::Failure failure)
 {
     if (!m_processingBuilds.removeOne(build))
     {
         qCritical("could not remove processing build on failure");
     }
 
-    m_queuedBuilds.prepend(build);
+    // the worker keeps the partial file, so the retry resumes where this attempt stopped.
+    // the build waits out its backoff while the other downloads use the worker
+    scheduleRetry(build, failure);
     m_downloadStats.remove(build);
+    releaseBuild(build);
     emit downloadFailed(build);
     processQueue();
 }
 
+void Synchronizer::onDownloadPaused(Build build)
+{
+    if (!m_processingBuilds.removeOne(build))
+    {
+        qCritical("could not remove processing build on pause");
+    }
+
+    // the partial file is kept, the build resumes once the manual downloads are through
+    auto priority = m_processingPriorities.value(build, queuePriority(build));
+    releaseBuild(build);
+    m_downloadStats.remove(build);
+    m_queue.push(build, priority);
+    emit downloadQueued(build);
+    emit queueChanged();
+    processQueue();
+}
+
+void Synchronizer::onFirstByteReceived(Build build)
+{
+    auto requestIt = m_manualRequests.find(build);
+    if (requestIt == m_manualRequests.end())
+        return;
+
+    qInfo() << "Manual download of" << BuildRef(build) << "received its first byte after" << requestIt.value().elapsed() << "ms";
+    m_manualRequests.erase(requestIt);
+}
+
 void Synchronizer::onDownloadUpdated(Build build, float ratio, qint64 speed)
 {
     m_downloadStats[build] = qMakePair(ratio, speed);
     emit downloadUpdated(build);
 }
 
-void Synchronizer::onBuildsFetched(const QVector<Build> &builds, QUuid buildTargetId)
+void Synchronizer::onExtractionUpdated(Build build, float ratio)
 {
-    auto checkSynchronized = [this]()
-    {
-        if ((--m_fetchCounter) == 0)
-        {
-            emit synchronized();
-        }
-    };
+    // an extracting build uses no bandwidth, it shows no speed and adds none to the concurrency tuning
+    m_downloadStats[build] = qMakePair(ratio, qint64(0));
+    emit downloadUpdated(build);
+}
 
+void Synchronizer::onBuildsFetched(const QVector<Build> &builds, QUuid buildTargetId)
+{
+    const bool partial = m_partialFetches.remove(buildTargetId);
     if (builds.isEmpty())
     {
+        // a failed full fetch is retried on the next update
+        if (!partial)
+            m_fullFetches.remove(buildTargetId);
         checkSynchronized();
         auto buildTarget = BuildTargetDao(ServiceLocator::database()).buildTarget(buildTargetId);
         qWarning("fetching builds returned empty (%s)", buildTarget.name().toUtf8().data());
@@ -265,36 +501,383 @@ void Synchronizer::onBuildsFetched(const QVector<Build> &builds, QUuid buildTarg
 
     auto project = ProjectDao(db).project(buildTarget.projectId());
     auto profile = ProfileDao(db).profile(project.profileId());
-    BuildDao buildDao(db);
+    BuildDao(db).upsertBuilds(builds);
+
+    // a partial list only holds the newest builds, the decisions need the stored ones too
+    if (partial)
+    {
+        considerStoredBuilds(buildTarget);
+    }
+    else
+    {
+        int buildCount = 0;
+        for (const auto &build : builds)
+        {
+            if (considerBuild(buildTarget, build, now) && ++buildCount >= buildTarget.maxBuilds())
+                break;
+        }
+    }
+
+    checkSynchronized();
+}
+
+void Synchronizer::onBuildsUnchanged(QUuid buildTargetId)
+{
+    m_partialFetches.remove(buildTargetId);
+    auto buildTarget = BuildTargetDao(ServiceLocator::database()).buildTarget(buildTargetId);
+    // the builds stored from the last fetch are current, only the local side may have changed
+    if (buildTarget.sync())
+        considerStoredBuilds(buildTarget);
+
+    checkSynchronized();
+}
 
+void Synchronizer::considerStoredBuilds(const BuildTarget &buildTarget)
+{
+    auto now = QDateTime::currentDateTime();
     int buildCount = 0;
+    for (const auto &build : BuildDao(ServiceLocator::database()).builds(buildTarget.id()))
+    {
+        if (considerBuild(buildTarget, build, now) && ++buildCount >= buildTarget.maxBuilds())
+            break;
+    }
+}
+
+bool Synchronizer::considerBuild(const BuildTarget &buildTarget, const Build &build, const QDateTime &now)
+{
+    if (build.status() != Build::Status::Success || build.createTime().daysTo(now) > buildTarget.maxDaysOld())
+        return false;
+
+    BuildRef buildRef(build);
+    // builds given up on are only downloaded again on request
+    if (!isDownloading(buildRef) && !isQueued(buildRef) && !isDownloaded(buildRef) && !m_retries.contains(buildRef))
+    {
+        queueDownload(build);
+    }
+    return true;
+}
 
-    for (int i = 0, end = builds.size(); i < end; ++i)
+void Synchronizer::checkSynchronized()
+{
+    if ((--m_fetchCounter) == 0)
     {
-        const Build &build = builds.at(i);
-        if (buildDao.hasBuild(build))
+        emit synchronized();
+    }
+}
+
+DownloadWorker *Synchronizer::idleWorker()
+{
+    auto workerIt = std::find_if(
+                std::begin(m_workers),
+                std::end(m_workers),
+                [](const auto &worker) -> bool { return !worker->busy(); });
+    if (workerIt != std::end(m_workers))
+        return *workerIt;
+
+    if (m_workers.size() >= MaxWorkers)
+        return nullptr;
+
+    addWorker();
+    return m_workers.last();
+}
+
+void Synchronizer::addWorker()
+{
+    // each worker gets its own event loop so concurrent downloads don't share a core
+    auto *thread = new QThread(this);
+    thread->setObjectName(QStringLiteral("DownloadWorker%1").arg(m_workers.size()));
+    auto *worker = new DownloadWorker(&m_bandwidthLimiter);
+    worker->moveToThread(thread);
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &DownloadWorker::downloadCompleted, this, &Synchronizer::onDownloadCompleted, Qt::QueuedConnection);
+    connect(worker, &DownloadWorker::downloadFailed, this, &Synchronizer::onDownloadFailed, Qt::QueuedConnection);
+    connect(worker, &DownloadWorker::downloadPaused, this, &Synchronizer::onDownloadPaused, Qt::QueuedConnection);
+    connect(worker, &DownloadWorker::firstByteReceived, this, &Synchronizer::onFirstByteReceived, Qt::QueuedConnection);
+    connect(worker, &DownloadWorker::downloadUpdated, this, &Synchronizer::onDownloadUpdated, Qt::QueuedConnection);
+    connect(worker, &DownloadWorker::extractionUpdated, this, &Synchronizer::onExtractionUpdated, Qt::QueuedConnection);
+    thread->start();
+
+    m_workerThreads.append(thread);
+    m_workers.append(worker);
+}
+
+void Synchronizer::removeWorker(int index)
+{
+    // only idle workers are removed, the thread is deleted once its event loop exited without blocking the caller
+    auto *thread = m_workerThreads.takeAt(index);
+    m_workers.removeAt(index);
+    m_retiringThreads.append(thread);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    connect(thread, &QObject::destroyed, this, &Synchronizer::onWorkerThreadDestroyed);
+    thread->quit();
+}
+
+void Synchronizer::onWorkerThreadDestroyed(QObject *thread)
+{
+    m_retiringThreads.removeOne(static_cast<QThread*>(thread));
+}
+
+void Synchronizer::trimWorkers()
+{
+    // keep enough workers for the automatic limit, or for what is in flight when profiles go above it
+    int keep = std::max<int>(m_autoConcurrency, m_processingBuilds.size());
+    for (int i = m_workers.size() - 1; i >= 0 && m_workers.size() > keep; --i)
+    {
+        if (!m_workers.at(i)->busy())
+            removeWorker(i);
+    }
+}
+
+QUuid Synchronizer::profileId(const QUuid &buildTargetId)
+{
+    auto profileIt = m_targetProfiles.find(buildTargetId);
+    if (profileIt == m_targetProfiles.end())
+    {
+        auto db = ServiceLocator::database();
+        auto buildTarget = BuildTargetDao(db).buildTarget(buildTargetId);
+        auto project = ProjectDao(db).project(buildTarget.projectId());
+        profileIt = m_targetProfiles.insert(buildTargetId, project.profileId());
+    }
+    return profileIt.value();
+}
+
+void Synchronizer::tuneConcurrency()
+{
+    qint64 throughput = m_throughputSum / std::max(m_throughputSamples, 1);
+    m_throughputSum = 0;
+    m_throughputSamples = 0;
+
+    // only tune while every automatic slot is in use and downloads are waiting
+    const bool saturated = m_processingBuilds.size() >= m_autoConcurrency && !m_queue.isEmpty();
+    if (!saturated)
+    {
+        if (m_queue.isEmpty())
         {
-            buildDao.partialUpdate(build);
+            // the next batch of downloads gets to probe again
+            m_concurrencySettled = false;
         }
-        else
+        m_concurrencyRaised = false;
+        m_lastThroughput = throughput;
+        return;
+    }
+
+    if (m_concurrencyRaised)
+    {
+        // the last added download did not make the aggregate throughput rise by 10%, back off
+        m_concurrencyRaised = false;
+        if (throughput < m_lastThroughput + m_lastThroughput / 10)
         {
-            buildDao.addBuild(build);
+            m_autoConcurrency = std::max(m_autoConcurrency - 1, 1);
+            m_concurrencySettled = true;
+            qInfo("Download concurrency settled at %d (%lld B/s)", m_autoConcurrency, throughput);
         }
+    }
+    else if (!m_concurrencySettled && m_autoConcurrency < MaxWorkers)
+    {
+        ++m_autoConcurrency;
+        m_concurrencyRaised = true;
+    }
+    m_lastThroughput = throughput;
 
-        if (build.status() != Build::Status::Success || build.createTime().daysTo(now) > buildTarget.maxDaysOld())
-            continue;
+    processQueue();
+}
+
+void Synchronizer::loadBandwidthSettings()
+{
+    // rates are in bytes per second, 0 is unlimited
+    SettingsDao settings(ServiceLocator::database());
+    m_bandwidthLimiter.setDefaultRate(settings.value(QStringLiteral("bandwidthLimit"), 0).toLongLong());
+    m_bandwidthLimiter.setSchedule(BandwidthLimiter::parseSchedule(settings.value(QStringLiteral("bandwidthSchedule")).toString()));
+    m_bandwidthLimiter.update(QTime::currentTime());
+}
+
+void Synchronizer::loadQueueSettings()
+{
+    m_queue.setPolicy(DownloadQueue::parsePolicy(
+                          SettingsDao(ServiceLocator::database()).value(QStringLiteral("downloadQueuePolicy")).toString()));
+}
 
-        BuildRef buildRef(build);
-        if (!isDownloading(buildRef) && !isQueued(buildRef) && !isDownloaded(buildRef))
+DownloadQueue::Priority Synchronizer::queuePriority(const Build &build) const
+{
+    if (build.manualDownload())
+        return DownloadQueue::Priority::Manual;
+
+    // downloaded builds are sorted by target then number, a newer one of the same target follows this build
+    auto newerIt = std::upper_bound(std::begin(m_downloadedBuilds), std::end(m_downloadedBuilds), BuildRef(build));
+    if (newerIt != std::end(m_downloadedBuilds) && newerIt->buildTargetId() == build.buildTargetId())
+        return DownloadQueue::Priority::Backfill;
+    return DownloadQueue::Priority::Latest;
+}
+
+int Synchronizer::preemptionCandidate(const QUuid &profileId) const
+{
+    // the backfill goes first, then the download that made the least progress
+    int candidate = -1;
+    for (int i = 0, end = m_processingBuilds.size(); i < end; ++i)
+    {
+        const auto &buildRef = m_processingBuilds.at(i);
+        auto priority = m_processingPriorities.value(buildRef, DownloadQueue::Priority::Manual);
+        if (priority == DownloadQueue::Priority::Manual || m_pausingBuilds.contains(buildRef))
+            continue;
+        if (!profileId.isNull() && m_targetProfiles.value(buildRef.buildTargetId()) != profileId)
+            continue;
+        if (candidate >= 0)
         {
-            queueDownload(build);
+            const auto &other = m_processingBuilds.at(candidate);
+            auto otherPriority = m_processingPriorities.value(other);
+            if (priority < otherPriority)
+                continue;
+            if (priority == otherPriority && m_downloadStats.value(buildRef).first >= m_downloadStats.value(other).first)
+                continue;
         }
+        candidate = i;
+    }
+    return candidate;
+}
 
-        if (++buildCount >= buildTarget.maxBuilds())
-            break;
+void Synchronizer::releaseBuild(const BuildRef &buildRef)
+{
+    m_buildWorkers.remove(buildRef);
+    m_processingPriorities.remove(buildRef);
+    m_reservations.remove(buildRef);
+    m_pausingBuilds.removeOne(buildRef);
+}
+
+bool Synchronizer::reserveSpace(const Build &build, const QString &rootPath)
+{
+    QStorageInfo storage(rootPath);
+    if (!storage.isValid())
+        return true;
+
+    // the reservations of running downloads count in full, even for the part already on disk
+    qint64 reserved = 0;
+    for (const auto &reservation : m_reservations)
+    {
+        if (reservation.first == storage.rootPath())
+            reserved += reservation.second;
     }
+    const bool archive = build.artifactName().endsWith(QStringLiteral(".zip"), Qt::CaseInsensitive);
+    const qint64 required = build.artifactSize() * (archive ? ExtractionMultiplier : 1);
+    if (storage.bytesAvailable() - reserved < required)
+        return false;
 
-    checkSynchronized();
+    m_reservations.insert(build, qMakePair(storage.rootPath(), required));
+    return true;
+}
+
+bool Synchronizer::makeRoom(const Build &build)
+{
+    auto db = ServiceLocator::database();
+    auto buildTarget = BuildTargetDao(db).buildTarget(build.buildTargetId());
+    if (!buildTarget.sync())
+        return false;
+
+    // downloaded builds are sorted by target then number, so the builds of the target are oldest first
+    QVector<Build> downloaded;
+    QVector<Build> automatic;
+    auto first = std::lower_bound(std::begin(m_downloadedBuilds), std::end(m_downloadedBuilds),
+                                  BuildRef(build.buildTargetId(), std::numeric_limits<int>::min()));
+    for (auto it = first; it != std::end(m_downloadedBuilds) && it->buildTargetId() == build.buildTargetId(); ++it)
+    {
+        Build downloadedBuild = *it;
+        downloaded.append(downloadedBuild);
+        if (!downloadedBuild.manualDownload())
+            automatic.append(downloadedBuild);
+    }
+
+    // the oldest automatic build is removed by the next refresh once this one is in, so it can go now
+    if (automatic.isEmpty()
+            || automatic.size() < buildTarget.maxBuilds()
+            || downloaded.size() - 1 < buildTarget.minBuilds()
+            || automatic.first().id() >= build.id())
+        return false;
+
+    auto project = ProjectDao(db).project(buildTarget.projectId());
+    auto profile = ProfileDao(db).profile(project.profileId());
+    QDir targetDir(QStringLiteral("%1/%2/%3").arg(profile.rootPath(), project.cloudId(), buildTarget.cloudId()));
+    qInfo() << "Removing build" << BuildRef(automatic.first()) << "early to make room for" << BuildRef(build);
+    removeBuild(profile, targetDir, automatic.first());
+    return true;
+}
+
+void Synchronizer::removeBuild(const Profile &profile, const QDir &targetDir, const Build &build)
+{
+    DownloadsDao(ServiceLocator::database()).removeDownload(build);
+    m_downloadedBuilds.removeOne(build);
+    QDir buildDir(targetDir);
+    if (buildDir.cd(QString::number(build.id())))
+    {
+        auto removeTask = [](QDir dir, BuildRef buildRef, ContentStore store)
+        {
+            if (dir.removeRecursively())
+            {
+                auto db = ServiceLocator::databaseProvider()->threadDatabase();
+                if (db.isOpen())
+                    DownloadsDao(db).removeDownload(buildRef);
+                // the files of the build may still be in the store
+                if (store.isEnabled())
+                    store.collectGarbage();
+            }
+        };
+        QtConcurrent::run(removeTask, buildDir, BuildRef(build),
+                          profile.deduplicate() ? ContentStore(profile.rootPath()) : ContentStore());
+    }
+}
+
+bool Synchronizer::isRetryPending(const BuildRef &buildRef) const
+{
+    auto retryIt = m_retries.find(buildRef);
+    return retryIt != m_retries.end() && retryIt.value().nextRetry.isValid();
+}
+
+void Synchronizer::scheduleRetry(const BuildRef &buildRef, DownloadWorker::Failure failure)
+{
+    auto &retry = m_retries[buildRef];
+    retry.buildRef = buildRef;
+    retry.attempts += 1;
+    retry.failure = static_cast<int>(failure);
+
+    // artifact links expire, a client error is only retried once a refresh had a chance to renew the link
+    const bool clientError = failure == DownloadWorker::Failure::Client;
+    if (retry.attempts >= (clientError ? MaxClientAttempts : MaxAttempts))
+    {
+        retry.nextRetry = QDateTime();
+        qWarning() << "Giving up on build" << buildRef << "after" << retry.attempts << "attempts";
+    }
+    else
+    {
+        const qint64 baseDelay = clientError ? UpdateInterval : RetryBaseDelay;
+        qint64 delay = std::min<qint64>(baseDelay << std::min(retry.attempts - 1, 16), MaxRetryDelay);
+        // jitter keeps builds that failed together from retrying together
+        delay = delay / 2 + QRandomGenerator::global()->bounded(static_cast<int>(delay / 2) + 1);
+        retry.nextRetry = QDateTime::currentDateTime().addMSecs(delay);
+        if (!m_nextRetry.isValid() || retry.nextRetry < m_nextRetry)
+            m_nextRetry = retry.nextRetry;
+        qInfo() << "Retrying build" << buildRef << "in" << delay / 1000 << "s, attempt" << retry.attempts + 1;
+    }
+
+    DownloadsDao(ServiceLocator::database()).setRetry(retry);
+}
+
+void Synchronizer::requeueRetries()
+{
+    const auto now = QDateTime::currentDateTime();
+    QVector<BuildRef> dueBuilds;
+    m_nextRetry = QDateTime();
+    for (const auto &retry : m_retries)
+    {
+        if (!retry.nextRetry.isValid() || m_queue.contains(retry.buildRef) || isDownloading(retry.buildRef))
+            continue;
+        if (retry.nextRetry <= now)
+            dueBuilds.append(retry.buildRef);
+        else if (!m_nextRetry.isValid() || retry.nextRetry < m_nextRetry)
+            m_nextRetry = retry.nextRetry;
+    }
+
+    for (const auto &buildRef : dueBuilds)
+    {
+        queueDownload(buildRef);
+    }
 }
 
 void Synchronizer::syncTarget(const Profile &profile, const Project &project, const BuildTarget &buildTarget)
@@ -377,26 +960,7 @@ void Synchronizer::syncTarget(const Profile &profile, const Project &project, co
         if (--itemCount < buildTarget.minBuilds())
             break;
         // remove old build
-        downloadsDao.removeDownload(build);
-        m_downloadedBuilds.removeOne(build);
-        // TODO: delete in the background, better
-        QDir buildDir(targetDir);
-        if (buildDir.cd(QString::number(build.id())))
-        {
-            auto removeTask = [](QDir dir, BuildRef buildRef)
-            {
-                if (dir.removeRecursively())
-                {
-                    QUuid connectionId(QUuid::createUuid());
-                    auto db = ServiceLocator::databaseProvider()->sqlDatabase(connectionId.toString());
-                    db.open();
-                    DownloadsDao(db).removeDownload(buildRef);
-                    db.close();
-                    QSqlDatabase::removeDatabase(connectionId.toString());
-                }
-            };
-            QtConcurrent::run(removeTask, buildDir, BuildRef(build));
-        }
+        removeBuild(profile, targetDir, build);
     }
 }
 
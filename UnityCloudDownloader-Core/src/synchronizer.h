@@ -4,12 +4,21 @@
 #pragma once
 
 #include "abstractsynchronizer.h"
+#include "bandwidthlimiter.h"
+#include "downloadqueue.h"
+#include "downloadsdao.h"
+#include "downloadworker.h"
 
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QPair>
+#include <QDateTime>
+#include <QElapsedTimer>
 
 class QThread;
+class QDir;
 
 namespace ucd
 {
@@ -19,15 +28,10 @@ class Project;
 class BuildTarget;
 class Database;
 class BuildRef;
-class DownloadWorker;
 class UnityApiClient;
 
 class Synchronizer : public AbstractSynchronizer
 {
-    enum
-    {
-        WorkerCount = 4
-    };
     Q_OBJECT
 public:
     Synchronizer(QObject *parent = nullptr);
@@ -38,10 +42,17 @@ public:
     void refresh() override;
 
     bool isQueued(const Build &build) const override;
+    int queuePosition(const Build &build) const override;
     bool isDownloaded(const Build &build) const override;
     bool isDownloading(const Build &build) const override;
     float downloadProgress(const Build &build) const override;
     qint64 downloadSpeed(const Build &build) const override;
+    qint64 bandwidthLimit() const override;
+    void setBandwidthLimit(qint64 bytesPerSecond) override;
+    QString bandwidthSchedule() const override;
+    void setBandwidthSchedule(const QString &schedule) override;
+    QString downloadQueuePolicy() const override;
+    void setDownloadQueuePolicy(const QString &policy) override;
 
     void queueDownload(const Build &build);
     void startDownload(const Build &build);
@@ -50,20 +61,67 @@ protected:
     void timerEvent(QTimerEvent *event) override;
 
 private slots:
-    void onDownloadCompleted(ucd::Build build);
-    void onDownloadFailed(ucd::Build build);
+    void onDownloadCompleted(ucd::Build build, QByteArray digest);
+    void onDownloadFailed(ucd::Build build, ucd::DownloadWorker::Failure failure);
+    void onDownloadPaused(ucd::Build build);
+    void onFirstByteReceived(ucd::Build build);
     void onDownloadUpdated(ucd::Build build, float ratio, qint64 speed);
+    void onExtractionUpdated(ucd::Build build, float ratio);
     void onBuildsFetched(const QVector<Build> &builds, QUuid buildTargetId);
+    void onBuildsUnchanged(QUuid buildTargetId);
+    void onWorkerThreadDestroyed(QObject *thread);
 
 private:
     void syncTarget(const Profile &profile, const Project &project, const BuildTarget &buildTarget);
+    void loadBandwidthSettings();
+    bool considerBuild(const BuildTarget &buildTarget, const Build &build, const QDateTime &now);
+    void considerStoredBuilds(const BuildTarget &buildTarget);
+    void checkSynchronized();
+    void fetchBuilds(const BuildTarget &buildTarget);
+    void loadQueueSettings();
+    DownloadQueue::Priority queuePriority(const Build &build) const;
+    bool isRetryPending(const BuildRef &buildRef) const;
+    void scheduleRetry(const BuildRef &buildRef, DownloadWorker::Failure failure);
+    void requeueRetries();
+
+    int preemptionCandidate(const QUuid &profileId) const;
+    void releaseBuild(const BuildRef &buildRef);
+    bool reserveSpace(const Build &build, const QString &rootPath);
+    bool makeRoom(const Build &build);
+    void removeBuild(const Profile &profile, const QDir &targetDir, const Build &build);
+
+    DownloadWorker* idleWorker();
+    void addWorker();
+    void removeWorker(int index);
+    void trimWorkers();
+    QUuid profileId(const QUuid &buildTargetId);
+    void tuneConcurrency();
 
     QVector<BuildRef> m_processingBuilds;
-    QVector<BuildRef> m_queuedBuilds;
+    QMap<BuildRef, DownloadWorker*> m_buildWorkers;
+    QMap<BuildRef, DownloadQueue::Priority> m_processingPriorities;
+    QVector<BuildRef> m_pausingBuilds; // automatic downloads making room for manual ones
+    QMap<BuildRef, QElapsedTimer> m_manualRequests; // time to first byte of manual downloads
+    QMap<BuildRef, QPair<QString, qint64>> m_reservations; // volume and bytes held by each download
+    QElapsedTimer m_spaceTimer; // running while builds wait for disk space
+    DownloadQueue m_queue;
+    QMap<BuildRef, DownloadsDao::Retry> m_retries;
+    QDateTime m_nextRetry; // earliest pending retry, invalid if none
     QVector<BuildRef> m_downloadedBuilds;
-    QThread *m_workerThread;
-    DownloadWorker *m_workers[WorkerCount];
+    BandwidthLimiter m_bandwidthLimiter;
+    QVector<QThread*> m_workerThreads;
+    QVector<QThread*> m_retiringThreads; // removed workers whose event loop is still exiting
+    QVector<DownloadWorker*> m_workers;
     QMap<BuildRef, QPair<float, qint64>> m_downloadStats;
+    QHash<QUuid, QUuid> m_targetProfiles;
+    QHash<QUuid, QElapsedTimer> m_fullFetches; // since the last complete build list of each target
+    QSet<QUuid> m_partialFetches; // targets waiting for the builds above their high-water mark
+    int m_autoConcurrency;
+    bool m_concurrencyRaised;
+    bool m_concurrencySettled;
+    qint64 m_lastThroughput;
+    qint64 m_throughputSum;
+    int m_throughputSamples;
     UnityApiClient *m_apiClient;
     int m_updateTimer;
     int m_progressTick;
@@ -7,10 +7,15 @@
 #include "buildtarget.h"
 #include "build.h"
 #include "servicelocator.h"
+#include "networksession.h"
+#include "responsecachedao.h"
+#include "buildlistparser.h"
 
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QUrlQuery>
+#include <QCryptographicHash>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonValue>
@@ -20,24 +25,40 @@
 namespace ucd
 {
 
+enum
+{
+    BuildsPageSize = 25,
+    MaxBuildsPages = 40,
+};
+
 static void setAuthorization(QNetworkRequest &request, const QString &apiKey)
 {
     request.setRawHeader("Authorization", QStringLiteral("Basic %1").arg(apiKey).toUtf8());
+    NetworkSession::prepareApiRequest(request);
 }
 
 UnityApiClient::UnityApiClient(QObject *parent)
     : QObject(parent)
-    , m_networkManager(nullptr)
-{
-    m_networkManager = new QNetworkAccessManager(this);
-}
+    , m_networkManager(NetworkSession::manager())
+    , m_conditionalRequests(false)
+{}
 
 UnityApiClient::UnityApiClient(QString apiKey, QObject *parent)
     : QObject(parent)
     , m_apiKey(std::move(apiKey))
-    , m_networkManager(nullptr)
+    , m_networkManager(NetworkSession::manager())
+    , m_conditionalRequests(false)
+{}
+
+static QByteArray cacheKey(const QUrl &url, const QString &apiKey)
 {
-    m_networkManager = new QNetworkAccessManager(this);
+    // the key doesn't keep the api key in clear
+    return QCryptographicHash::hash(url.toEncoded() + '\n' + apiKey.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+void UnityApiClient::setConditionalRequests(bool enabled)
+{
+    m_conditionalRequests = enabled;
 }
 
 void UnityApiClient::setApiKey(const QString &apiKey)
@@ -104,28 +125,69 @@ void UnityApiClient::fetchBuilds(const QString &orgId, const QString &projectId,
     setAuthorization(request, m_apiKey);
 
     auto *reply = m_networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, &UnityApiClient::buildsReceived);
+    watchBuilds(reply, QUuid());
 }
 
 void UnityApiClient::fetchBuilds(const BuildTarget &buildTarget)
+{
+    requestBuilds(buildTarget, 0, 0);
+}
+
+void UnityApiClient::fetchBuilds(const BuildTarget &buildTarget, int sinceBuildNumber)
+{
+    m_pagedBuilds.remove(buildTarget.id());
+    requestBuilds(buildTarget, sinceBuildNumber, 1);
+}
+
+QNetworkReply* UnityApiClient::requestBuilds(const BuildTarget &buildTarget, int sinceBuildNumber, int page)
 {
     auto project = ProjectDao(ServiceLocator::database()).project(buildTarget.projectId());
     auto apiKey = ProfileDao(ServiceLocator::database()).getApiKey(project.profileId());
     auto orgId = project.organisationId();
     auto projectId = project.cloudId();
     auto buildTargetId = buildTarget.cloudId();
-    QNetworkRequest request(QUrl{API("/orgs/%1/projects/%2/buildtargets/%3/builds").arg(orgId, projectId, buildTargetId)});
+    QUrl url(API("/orgs/%1/projects/%2/buildtargets/%3/builds").arg(orgId, projectId, buildTargetId));
+    if (page > 0)
+    {
+        QUrlQuery query;
+        query.addQueryItem(QStringLiteral("per_page"), QString::number(BuildsPageSize));
+        query.addQueryItem(QStringLiteral("page"), QString::number(page));
+        url.setQuery(query);
+    }
+    QNetworkRequest request(url);
     setAuthorization(request, apiKey);
 
+    // only the first page is revalidated, the later ones are fetched when it changed
+    QByteArray key;
+    if (m_conditionalRequests && page <= 1)
+    {
+        key = cacheKey(request.url(), apiKey);
+        auto validators = ResponseCacheDao(ServiceLocator::database()).validators(key);
+        if (!validators.etag.isEmpty())
+            request.setRawHeader("If-None-Match", validators.etag);
+        if (!validators.lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", validators.lastModified);
+    }
+
     auto *reply = m_networkManager->get(request);
     reply->setProperty("buildTarget", QVariant::fromValue(buildTarget));
+    reply->setProperty("cacheKey", key);
+    reply->setProperty("page", page);
+    reply->setProperty("sinceBuildNumber", sinceBuildNumber);
+    watchBuilds(reply, buildTarget.id());
+    return reply;
+}
+
+void UnityApiClient::watchBuilds(QNetworkReply *reply, const QUuid &buildTargetId)
+{
+    m_buildParsers.insert(reply, std::make_shared<BuildListParser>(buildTargetId));
+    connect(reply, &QNetworkReply::readyRead, this, &UnityApiClient::buildsDataReceived);
     connect(reply, &QNetworkReply::finished, this, &UnityApiClient::buildsReceived);
 }
 
 void UnityApiClient::preconnect()
 {
-    QNetworkAccessManager manager;
-    manager.connectToHostEncrypted(API(""));
+    NetworkSession::preconnect(QUrl{API("")});
 }
 
 void UnityApiClient::keyTestFinished()
@@ -203,10 +265,23 @@ void UnityApiClient::buildTargetsReceived()
     emit buildTargetsFetched(buildTargets);
 }
 
+void UnityApiClient::buildsDataReceived()
+{
+    auto *reply = qobject_cast<QNetworkReply*>(sender());
+    // the list is parsed as it arrives, other responses are left for buildsReceived
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return;
+
+    auto parser = m_buildParsers.value(reply);
+    if (parser)
+        parser->feed(reply->readAll());
+}
+
 void UnityApiClient::buildsReceived()
 {
     auto *reply = qobject_cast<QNetworkReply*>(sender());
     reply->deleteLater();
+    auto parser = m_buildParsers.take(reply);
     QVector<Build> builds;
 
     auto buildTargetProperty = reply->property("buildTarget");
@@ -214,47 +289,67 @@ void UnityApiClient::buildsReceived()
     if (buildTargetProperty.isValid())
         buildTargetId = buildTargetProperty.value<BuildTarget>().id();
 
-    if (reply->error() == 0)
+    const QByteArray key = reply->property("cacheKey").toByteArray();
+    if (!key.isEmpty() && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
     {
-        auto replyData = reply->readAll();
-        auto jsonDocument = QJsonDocument::fromJson(replyData);
-        auto jsonData = jsonDocument.array();
-        for (QJsonValue value : jsonData)
+        // the list stored from the previous response is still current, there is nothing to parse
+        emit buildsUnchanged(buildTargetId);
+        return;
+    }
+
+    bool received = false;
+    if (reply->error() == 0 && parser)
+    {
+        parser->feed(reply->readAll());
+        if (!parser->finish())
         {
-            Build build;
-            build.setId(value["build"].toInt());
-            build.setBuildTargetId(buildTargetId);
-            build.setName(value["buildTargetName"].toString());
-            build.setStatus(Build::statusFromString(value["buildStatus"].toString()));
-            build.setCreateTime(value["created"].toVariant().toDateTime());
-            auto links = value["links"];
-            if (links.isObject())
-            {
-                auto icon = links["icon"];
-                if (icon.isObject())
-                {
-                    build.setIconPath(icon["href"].toString());
-                }
-                auto artifacts = links["artifacts"].toArray();
-                for (QJsonValue artifact : artifacts)
-                {
-                    if (artifact["key"].toString() != QStringLiteral("primary"))
-                        continue;
-                    auto files = artifact["files"].toArray();
-                    if (!files.isEmpty())
-                    {
-                        QJsonValue file = files[0];
-                        build.setArtifactName(file["filename"].toString());
-                        build.setArtifactSize(file["size"].toVariant().toLongLong());
-                        build.setArtifactPath(file["href"].toString());
-                        break;
-                    }
-                    break;
-                }
-            }
-
-            builds.append(std::move(build));
+            qWarning("invalid build list received from %s", reply->url().toString().toUtf8().data());
         }
+        else
+        {
+            builds = parser->takeBuilds();
+            received = true;
+        }
+    }
+
+    // the validators of the first page are carried along the next ones
+    const int page = reply->property("page").toInt();
+    QByteArray validatorsKey = key;
+    ResponseCacheDao::Validators validators;
+    validators.etag = reply->rawHeader("ETag");
+    validators.lastModified = reply->rawHeader("Last-Modified");
+    if (page > 1)
+    {
+        validatorsKey = reply->property("validatorsKey").toByteArray();
+        validators.etag = reply->property("etag").toByteArray();
+        validators.lastModified = reply->property("lastModified").toByteArray();
+    }
+
+    if (page > 0)
+    {
+        auto &pagedBuilds = m_pagedBuilds[buildTargetId];
+        pagedBuilds += builds;
+        // a full page still above the high-water mark may be followed by more new builds
+        const int sinceBuildNumber = reply->property("sinceBuildNumber").toInt();
+        if (received && builds.size() >= BuildsPageSize && page < MaxBuildsPages
+                && builds.last().id() > sinceBuildNumber)
+        {
+            auto *nextReply = requestBuilds(buildTargetProperty.value<BuildTarget>(), sinceBuildNumber, page + 1);
+            nextReply->setProperty("validatorsKey", validatorsKey);
+            nextReply->setProperty("etag", validators.etag);
+            nextReply->setProperty("lastModified", validators.lastModified);
+            return;
+        }
+        builds = m_pagedBuilds.take(buildTargetId);
+    }
+
+    // a 304 on the first page stands for the whole list, so it is only validated once every page arrived
+    if (received && !validatorsKey.isEmpty())
+    {
+        if (validators.isEmpty())
+            ResponseCacheDao(ServiceLocator::database()).removeValidators(validatorsKey);
+        else
+            ResponseCacheDao(ServiceLocator::database()).setValidators(validatorsKey, validators);
     }
 
     emit buildsFetched(builds, buildTargetId);
@@ -10,7 +10,6 @@
 #include "synchronizer.h"
 
 #include <QObject>
-#include <QtConcurrent>
 
 namespace ucd
 {
@@ -27,7 +26,8 @@ void Core::init()
     qRegisterMetaTypeStreamOperators<Build>("ucd_Build");
     qRegisterMetaType<BuildRef>("ucd_BuildRef");
     qRegisterMetaTypeStreamOperators<BuildRef>("ucd_BuildRef");
-    QtConcurrent::run(&UnityApiClient::preconnect);
+    // the connection is opened asynchronously, the first API call of the main thread reuses it
+    UnityApiClient::preconnect();
 }
 
 void Core::init(const QString &storagePath, QObject *parent)
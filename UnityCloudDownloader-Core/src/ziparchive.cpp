@@ -0,0 +1,280 @@
+#include "ziparchive.h"
+
+#include "zipformat.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+
+#include <zlib.h>
+
+namespace ucd
+{
+
+using namespace zip;
+
+enum
+{
+    InputSize = 1024 * 1024,
+    OutputSize = 256 * 1024,
+};
+
+ZipArchive::ZipArchive(QString filePath)
+    : m_filePath(std::move(filePath))
+{}
+
+bool ZipArchive::open()
+{
+    m_entries.clear();
+    m_error.clear();
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(QStringLiteral("Cannot open %1").arg(m_filePath));
+
+    const qint64 fileSize = file.size();
+    const qint64 tailLength = std::min(fileSize, tailSize());
+    Directory directory;
+    if (!file.seek(fileSize - tailLength) || !readDirectory(file.read(tailLength), &directory))
+        return fail(QStringLiteral("%1 is not a ZIP archive").arg(m_filePath));
+
+    if (directory.offset + directory.size > static_cast<quint64>(fileSize) || !file.seek(static_cast<qint64>(directory.offset)))
+        return fail(QStringLiteral("Invalid central directory in %1").arg(m_filePath));
+    const QByteArray records = file.read(static_cast<qint64>(directory.size));
+    if (static_cast<quint64>(records.size()) != directory.size)
+        return fail(QStringLiteral("Truncated central directory in %1").arg(m_filePath));
+
+    QString error = readEntries(records, directory.entryCount, &m_entries);
+    if (!error.isEmpty())
+        return fail(QStringLiteral("%1 in %2").arg(error, m_filePath));
+    return true;
+}
+
+QString ZipArchive::extract(const Entry &entry, const QString &destinationPath, const ContentStore &store) const
+{
+    QFile archive(m_filePath);
+    if (!archive.open(QIODevice::ReadOnly) || !archive.seek(static_cast<qint64>(entry.localHeaderOffset)))
+        return QStringLiteral("Cannot read %1").arg(entry.name);
+
+    // the local extra field may differ from the central one, only its length matters here
+    QByteArray header = archive.read(LocalHeaderSize);
+    if (header.size() != LocalHeaderSize || readUInt32(header.constData()) != LocalHeaderSignature)
+        return QStringLiteral("Invalid local header for %1").arg(entry.name);
+    qint64 dataOffset = static_cast<qint64>(entry.localHeaderOffset) + LocalHeaderSize
+            + readUInt16(header.constData() + 26) + readUInt16(header.constData() + 28);
+    if (!archive.seek(dataOffset))
+        return QStringLiteral("Cannot read %1").arg(entry.name);
+
+    // a previous extraction may have linked the file to the store, it is replaced rather than rewritten
+    QFile out(QDir(destinationPath).filePath(entry.path));
+    out.remove();
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QStringLiteral("Cannot create file %1").arg(out.fileName());
+
+    QByteArray input(InputSize, Qt::Uninitialized);
+    QByteArray output(OutputSize, Qt::Uninitialized);
+    quint64 remaining = entry.compressedSize;
+    quint64 written = 0;
+    quint32 crc = crc32(0, Z_NULL, 0);
+    QCryptographicHash hash(ContentStore::algorithm());
+
+    auto writeOutput = [&](const char *data, qint64 size) -> bool
+    {
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+        if (store.isEnabled())
+            hash.addData(data, static_cast<int>(size));
+        written += static_cast<quint64>(size);
+        return out.write(data, size) == size;
+    };
+
+    if (entry.method == StoredMethod)
+    {
+        while (remaining > 0)
+        {
+            qint64 count = archive.read(input.data(), static_cast<qint64>(std::min<quint64>(remaining, InputSize)));
+            if (count <= 0)
+                return QStringLiteral("Truncated entry %1").arg(entry.name);
+            remaining -= static_cast<quint64>(count);
+            if (!writeOutput(input.constData(), count))
+                return QStringLiteral("Cannot write %1").arg(out.fileName());
+        }
+    }
+    else
+    {
+        z_stream stream{};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            return QStringLiteral("Cannot initialize inflate for %1").arg(entry.name);
+
+        QString error;
+        int result = Z_OK;
+        bool outputPending = false; // the output buffer filled up, inflate may hold more
+        while (result != Z_STREAM_END && error.isEmpty())
+        {
+            // more input is only read once inflate has flushed what it has
+            if (stream.avail_in == 0 && !outputPending && remaining > 0)
+            {
+                qint64 count = archive.read(input.data(), static_cast<qint64>(std::min<quint64>(remaining, InputSize)));
+                if (count <= 0)
+                {
+                    error = QStringLiteral("Truncated entry %1").arg(entry.name);
+                    break;
+                }
+                remaining -= static_cast<quint64>(count);
+                stream.next_in = reinterpret_cast<Bytef*>(input.data());
+                stream.avail_in = static_cast<uInt>(count);
+            }
+
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            result = inflate(&stream, Z_NO_FLUSH);
+            outputPending = stream.avail_out == 0;
+            if (result == Z_BUF_ERROR && stream.avail_in == 0 && remaining == 0 && !outputPending)
+                error = QStringLiteral("Truncated entry %1").arg(entry.name);
+            else if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+                error = QStringLiteral("Cannot inflate %1").arg(entry.name);
+            else if (!writeOutput(output.constData(), output.size() - stream.avail_out))
+                error = QStringLiteral("Cannot write %1").arg(out.fileName());
+        }
+        inflateEnd(&stream);
+        if (!error.isEmpty())
+            return error;
+    }
+
+    if (crc != entry.crc || written != entry.uncompressedSize)
+        return QStringLiteral("Entry %1 is corrupted").arg(entry.name);
+
+    out.close();
+    if (isSymLink(entry.unixMode))
+        return QString();
+    // the mode is part of the blob key, so it is applied before the file is shared
+    QString error = entry.unixMode != 0 ? applyUnixMode(destinationPath, entry.path, entry.unixMode) : QString();
+    if (error.isEmpty())
+        store.add(out.fileName(), hash.result());
+    return error;
+}
+
+QString ZipArchive::linkEntry(const Entry &entry, const QString &destinationPath)
+{
+    return isSymLink(entry.unixMode) ? applyUnixMode(destinationPath, entry.path, entry.unixMode) : QString();
+}
+
+qint64 ZipArchive::tailSize()
+{
+    // the end of central directory record is followed by a comment of up to 64 KB,
+    // and preceded by the ZIP64 record and its locator
+    return EndOfCentralSize + MaxCommentSize + Zip64LocatorSize + Zip64EndOfCentralSize;
+}
+
+bool ZipArchive::readDirectory(const QByteArray &tail, Directory *directory)
+{
+    int eocd = -1;
+    for (int i = tail.size() - EndOfCentralSize; i >= 0; --i)
+    {
+        if (readUInt32(tail.constData() + i) == EndOfCentralSignature)
+        {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0)
+        return false;
+
+    const char *record = tail.constData() + eocd;
+    directory->entryCount = readUInt16(record + 10);
+    directory->size = readUInt32(record + 12);
+    directory->offset = readUInt32(record + 16);
+
+    // ZIP64 archives have their record and its locator right before, with the actual values
+    if (eocd >= Zip64LocatorSize && readUInt32(record - Zip64LocatorSize) == Zip64LocatorSignature)
+    {
+        const int zip64Record = eocd - Zip64LocatorSize - Zip64EndOfCentralSize;
+        if (zip64Record < 0 || readUInt32(tail.constData() + zip64Record) != Zip64EndOfCentralSignature)
+            return false;
+        const char *zip64 = tail.constData() + zip64Record;
+        directory->entryCount = readUInt64(zip64 + 32);
+        directory->size = readUInt64(zip64 + 40);
+        directory->offset = readUInt64(zip64 + 48);
+    }
+    return true;
+}
+
+QString ZipArchive::readEntries(const QByteArray &directory, quint64 entryCount, QVector<Entry> *entries)
+{
+    entries->clear();
+    entries->reserve(static_cast<int>(std::min<quint64>(entryCount, static_cast<quint64>(directory.size() / CentralHeaderSize))));
+    const char *data = directory.constData();
+    const char *end = data + directory.size();
+    while (end - data >= CentralHeaderSize && readUInt32(data) == CentralHeaderSignature)
+    {
+        Entry entry;
+        entry.flags = readUInt16(data + 8);
+        entry.method = readUInt16(data + 10);
+        entry.crc = readUInt32(data + 16);
+        entry.compressedSize = readUInt32(data + 20);
+        entry.uncompressedSize = readUInt32(data + 24);
+        quint16 nameLength = readUInt16(data + 28);
+        quint16 extraLength = readUInt16(data + 30);
+        quint16 commentLength = readUInt16(data + 32);
+        entry.localHeaderOffset = readUInt32(data + 42);
+        entry.unixMode = unixMode(data);
+
+        const char *name = data + CentralHeaderSize;
+        const char *extra = name + nameLength;
+        const char *next = extra + extraLength + commentLength;
+        if (next > end)
+            return QStringLiteral("Truncated central directory");
+
+        // the ZIP64 extra field only holds the values that overflowed, in this order
+        for (const char *extraEnd = extra + extraLength; extraEnd - extra >= 4;)
+        {
+            quint16 id = readUInt16(extra);
+            quint16 length = readUInt16(extra + 2);
+            const char *field = extra + 4;
+            const char *fieldEnd = field + length;
+            extra = fieldEnd;
+            if (id != Zip64ExtraId || fieldEnd > extraEnd)
+                continue;
+
+            if (entry.uncompressedSize == Zip64Marker && fieldEnd - field >= 8)
+            {
+                entry.uncompressedSize = readUInt64(field);
+                field += 8;
+            }
+            if (entry.compressedSize == Zip64Marker && fieldEnd - field >= 8)
+            {
+                entry.compressedSize = readUInt64(field);
+                field += 8;
+            }
+            if (entry.localHeaderOffset == Zip64Marker && fieldEnd - field >= 8)
+            {
+                entry.localHeaderOffset = readUInt64(field);
+            }
+        }
+
+        entry.name = entryName(name, nameLength, entry.flags);
+        entry.path = entryPath(entry.name);
+        if (entry.path.isEmpty())
+            return QStringLiteral("Unsafe entry path %1").arg(entry.name);
+        if (entry.flags & EncryptedFlag)
+            return QStringLiteral("Encrypted entry %1 is not supported").arg(entry.name);
+        if (entry.method != StoredMethod && entry.method != DeflatedMethod)
+            return QStringLiteral("Compression method %1 of %2 is not supported").arg(entry.method).arg(entry.name);
+
+        entries->append(entry);
+        data = next;
+    }
+
+    if (static_cast<quint64>(entries->size()) != entryCount)
+        return QStringLiteral("Invalid central directory");
+    return QString();
+}
+
+bool ZipArchive::fail(const QString &error)
+{
+    m_error = error;
+    m_entries.clear();
+    return false;
+}
+
+}
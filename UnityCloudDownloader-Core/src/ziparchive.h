@@ -0,0 +1,100 @@
+#ifndef UCD_ZIPARCHIVE_H
+#define UCD_ZIPARCHIVE_H
+
+#pragma once
+
+#include "contentstore.h"
+
+#include <QString>
+#include <QVector>
+
+class QFile;
+
+namespace ucd
+{
+
+/**
+ * @brief Random access to a ZIP archive on disk through its central directory.
+ *
+ * Once opened, entries can be extracted independently from any thread.
+ */
+class ZipArchive
+{
+public:
+    struct Entry
+    {
+        QString name;
+        QString path; // relative to the destination, safe to write
+        quint64 localHeaderOffset;
+        quint64 compressedSize;
+        quint64 uncompressedSize;
+        quint32 crc;
+        quint16 method;
+        quint16 flags;
+        quint32 unixMode; // 0 if the entry wasn't made on unix
+
+        bool isDirectory() const { return name.endsWith(QLatin1Char('/')); }
+    };
+
+    /**
+     * @brief Location of the central directory.
+     */
+    struct Directory
+    {
+        quint64 offset;
+        quint64 size;
+        quint64 entryCount;
+    };
+
+    /**
+     * @brief Number of bytes at the end of an archive that hold the directory location.
+     */
+    static qint64 tailSize();
+    /**
+     * @brief Find the central directory from the last bytes of an archive.
+     * @return false if the tail has no valid end of central directory record.
+     */
+    static bool readDirectory(const QByteArray &tail, Directory *directory);
+    /**
+     * @brief Parse the central directory records.
+     * @return an error message, empty on success.
+     */
+    static QString readEntries(const QByteArray &directory, quint64 entryCount, QVector<Entry> *entries);
+
+    explicit ZipArchive(QString filePath);
+
+    /**
+     * @brief Read the central directory.
+     * @return false if the archive is invalid or not supported.
+     */
+    bool open();
+
+    const QString& filePath() const { return m_filePath; }
+    const QVector<Entry>& entries() const { return m_entries; }
+    const QString& errorString() const { return m_error; }
+
+    /**
+     * @brief Extract an entry in the destination folder, the parent folders must exist.
+     *
+     * The unix mode of a file is applied, a symbolic link is left as a file
+     * holding its target until linkEntry() is called.
+     * @return an error message, empty on success.
+     */
+    QString extract(const Entry &entry, const QString &destinationPath, const ContentStore &store = ContentStore()) const;
+    /**
+     * @brief Replace an extracted symbolic link entry by the link, once every entry is written.
+     * @return an error message, empty on success.
+     */
+    static QString linkEntry(const Entry &entry, const QString &destinationPath);
+
+private:
+    bool fail(const QString &error);
+
+    QString m_filePath;
+    QVector<Entry> m_entries;
+    QString m_error;
+};
+
+}
+
+#endif // UCD_ZIPARCHIVE_H
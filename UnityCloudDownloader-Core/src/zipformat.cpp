@@ -0,0 +1,105 @@
+#include "zipformat.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+namespace ucd
+{
+
+namespace zip
+{
+
+#ifndef Q_OS_WIN
+/**
+ * @brief Check that a link target only climbs up before going down.
+ *
+ * Climbing after a folder of the target could go through another link, and
+ * end up outside of the destination even though the path looks inside.
+ */
+static bool isSafeLinkTarget(const QString &destinationPath, const QString &path, const QString &target)
+{
+    if (target.isEmpty() || QDir::isAbsolutePath(target))
+        return false;
+
+    bool descending = false;
+    for (const auto &part : target.split(QLatin1Char('/')))
+    {
+        if (part == QStringLiteral(".."))
+        {
+            if (descending)
+                return false;
+        }
+        else if (!part.isEmpty() && part != QStringLiteral("."))
+        {
+            descending = true;
+        }
+    }
+
+    // the link folder must be a real one, so climbing from it stays where it looks
+    const QString folder = QFileInfo(path).path();
+    const QString root = QDir(destinationPath).canonicalPath();
+    const QString expected = folder == QStringLiteral(".") ? root : root + QLatin1Char('/') + folder;
+    return !entryPath(folder + QLatin1Char('/') + target).isEmpty()
+            && QFileInfo(QDir(destinationPath).filePath(folder)).canonicalFilePath() == expected;
+}
+#endif
+
+QString applyUnixMode(const QString &destinationPath, const QString &path, quint32 mode, const ContentStore &store)
+{
+#ifdef Q_OS_WIN
+    // links need privileges and modes don't map, entries stay regular files
+    Q_UNUSED(destinationPath)
+    Q_UNUSED(path)
+    Q_UNUSED(mode)
+    Q_UNUSED(store)
+    return QString();
+#else
+    const QString filePath = QDir(destinationPath).filePath(path);
+    if (isSymLink(mode))
+    {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly))
+            return QStringLiteral("Cannot read link %1").arg(path);
+        const QString target = QFile::decodeName(file.readAll());
+        file.close();
+
+        // the link must resolve inside the destination, like any entry
+        if (!isSafeLinkTarget(destinationPath, path, target))
+            return QStringLiteral("Unsafe link %1 to %2").arg(path, target);
+        if (!file.remove() || !QFile::link(target, filePath))
+            return QStringLiteral("Cannot create link %1").arg(filePath);
+        return QString();
+    }
+
+    if ((mode & UnixTypeMask) != UnixRegularFile)
+        return QString();
+
+    static const struct
+    {
+        quint32 bit;
+        QFileDevice::Permissions permissions;
+    } bits[] = {
+        {0100, QFileDevice::ExeOwner | QFileDevice::ExeUser},
+        {0040, QFileDevice::ReadGroup},
+        {0020, QFileDevice::WriteGroup},
+        {0010, QFileDevice::ExeGroup},
+        {0004, QFileDevice::ReadOther},
+        {0002, QFileDevice::WriteOther},
+        {0001, QFileDevice::ExeOther},
+    };
+    QFileDevice::Permissions permissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner
+            | QFileDevice::ReadUser | QFileDevice::WriteUser;
+    for (const auto &bit : bits)
+    {
+        if (mode & bit.bit)
+            permissions |= bit.permissions;
+    }
+    if (!store.setPermissions(filePath, permissions))
+        return QStringLiteral("Cannot set the permissions of %1").arg(filePath);
+    return QString();
+#endif
+}
+
+}
+
+}
@@ -0,0 +1,126 @@
+#ifndef UCD_ZIPFORMAT_H
+#define UCD_ZIPFORMAT_H
+
+#pragma once
+
+#include "contentstore.h"
+
+#include <QDir>
+#include <QString>
+#include <QtEndian>
+
+namespace ucd
+{
+
+/**
+ * @brief Record layouts of the ZIP format shared by the extractors.
+ */
+namespace zip
+{
+
+enum : quint32
+{
+    LocalHeaderSignature = 0x04034b50,
+    DescriptorSignature = 0x08074b50,
+    CentralHeaderSignature = 0x02014b50,
+    EndOfCentralSignature = 0x06054b50,
+    Zip64EndOfCentralSignature = 0x06064b50,
+    Zip64LocatorSignature = 0x07064b50,
+    LocalHeaderSize = 30,
+    CentralHeaderSize = 46,
+    EndOfCentralSize = 22,
+    Zip64EndOfCentralSize = 56,
+    Zip64LocatorSize = 20,
+    MaxCommentSize = 0xffff,
+    Zip64ExtraId = 0x0001,
+};
+
+enum : quint16
+{
+    EncryptedFlag = 1 << 0,
+    DescriptorFlag = 1 << 3,
+    Utf8Flag = 1 << 11,
+    StoredMethod = 0,
+    DeflatedMethod = 8,
+};
+
+enum : quint32
+{
+    UnixHost = 3,
+    UnixTypeMask = 0170000,
+    UnixRegularFile = 0100000,
+    UnixSymLink = 0120000,
+};
+
+static const quint32 Zip64Marker = 0xffffffff;
+
+inline quint16 readUInt16(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+}
+
+inline quint32 readUInt32(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+inline quint64 readUInt64(const char *data)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(data));
+}
+
+inline QString entryName(const char *data, int length, quint16 flags)
+{
+    return (flags & Utf8Flag) ? QString::fromUtf8(data, length) : QString::fromLatin1(data, length);
+}
+
+/**
+ * @brief Unix mode of a central directory record, 0 if the entry wasn't made on unix.
+ */
+inline quint32 unixMode(const char *centralHeader)
+{
+    return (readUInt16(centralHeader + 4) >> 8) == UnixHost ? readUInt32(centralHeader + 38) >> 16 : 0;
+}
+
+inline bool isSymLink(quint32 mode)
+{
+    return (mode & UnixTypeMask) == UnixSymLink;
+}
+
+/**
+ * @brief Normalize an entry name into a path relative to the destination.
+ * @return an empty string if the entry would be written outside of the destination.
+ */
+inline QString entryPath(const QString &name)
+{
+    QString path = QDir::cleanPath(QString(name).replace(QLatin1Char('\\'), QLatin1Char('/')));
+    if (path.isEmpty()
+            || path == QStringLiteral(".")
+            || QDir::isAbsolutePath(path)
+            || path == QStringLiteral("..")
+            || path.startsWith(QStringLiteral("../"))
+            || path.contains(QLatin1Char(':')))
+    {
+        return QString();
+    }
+    return path;
+}
+
+/**
+ * @brief Apply the unix mode of an extracted entry.
+ *
+ * The permissions of a regular file are set, the owner keeps read and write
+ * access so the build can be extracted again over it. A file linked to the
+ * store gets its own copy rather than changing the shared blob. A symbolic link is
+ * extracted as a file holding its target, which is then replaced by the link.
+ * Links are only created once every file is written, so no write goes
+ * through them.
+ * @return an error message, empty on success.
+ */
+QString applyUnixMode(const QString &destinationPath, const QString &path, quint32 mode, const ContentStore &store = ContentStore());
+
+}
+
+}
+
+#endif // UCD_ZIPFORMAT_H
@@ -0,0 +1,411 @@
+#include "zipstreamextractor.h"
+
+#include "zipformat.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace ucd
+{
+
+using namespace zip;
+
+enum
+{
+    OutputSize = 256 * 1024,
+    MaxInflateInput = 1 << 30,
+};
+
+ZipStreamExtractor::ZipStreamExtractor(QString destinationPath, ContentStore store)
+    : m_destinationPath(std::move(destinationPath))
+    , m_store(std::move(store))
+    , m_state(State::Header)
+    , m_output(OutputSize, Qt::Uninitialized)
+    , m_entryCount(0)
+    , m_flags(0)
+    , m_method(0)
+    , m_crc(0)
+    , m_compressedSize(0)
+    , m_uncompressedSize(0)
+    , m_zip64(false)
+    , m_compressedRead(0)
+    , m_written(0)
+    , m_runningCrc(0)
+    , m_entryHash(ContentStore::algorithm())
+    , m_stream{}
+    , m_inflating(false)
+{}
+
+ZipStreamExtractor::~ZipStreamExtractor()
+{
+    if (m_inflating)
+        inflateEnd(&m_stream);
+}
+
+bool ZipStreamExtractor::write(const char *data, qint64 size)
+{
+    while (size > 0 && m_state != State::Done && m_state != State::Error)
+    {
+        switch (m_state)
+        {
+        case State::Header:
+            readHeader(data, size);
+            break;
+        case State::Data:
+            readData(data, size);
+            break;
+        case State::Descriptor:
+            readDescriptor(data, size);
+            break;
+        case State::Directory:
+            readDirectory(data, size);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return m_state != State::Error;
+}
+
+bool ZipStreamExtractor::finish()
+{
+    if (m_state == State::Done)
+        return true;
+
+    if (m_state != State::Error)
+        fail(QStringLiteral("The archive ended before its central directory"));
+    return false;
+}
+
+bool ZipStreamExtractor::fill(const char *&data, qint64 &size, int length)
+{
+    int missing = length - m_pending.size();
+    if (missing > 0)
+    {
+        int count = static_cast<int>(std::min<qint64>(missing, size));
+        m_pending.append(data, count);
+        data += count;
+        size -= count;
+    }
+    return m_pending.size() >= length;
+}
+
+void ZipStreamExtractor::readHeader(const char *&data, qint64 &size)
+{
+    if (!fill(data, size, 4))
+        return;
+
+    quint32 signature = readUInt32(m_pending.constData());
+    if (signature != LocalHeaderSignature)
+    {
+        // the central directory follows the last entry, only its unix modes are left to apply
+        if (signature == CentralHeaderSignature)
+        {
+            m_state = State::Directory;
+            return;
+        }
+        if (signature == EndOfCentralSignature || signature == Zip64EndOfCentralSignature)
+        {
+            m_state = State::Done;
+            m_pending.clear();
+            return;
+        }
+
+        fail(QStringLiteral("Unexpected signature %1").arg(signature, 8, 16, QLatin1Char('0')));
+        return;
+    }
+
+    if (!fill(data, size, LocalHeaderSize))
+        return;
+
+    quint16 nameLength = readUInt16(m_pending.constData() + 26);
+    quint16 extraLength = readUInt16(m_pending.constData() + 28);
+    if (!fill(data, size, LocalHeaderSize + nameLength + extraLength))
+        return;
+
+    const char *header = m_pending.constData();
+    m_flags = readUInt16(header + 6);
+    m_method = readUInt16(header + 8);
+    m_crc = readUInt32(header + 14);
+    m_compressedSize = readUInt32(header + 18);
+    m_uncompressedSize = readUInt32(header + 22);
+    m_zip64 = false;
+
+    const char *name = header + LocalHeaderSize;
+    m_entryName = entryName(name, nameLength, m_flags);
+
+    // the ZIP64 extra field holds the sizes that don't fit in the header
+    const char *extra = name + nameLength;
+    const char *extraEnd = extra + extraLength;
+    while (extraEnd - extra >= 4)
+    {
+        quint16 id = readUInt16(extra);
+        quint16 length = readUInt16(extra + 2);
+        const char *field = extra + 4;
+        extra = field + length;
+        if (id != Zip64ExtraId || extra > extraEnd)
+            continue;
+
+        m_zip64 = true;
+        if (m_uncompressedSize == Zip64Marker && length >= 8)
+        {
+            m_uncompressedSize = readUInt64(field);
+            field += 8;
+            length -= 8;
+        }
+        if (m_compressedSize == Zip64Marker && length >= 8)
+        {
+            m_compressedSize = readUInt64(field);
+        }
+    }
+
+    m_pending.clear();
+    openEntry();
+}
+
+void ZipStreamExtractor::readData(const char *&data, qint64 &size)
+{
+    const bool hasDescriptor = (m_flags & DescriptorFlag) != 0;
+
+    if (m_method == StoredMethod)
+    {
+        qint64 count = static_cast<qint64>(std::min<quint64>(static_cast<quint64>(size), m_compressedSize - m_compressedRead));
+        if (!writeEntry(data, count))
+            return;
+        data += count;
+        size -= count;
+        m_compressedRead += static_cast<quint64>(count);
+        if (m_compressedRead == m_compressedSize)
+            closeEntry(m_crc, m_compressedSize, m_uncompressedSize);
+        return;
+    }
+
+    // without a descriptor the compressed size is known, don't feed inflate past the entry
+    qint64 limit = hasDescriptor ? size : static_cast<qint64>(std::min<quint64>(static_cast<quint64>(size), m_compressedSize - m_compressedRead));
+    limit = std::min<qint64>(limit, MaxInflateInput);
+
+    m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    m_stream.avail_in = static_cast<uInt>(limit);
+    bool ended = false;
+    do
+    {
+        m_stream.next_out = reinterpret_cast<Bytef*>(m_output.data());
+        m_stream.avail_out = static_cast<uInt>(m_output.size());
+        int result = inflate(&m_stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+        {
+            fail(QStringLiteral("Cannot inflate %1: %2").arg(m_entryName, QString::fromLatin1(m_stream.msg ? m_stream.msg : "unknown error")));
+            return;
+        }
+
+        if (!writeEntry(m_output.constData(), m_output.size() - m_stream.avail_out))
+            return;
+
+        if (result == Z_STREAM_END)
+        {
+            ended = true;
+            break;
+        }
+        if (result == Z_BUF_ERROR)
+            break; // needs more input
+    } while (m_stream.avail_out == 0);
+
+    qint64 consumed = limit - m_stream.avail_in;
+    data += consumed;
+    size -= consumed;
+    m_compressedRead += static_cast<quint64>(consumed);
+
+    if (ended)
+    {
+        inflateEnd(&m_stream);
+        m_inflating = false;
+        if (hasDescriptor)
+            m_state = State::Descriptor;
+        else
+            closeEntry(m_crc, m_compressedSize, m_uncompressedSize);
+    }
+    else if (!hasDescriptor && m_compressedRead == m_compressedSize)
+    {
+        fail(QStringLiteral("Truncated deflate stream for %1").arg(m_entryName));
+    }
+}
+
+void ZipStreamExtractor::readDescriptor(const char *&data, qint64 &size)
+{
+    if (!fill(data, size, 4))
+        return;
+
+    // the descriptor signature is optional
+    const int offset = readUInt32(m_pending.constData()) == DescriptorSignature ? 4 : 0;
+    if (!fill(data, size, offset + (m_zip64 ? 20 : 12)))
+        return;
+
+    const char *descriptor = m_pending.constData() + offset;
+    quint32 crc = readUInt32(descriptor);
+    quint64 compressedSize = m_zip64 ? readUInt64(descriptor + 4) : readUInt32(descriptor + 4);
+    quint64 uncompressedSize = m_zip64 ? readUInt64(descriptor + 12) : readUInt32(descriptor + 8);
+    m_pending.clear();
+    closeEntry(crc, compressedSize, uncompressedSize);
+}
+
+void ZipStreamExtractor::readDirectory(const char *&data, qint64 &size)
+{
+    if (!fill(data, size, 4))
+        return;
+
+    // the end of central directory records follow the last file header
+    if (readUInt32(m_pending.constData()) != CentralHeaderSignature)
+    {
+        m_state = State::Done;
+        m_pending.clear();
+        return;
+    }
+
+    if (!fill(data, size, CentralHeaderSize))
+        return;
+
+    quint16 nameLength = readUInt16(m_pending.constData() + 28);
+    quint16 extraLength = readUInt16(m_pending.constData() + 30);
+    quint16 commentLength = readUInt16(m_pending.constData() + 32);
+    if (!fill(data, size, CentralHeaderSize + nameLength + extraLength + commentLength))
+        return;
+
+    const char *header = m_pending.constData();
+    const quint32 mode = unixMode(header);
+    const QString name = entryName(header + CentralHeaderSize, nameLength, readUInt16(header + 8));
+    m_pending.clear();
+    if (mode == 0 || name.endsWith(QLatin1Char('/')))
+        return;
+
+    // the entry was checked when it was extracted, a name that wasn't is never touched
+    const QString path = entryPath(name);
+    if (path.isEmpty() || !QFileInfo::exists(QDir(m_destinationPath).filePath(path)))
+        return;
+
+    QString error = applyUnixMode(m_destinationPath, path, mode, m_store);
+    if (!error.isEmpty())
+        fail(error);
+}
+
+bool ZipStreamExtractor::openEntry()
+{
+    if (m_flags & EncryptedFlag)
+    {
+        fail(QStringLiteral("Encrypted entry %1 is not supported").arg(m_entryName));
+        return false;
+    }
+
+    if (m_method != StoredMethod && m_method != DeflatedMethod)
+    {
+        fail(QStringLiteral("Compression method %1 of %2 is not supported").arg(m_method).arg(m_entryName));
+        return false;
+    }
+
+    if (m_method == StoredMethod && (m_flags & DescriptorFlag))
+    {
+        fail(QStringLiteral("Stored entry %1 has no size and can't be streamed").arg(m_entryName));
+        return false;
+    }
+
+    // never write outside of the destination folder
+    QString path = entryPath(m_entryName);
+    if (path.isEmpty())
+    {
+        fail(QStringLiteral("Unsafe entry path %1").arg(m_entryName));
+        return false;
+    }
+
+    QDir destination(m_destinationPath);
+    m_compressedRead = 0;
+    m_written = 0;
+    m_runningCrc = crc32(0, Z_NULL, 0);
+    m_entryHash.reset();
+    m_entryFile = nullptr;
+
+    if (m_entryName.endsWith(QLatin1Char('/')))
+    {
+        destination.mkpath(path);
+    }
+    else
+    {
+        auto filePath = destination.filePath(path);
+        destination.mkpath(QFileInfo(filePath).path());
+        // a previous extraction may have linked the file to the store, it is replaced rather than rewritten
+        QFile::remove(filePath);
+        m_entryFile = std::make_unique<QFile>(filePath);
+        if (!m_entryFile->open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            fail(QStringLiteral("Cannot create file %1").arg(filePath));
+            return false;
+        }
+    }
+
+    if (m_method == DeflatedMethod)
+    {
+        m_stream = z_stream{};
+        if (inflateInit2(&m_stream, -MAX_WBITS) != Z_OK)
+        {
+            fail(QStringLiteral("Cannot initialize inflate for %1").arg(m_entryName));
+            return false;
+        }
+        m_inflating = true;
+    }
+
+    m_state = State::Data;
+    if (m_method == StoredMethod && m_compressedSize == 0)
+        closeEntry(m_crc, m_compressedSize, m_uncompressedSize);
+    return true;
+}
+
+bool ZipStreamExtractor::writeEntry(const char *data, qint64 size)
+{
+    if (size <= 0)
+        return true;
+
+    m_runningCrc = crc32(m_runningCrc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+    m_written += static_cast<quint64>(size);
+    if (m_store.isEnabled())
+        m_entryHash.addData(data, static_cast<int>(size));
+    if (m_entryFile != nullptr && m_entryFile->write(data, size) != size)
+    {
+        fail(QStringLiteral("Cannot write %1: %2").arg(m_entryName, m_entryFile->errorString()));
+        return false;
+    }
+    return true;
+}
+
+void ZipStreamExtractor::closeEntry(quint32 crc, quint64 compressedSize, quint64 uncompressedSize)
+{
+    if (m_runningCrc != crc || m_written != uncompressedSize || m_compressedRead != compressedSize)
+    {
+        fail(QStringLiteral("Entry %1 is corrupted").arg(m_entryName));
+        return;
+    }
+
+    if (m_entryFile != nullptr && m_store.isEnabled())
+    {
+        m_entryFile->close();
+        m_store.add(m_entryFile->fileName(), m_entryHash.result());
+    }
+    m_entryFile = nullptr;
+    ++m_entryCount;
+    m_state = State::Header;
+}
+
+void ZipStreamExtractor::fail(const QString &error)
+{
+    m_error = error;
+    m_state = State::Error;
+    m_entryFile = nullptr;
+    if (m_inflating)
+    {
+        inflateEnd(&m_stream);
+        m_inflating = false;
+    }
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef UCD_ZIPSTREAMEXTRACTOR_H
+#define UCD_ZIPSTREAMEXTRACTOR_H
+
+#pragma once
+
+#include <memory>
+
+#include "contentstore.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+
+#include <zlib.h>
+
+class QFile;
+
+namespace ucd
+{
+
+/**
+ * @brief Extracts a ZIP archive from a forward only byte stream.
+ *
+ * Entries are inflated as soon as their bytes are written, so an archive can
+ * be extracted while it is still downloading. Local headers are trusted for
+ * the entry sizes, including their ZIP64 extra field. Stored entries that
+ * defer their sizes to a data descriptor can't be streamed and make the
+ * extraction fail, the archive must then be extracted from disk. Unix modes
+ * and symbolic links are only known from the central directory, they are
+ * applied to the extracted entries as its records go by.
+ */
+class ZipStreamExtractor
+{
+public:
+    explicit ZipStreamExtractor(QString destinationPath, ContentStore store = ContentStore());
+    ZipStreamExtractor(const ZipStreamExtractor&) = delete;
+    ~ZipStreamExtractor();
+
+    ZipStreamExtractor& operator=(const ZipStreamExtractor&) = delete;
+
+    /**
+     * @brief Feed the next bytes of the archive.
+     * @return false if the archive can't be extracted.
+     */
+    bool write(const char *data, qint64 size);
+    /**
+     * @brief Check that every entry was extracted.
+     * @return true if the stream went through the central directory.
+     */
+    bool finish();
+
+    /**
+     * @brief Check that the bytes written so far end with a complete entry.
+     */
+    bool atEntryBoundary() const { return m_state == State::Header && m_pending.isEmpty(); }
+
+    const QString& errorString() const { return m_error; }
+    int entryCount() const { return m_entryCount; }
+
+private:
+    enum class State
+    {
+        Header,
+        Data,
+        Descriptor,
+        Directory,
+        Done,
+        Error,
+    };
+
+    bool fill(const char *&data, qint64 &size, int length);
+    void readHeader(const char *&data, qint64 &size);
+    void readData(const char *&data, qint64 &size);
+    void readDescriptor(const char *&data, qint64 &size);
+    void readDirectory(const char *&data, qint64 &size);
+    bool openEntry();
+    bool writeEntry(const char *data, qint64 size);
+    void closeEntry(quint32 crc, quint64 compressedSize, quint64 uncompressedSize);
+    void fail(const QString &error);
+
+    QString m_destinationPath;
+    ContentStore m_store;
+    State m_state;
+    QByteArray m_pending;
+    QByteArray m_output;
+    QString m_error;
+    int m_entryCount;
+
+    // current entry
+    QString m_entryName;
+    quint16 m_flags;
+    quint16 m_method;
+    quint32 m_crc;
+    quint64 m_compressedSize;
+    quint64 m_uncompressedSize;
+    bool m_zip64;
+    quint64 m_compressedRead;
+    quint64 m_written;
+    quint32 m_runningCrc;
+    std::unique_ptr<QFile> m_entryFile;
+    QCryptographicHash m_entryHash;
+    z_stream m_stream;
+    bool m_inflating;
+};
+
+}
+
+#endif // UCD_ZIPSTREAMEXTRACTOR_H
@@ -38,3 +38,33 @@ void QmlContext::refreshSync() const
 {
     ucd::ServiceLocator::synchronizer()->refresh();
 }
+
+qint64 QmlContext::bandwidthLimit() const
+{
+    return ucd::ServiceLocator::synchronizer()->bandwidthLimit();
+}
+
+void QmlContext::setBandwidthLimit(qint64 bytesPerSecond) const
+{
+    ucd::ServiceLocator::synchronizer()->setBandwidthLimit(bytesPerSecond);
+}
+
+QString QmlContext::bandwidthSchedule() const
+{
+    return ucd::ServiceLocator::synchronizer()->bandwidthSchedule();
+}
+
+void QmlContext::setBandwidthSchedule(const QString &schedule) const
+{
+    ucd::ServiceLocator::synchronizer()->setBandwidthSchedule(schedule);
+}
+
+QString QmlContext::downloadQueuePolicy() const
+{
+    return ucd::ServiceLocator::synchronizer()->downloadQueuePolicy();
+}
+
+void QmlContext::setDownloadQueuePolicy(const QString &policy) const
+{
+    ucd::ServiceLocator::synchronizer()->setDownloadQueuePolicy(policy);
+}
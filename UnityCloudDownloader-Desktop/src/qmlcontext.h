@@ -19,6 +19,13 @@ public:
     Q_INVOKABLE void openBuildFolder(ucd::BuildRef build) const;
 
     Q_INVOKABLE void refreshSync() const;
+
+    Q_INVOKABLE qint64 bandwidthLimit() const;
+    Q_INVOKABLE void setBandwidthLimit(qint64 bytesPerSecond) const;
+    Q_INVOKABLE QString bandwidthSchedule() const;
+    Q_INVOKABLE void setBandwidthSchedule(const QString &schedule) const;
+    Q_INVOKABLE QString downloadQueuePolicy() const;
+    Q_INVOKABLE void setDownloadQueuePolicy(const QString &policy) const;
 };
 
 #endif // QMLCONTEXT_H
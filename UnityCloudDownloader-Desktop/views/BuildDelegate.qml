@@ -43,6 +43,16 @@ ItemDelegate {
         visible: isDownloading && downloadProgress < 1
     }
 
+    Label {
+        id: queuePositionText
+        font.pointSize: 11
+        anchors.right: downloadProgressBar.right
+        anchors.bottom: downloadProgressBar.top
+        anchors.bottomMargin: 2
+        text: qsTr("Queued #%1").arg(queuePosition + 1)
+        visible: isQueued && queuePosition >= 0
+    }
+
     Image {
         id: icon
         width: 60
@@ -150,6 +150,43 @@ Page {
             }
         }
 
+        Text {
+            color: Material.foreground
+            text: qsTr("Downloads")
+            font.pointSize: 16
+            Layout.alignment: Qt.AlignRight
+        }
+
+        SpinBox {
+            id: downloadsSpin
+            from: 0
+            to: 16
+            editable: true
+            textFromValue: function(value, locale) { return value === 0 ? qsTr("Auto") : Number(value).toLocaleString(locale, 'f', 0) }
+            valueFromText: function(text, locale) { return text === qsTr("Auto") ? 0 : Number.fromLocaleString(locale, text) }
+
+            Component.onCompleted: {
+                value = editProfilePage.profile.maxDownloads
+                valueModified.connect(function() { editProfilePage.profile.maxDownloads = value })
+            }
+        }
+
+        Text {
+            color: Material.foreground
+            text: qsTr("Share Files")
+            font.pointSize: 16
+            Layout.alignment: Qt.AlignRight
+        }
+
+        Switch {
+            id: deduplicateSwitch
+
+            Component.onCompleted: {
+                checked = editProfilePage.profile.deduplicate
+                toggled.connect(function() { editProfilePage.profile.deduplicate = checked })
+            }
+        }
+
         Button {
             id: nextButton
             text: qsTr("Save")
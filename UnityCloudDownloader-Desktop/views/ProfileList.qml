@@ -53,10 +53,17 @@ Page {
                 id: editButton
                 text: qsTr("Edit")
                 Layout.fillWidth: true
-                Layout.rightMargin: 10
                 enabled: profileListView.currentIndex !== -1
                 onClicked: mainStack.push("EditProfile.qml", { "profilesModel": profilesModel, "profile": profilesModel.profile(profileListView.currentIndex) })
             }
+
+            Button {
+                id: settingsButton
+                text: qsTr("Settings")
+                Layout.fillWidth: true
+                Layout.rightMargin: 10
+                onClicked: mainStack.push("Settings.qml")
+            }
         }
     }
 
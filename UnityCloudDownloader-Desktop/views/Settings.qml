@@ -0,0 +1,131 @@
+import QtQuick 2.0
+import QtQuick.Controls 2.2
+import QtQuick.Layouts 1.3
+import QtQuick.Controls.Material 2.3
+
+Page {
+    id: settingsPage
+
+    footer: ToolBar {
+        RowLayout {
+            anchors.fill: parent
+
+            Item {
+                Layout.fillWidth: true
+            }
+
+            Button {
+                text: qsTr("Back")
+                Layout.minimumWidth: 120
+                Layout.rightMargin: 10
+                onClicked: {
+                    mainStack.pop()
+                }
+            }
+        }
+    }
+
+    Text {
+        color: Material.foreground
+        text: qsTr("Settings")
+        anchors.top: parent.top
+        anchors.topMargin: 20
+        font.pointSize: 30
+        anchors.horizontalCenter: parent.horizontalCenter
+    }
+
+    GridLayout {
+        id: grid
+        columns: 2
+        anchors.right: parent.right
+        anchors.rightMargin: 80
+        anchors.left: parent.left
+        anchors.leftMargin: 80
+        anchors.top: parent.top
+        anchors.topMargin: 100
+        anchors.bottom: parent.bottom
+        anchors.bottomMargin: 20
+        columnSpacing: 10
+
+        Text {
+            color: Material.foreground
+            text: qsTr("Bandwidth (KB/s)")
+            font.pointSize: 16
+            Layout.alignment: Qt.AlignRight
+        }
+
+        SpinBox {
+            id: bandwidthSpin
+            from: 0
+            to: 1000000
+            stepSize: 128
+            editable: true
+            textFromValue: function(value, locale) { return value === 0 ? qsTr("Unlimited") : Number(value).toLocaleString(locale, 'f', 0) }
+            valueFromText: function(text, locale) { return text === qsTr("Unlimited") ? 0 : Number.fromLocaleString(locale, text) }
+
+            Component.onCompleted: {
+                value = Math.round(bandwidthLimit() / 1024)
+            }
+        }
+
+        Text {
+            color: Material.foreground
+            text: qsTr("Schedule")
+            font.pointSize: 16
+            Layout.alignment: Qt.AlignRight
+        }
+
+        TextField {
+            id: scheduleField
+            // windows with their rate in bytes per second, 0 is unlimited
+            placeholderText: qsTr("22:00-06:00=0;09:00-18:00=524288")
+            Layout.fillWidth: true
+
+            Component.onCompleted: {
+                text = bandwidthSchedule()
+            }
+        }
+
+        Text {
+            color: Material.foreground
+            text: qsTr("Queue Order")
+            font.pointSize: 16
+            Layout.alignment: Qt.AlignRight
+        }
+
+        ComboBox {
+            id: policyCombo
+            textRole: "text"
+            Layout.fillWidth: true
+            model: ListModel {
+                ListElement { text: qsTr("Newest First"); policy: "newest" }
+                ListElement { text: qsTr("Smallest First"); policy: "smallest" }
+            }
+
+            Component.onCompleted: {
+                currentIndex = downloadQueuePolicy() === "smallest" ? 1 : 0
+            }
+        }
+
+        Button {
+            id: saveButton
+            text: qsTr("Save")
+            Layout.columnSpan: 2
+            Layout.alignment: Qt.AlignHCenter
+            Layout.minimumWidth: 120
+
+            onClicked: {
+                setBandwidthLimit(bandwidthSpin.value * 1024)
+                setBandwidthSchedule(scheduleField.text)
+                setDownloadQueuePolicy(policyCombo.model.get(policyCombo.currentIndex).policy)
+                mainStack.pop()
+            }
+        }
+
+        Item {
+            Layout.columnSpan: 2
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#-------------------------------------------------
+#
+# Unit tests of the core library
+#
+#-------------------------------------------------
+
+QT       += testlib network sql concurrent
+
+QT       -= gui
+
+TARGET = UnityCloudDownloader-Tests
+TEMPLATE = app
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# the core is built into the tests so its internal units can be reached without exporting them
+DEFINES += UCD_CORE_STATIC
+include(../UnityCloudDownloader-Core/core.pri)
+
+SOURCES += \
+    src/httpstandin.cpp \
+    src/main.cpp \
+    src/testarchive.cpp \
+    src/tst_bandwidthlimiter.cpp \
+    src/tst_buildlistparser.cpp \
+    src/tst_daos.cpp \
+    src/tst_downloadqueue.cpp \
+    src/tst_downloadworker.cpp \
+    src/tst_schemamigrations.cpp \
+    src/tst_syntheticdatabase.cpp \
+    src/tst_zip.cpp
+
+HEADERS += \
+    src/httpstandin.h \
+    src/testarchive.h \
+    src/tst_bandwidthlimiter.h \
+    src/tst_buildlistparser.h \
+    src/tst_daos.h \
+    src/tst_downloadqueue.h \
+    src/tst_downloadworker.h \
+    src/tst_schemamigrations.h \
+    src/tst_syntheticdatabase.h \
+    src/tst_zip.h
+
+win32 {
+        TEMPDIR = $$OUT_PWD/tmp/win32/$$TARGET
+        MOC_DIR = $$TEMPDIR
+        OBJECTS_DIR = $$TEMPDIR
+        RCC_DIR = $$TEMPDIR
+        UI_DIR = $$TEMPDIR/Ui
+        DEFINES += _WINDOWS WIN32_LEAN_AND_MEAN NOMINMAX
+}
+
+CONFIG( debug, debug|release ) {
+        DESTDIR = $$PWD/../build-debug/
+} else {
+        DESTDIR = $$PWD/../build/
+}
+
@@ -0,0 +1,220 @@
+#include "httpstandin.h"
+
+#include <algorithm>
+
+#include <QHostAddress>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace ucd
+{
+
+enum
+{
+    TickInterval = 10,
+    WriteSize = 256 * 1024, // bytes queued on a socket at once
+};
+
+HttpConnection::HttpConnection(qintptr socketDescriptor, HttpStandInState *state, QObject *parent)
+    : QObject(parent)
+    , m_state(state)
+    , m_socket(new QTcpSocket(this))
+    , m_tick(new QTimer(this))
+    , m_offset(0)
+    , m_end(0)
+    , m_budget(0)
+{
+    m_tick->setTimerType(Qt::PreciseTimer);
+    m_tick->setInterval(TickInterval);
+    connect(m_tick, &QTimer::timeout, this, &HttpConnection::onTick);
+    connect(m_socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &HttpConnection::onBytesWritten);
+    connect(m_socket, &QTcpSocket::disconnected, this, &HttpConnection::deleteLater);
+    m_socket->setSocketDescriptor(socketDescriptor);
+}
+
+void HttpConnection::onReadyRead()
+{
+    m_request += m_socket->readAll();
+    if (!m_request.contains("\r\n\r\n"))
+        return;
+
+    // a connection answers a single request
+    disconnect(m_socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    respond();
+}
+
+void HttpConnection::onTick()
+{
+    const qint64 tickBytes = std::max<qint64>(m_state->bandwidthCap * TickInterval / 1000, 1);
+    m_budget = std::min(m_budget + tickBytes, tickBytes);
+    sendBody();
+}
+
+void HttpConnection::onBytesWritten()
+{
+    sendBody();
+}
+
+void HttpConnection::respond()
+{
+    const auto lines = m_request.left(m_request.indexOf("\r\n\r\n")).split('\n');
+    const auto requestLine = lines.first().trimmed().split(' ');
+    QByteArray range;
+    for (const auto &line : lines.mid(1))
+    {
+        const int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == "range")
+            range = line.mid(colon + 1).trimmed();
+    }
+    ++m_state->requestCount;
+
+    QByteArray header;
+    const auto resourceIt = m_state->resources.constFind(QString::fromUtf8(requestLine.value(1)));
+    if (requestLine.value(0) != "GET" || resourceIt == m_state->resources.constEnd())
+    {
+        header = "HTTP/1.1 404 Not Found\r\n";
+    }
+    else
+    {
+        m_body = *resourceIt;
+        const qint64 size = m_body.size();
+        m_end = size;
+
+        static const QRegularExpression rangeExp(QStringLiteral("^bytes=(\\d+)-(\\d*)$"));
+        const auto match = rangeExp.match(QString::fromLatin1(range));
+        if (m_state->rangesSupported && match.hasMatch())
+        {
+            m_offset = match.captured(1).toLongLong();
+            if (!match.captured(2).isEmpty())
+                m_end = std::min(match.captured(2).toLongLong() + 1, size);
+            if (m_offset < m_end)
+            {
+                header = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + QByteArray::number(m_offset)
+                        + '-' + QByteArray::number(m_end - 1) + '/' + QByteArray::number(size) + "\r\n";
+            }
+            else
+            {
+                header = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" + QByteArray::number(size) + "\r\n";
+                m_offset = m_end = 0;
+            }
+        }
+        else
+        {
+            header = "HTTP/1.1 200 OK\r\n";
+        }
+        header += "Content-Type: application/octet-stream\r\nETag: \"stand-in\"\r\n";
+        if (m_state->rangesSupported)
+            header += "Accept-Ranges: bytes\r\n";
+    }
+    header += "Content-Length: " + QByteArray::number(m_end - m_offset) + "\r\nConnection: close\r\n\r\n";
+    m_socket->write(header);
+
+    if (m_state->bandwidthCap > 0)
+    {
+        m_tick->start();
+        onTick();
+    }
+    else
+    {
+        sendBody();
+    }
+}
+
+void HttpConnection::sendBody()
+{
+    while (m_offset < m_end && m_socket->bytesToWrite() < WriteSize)
+    {
+        qint64 count = std::min<qint64>(m_end - m_offset, WriteSize);
+        if (m_state->bandwidthCap > 0)
+        {
+            // the rest waits for the next tick
+            count = std::min(count, m_budget);
+            if (count <= 0)
+                return;
+            m_budget -= count;
+        }
+        m_socket->write(m_body.constData() + m_offset, count);
+        m_offset += count;
+        m_state->servedBytes += count;
+    }
+
+    if (m_offset >= m_end && m_socket->state() == QAbstractSocket::ConnectedState)
+    {
+        // the socket closes once its queued bytes are written
+        m_tick->stop();
+        m_socket->disconnectFromHost();
+    }
+}
+
+HttpServer::HttpServer(HttpStandInState *state)
+    : m_state(state)
+{}
+
+bool HttpServer::listenLoopback()
+{
+    return listen(QHostAddress::LocalHost);
+}
+
+void HttpServer::incomingConnection(qintptr socketDescriptor)
+{
+    new HttpConnection(socketDescriptor, m_state, this);
+}
+
+HttpStandIn::HttpStandIn()
+    : m_server(nullptr)
+    , m_port(0)
+{
+    m_thread.setObjectName(QStringLiteral("HttpStandIn"));
+}
+
+HttpStandIn::~HttpStandIn()
+{
+    // the server and its connections are deleted as the thread finishes
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void HttpStandIn::addResource(const QString &path, const QByteArray &content)
+{
+    m_state.resources.insert(path, content);
+}
+
+void HttpStandIn::setRangesSupported(bool value)
+{
+    m_state.rangesSupported = value;
+}
+
+void HttpStandIn::setBandwidthCap(qint64 bytesPerSecond)
+{
+    m_state.bandwidthCap = bytesPerSecond;
+}
+
+bool HttpStandIn::start()
+{
+    m_server = new HttpServer(&m_state);
+    m_server->moveToThread(&m_thread);
+    QObject::connect(&m_thread, &QThread::finished, m_server, &QObject::deleteLater);
+    m_thread.start();
+
+    bool listening = false;
+    QMetaObject::invokeMethod(m_server, "listenLoopback", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, listening));
+    if (!listening)
+        return false;
+    m_port = m_server->serverPort();
+    return true;
+}
+
+QUrl HttpStandIn::url(const QString &path) const
+{
+    return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(m_port).arg(path));
+}
+
+void HttpStandIn::resetCounters()
+{
+    m_state.servedBytes = 0;
+    m_state.requestCount = 0;
+}
+
+}
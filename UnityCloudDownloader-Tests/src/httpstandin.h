@@ -0,0 +1,123 @@
+#ifndef UCD_HTTPSTANDIN_H
+#define UCD_HTTPSTANDIN_H
+
+#pragma once
+
+#include <atomic>
+
+#include <QByteArray>
+#include <QHash>
+#include <QTcpServer>
+#include <QThread>
+#include <QUrl>
+
+class QTcpSocket;
+class QTimer;
+
+namespace ucd
+{
+
+/**
+ * @brief The settings and counters of a stand-in, shared with its thread.
+ */
+struct HttpStandInState
+{
+    QHash<QString, QByteArray> resources; // by path, read only once serving
+    bool rangesSupported = true;
+    qint64 bandwidthCap = 0; // bytes per second and connection, 0 for none
+    std::atomic<qint64> servedBytes{0};
+    std::atomic<int> requestCount{0};
+};
+
+/**
+ * @brief Answers one request on a loopback connection, then closes it.
+ */
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+public:
+    HttpConnection(qintptr socketDescriptor, HttpStandInState *state, QObject *parent = nullptr);
+
+private slots:
+    void onReadyRead();
+    void onTick();
+    void onBytesWritten();
+
+private:
+    void respond();
+    void sendBody();
+
+    HttpStandInState *m_state;
+    QTcpSocket *m_socket;
+    QTimer *m_tick;
+    QByteArray m_request;
+    QByteArray m_body;
+    qint64 m_offset;
+    qint64 m_end;
+    qint64 m_budget;
+};
+
+/**
+ * @brief Listens on the loopback interface from the thread of the stand-in.
+ */
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit HttpServer(HttpStandInState *state);
+
+public slots:
+    bool listenLoopback();
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    HttpStandInState *m_state;
+};
+
+/**
+ * @brief A minimal HTTP server standing in for the artifact storage.
+ *
+ * Resources are served from memory on their own thread, so serving doesn't
+ * compete with the event loop of the downloads. Single byte ranges are
+ * answered with partial content unless disabled, and each connection can be
+ * capped to a bandwidth like a congested route.
+ */
+class HttpStandIn
+{
+public:
+    HttpStandIn();
+    HttpStandIn(const HttpStandIn&) = delete;
+    ~HttpStandIn();
+
+    HttpStandIn& operator=(const HttpStandIn&) = delete;
+
+    /**
+     * @brief Serve the content at the path, call it before start().
+     */
+    void addResource(const QString &path, const QByteArray &content);
+    void setRangesSupported(bool value);
+    void setBandwidthCap(qint64 bytesPerSecond);
+
+    /**
+     * @brief Start serving, the settings can't be changed anymore.
+     * @return false if the server can't listen.
+     */
+    bool start();
+
+    QUrl url(const QString &path) const;
+    qint64 servedBytes() const { return m_state.servedBytes; }
+    int requestCount() const { return m_state.requestCount; }
+    void resetCounters();
+
+private:
+    HttpStandInState m_state;
+    QThread m_thread;
+    HttpServer *m_server;
+    quint16 m_port;
+};
+
+}
+
+#endif // UCD_HTTPSTANDIN_H
@@ -0,0 +1,51 @@
+#include "tst_bandwidthlimiter.h"
+#include "tst_buildlistparser.h"
+#include "tst_daos.h"
+#include "tst_downloadqueue.h"
+#include "tst_downloadworker.h"
+#include "tst_schemamigrations.h"
+#include "tst_syntheticdatabase.h"
+#include "tst_zip.h"
+
+#include <QCoreApplication>
+#include <QtTest>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int status = 0;
+    {
+        ucd::TestBuildListParser test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestDownloadQueue test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestBandwidthLimiter test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestZip test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestSchemaMigrations test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestDaos test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestSyntheticDatabase test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ucd::TestDownloadWorker test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    return status;
+}
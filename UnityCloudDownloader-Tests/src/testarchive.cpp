@@ -0,0 +1,67 @@
+#include "testarchive.h"
+
+#include "zipformat.h"
+
+#include <QDataStream>
+
+#include <zlib.h>
+
+namespace ucd
+{
+
+static QByteArray rawDeflate(const QByteArray &data)
+{
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    QByteArray output(static_cast<int>(deflateBound(&stream, static_cast<uLong>(data.size()))), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    deflate(&stream, Z_FINISH);
+    output.resize(static_cast<int>(stream.total_out));
+    deflateEnd(&stream);
+    return output;
+}
+
+QByteArray makeArchive(const QVector<TestEntry> &entries)
+{
+    QByteArray archive;
+    QByteArray directory;
+    QDataStream out(&archive, QIODevice::WriteOnly);
+    QDataStream central(&directory, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    central.setByteOrder(QDataStream::LittleEndian);
+
+    for (const auto &entry : entries)
+    {
+        const QByteArray name = entry.name.toUtf8();
+        const QByteArray data = entry.deflated ? rawDeflate(entry.content) : entry.content;
+        const quint16 method = entry.deflated ? zip::DeflatedMethod : zip::StoredMethod;
+        const quint32 crc = static_cast<quint32>(crc32(0, reinterpret_cast<const Bytef*>(entry.content.constData()),
+                                                       static_cast<uInt>(entry.content.size())));
+        const quint32 offset = static_cast<quint32>(archive.size());
+
+        out << quint32(zip::LocalHeaderSignature) << quint16(20) << quint16(zip::Utf8Flag) << method
+            << quint16(0) << quint16(0) << crc << quint32(data.size()) << quint32(entry.content.size())
+            << quint16(name.size()) << quint16(0);
+        out.writeRawData(name.constData(), name.size());
+        out.writeRawData(data.constData(), data.size());
+
+        const quint16 madeBy = entry.mode != 0 ? (zip::UnixHost << 8) | 20 : 20;
+        central << quint32(zip::CentralHeaderSignature) << madeBy << quint16(20) << quint16(zip::Utf8Flag) << method
+                << quint16(0) << quint16(0) << crc << quint32(data.size()) << quint32(entry.content.size())
+                << quint16(name.size()) << quint16(0) << quint16(0) << quint16(0) << quint16(0)
+                << quint32(entry.mode << 16) << offset;
+        central.writeRawData(name.constData(), name.size());
+    }
+
+    const quint32 directoryOffset = static_cast<quint32>(archive.size());
+    out.writeRawData(directory.constData(), directory.size());
+    out << quint32(zip::EndOfCentralSignature) << quint16(0) << quint16(0)
+        << quint16(entries.size()) << quint16(entries.size())
+        << quint32(directory.size()) << directoryOffset << quint16(0);
+    return archive;
+}
+
+}
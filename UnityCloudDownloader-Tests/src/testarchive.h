@@ -0,0 +1,28 @@
+#ifndef UCD_TESTARCHIVE_H
+#define UCD_TESTARCHIVE_H
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace ucd
+{
+
+struct TestEntry
+{
+    QString name;
+    QByteArray content;
+    bool deflated;
+    quint32 mode; // 0 for an entry made on another host
+};
+
+/**
+ * @brief Build an archive with a local header per entry, the central directory and its end record.
+ */
+QByteArray makeArchive(const QVector<TestEntry> &entries);
+
+}
+
+#endif // UCD_TESTARCHIVE_H
@@ -0,0 +1,57 @@
+#include "tst_bandwidthlimiter.h"
+
+#include "bandwidthlimiter.h"
+
+#include <QtTest>
+
+namespace ucd
+{
+
+void TestBandwidthLimiter::parsesSchedule()
+{
+    const auto schedule = BandwidthLimiter::parseSchedule(QStringLiteral(" 09:00-18:00=524288 ; 22:00 - 06:00 = 0;"));
+    QCOMPARE(schedule.size(), 2);
+    QCOMPARE(schedule.at(0).start, QTime(9, 0));
+    QCOMPARE(schedule.at(0).end, QTime(18, 0));
+    QCOMPARE(schedule.at(0).rate, Q_INT64_C(524288));
+    QCOMPARE(schedule.at(1).start, QTime(22, 0));
+    QCOMPARE(schedule.at(1).end, QTime(6, 0));
+    QCOMPARE(schedule.at(1).rate, Q_INT64_C(0));
+
+    QVERIFY(BandwidthLimiter::parseSchedule(QString()).isEmpty());
+    QVERIFY(BandwidthLimiter::parseSchedule(QStringLiteral(" ; ;")).isEmpty());
+}
+
+void TestBandwidthLimiter::skipsInvalidEntries()
+{
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring bandwidth schedule entry 09:00=100");
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring bandwidth schedule entry 25:00-06:00=100");
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring bandwidth schedule entry 01:00-02:00=fast");
+    QTest::ignoreMessage(QtWarningMsg, "Ignoring bandwidth schedule entry 01:00-02:00=-5");
+    const auto schedule = BandwidthLimiter::parseSchedule(
+                QStringLiteral("09:00=100;25:00-06:00=100;01:00-02:00=fast;01:00-02:00=-5;03:00-04:00=2048"));
+    QCOMPARE(schedule.size(), 1);
+    QCOMPARE(schedule.at(0).start, QTime(3, 0));
+    QCOMPARE(schedule.at(0).rate, Q_INT64_C(2048));
+}
+
+void TestBandwidthLimiter::appliesScheduleWindows()
+{
+    BandwidthLimiter limiter;
+    limiter.setDefaultRate(1000);
+    limiter.setSchedule(BandwidthLimiter::parseSchedule(QStringLiteral("09:00-18:00=500;22:00-06:00=0")));
+
+    limiter.update(QTime(12, 0));
+    QCOMPARE(limiter.rate(), Q_INT64_C(500));
+    limiter.update(QTime(18, 0));
+    QCOMPARE(limiter.rate(), Q_INT64_C(1000));
+    limiter.update(QTime(23, 30));
+    QCOMPARE(limiter.rate(), Q_INT64_C(0));
+    limiter.update(QTime(5, 59));
+    QCOMPARE(limiter.rate(), Q_INT64_C(0));
+
+    // without a limit every byte is granted at once
+    QCOMPARE(limiter.acquire(Q_INT64_C(1048576)), Q_INT64_C(1048576));
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef UCD_TST_BANDWIDTHLIMITER_H
+#define UCD_TST_BANDWIDTHLIMITER_H
+
+#pragma once
+
+#include <QObject>
+
+namespace ucd
+{
+
+class TestBandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesSchedule();
+    void skipsInvalidEntries();
+    void appliesScheduleWindows();
+};
+
+}
+
+#endif // UCD_TST_BANDWIDTHLIMITER_H
@@ -0,0 +1,259 @@
+#include "tst_buildlistparser.h"
+
+#include "buildlistparser.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QtTest>
+
+namespace ucd
+{
+
+enum
+{
+    ReadSize = 16 * 1024, // bytes handed over by a typical readyRead
+};
+
+static const QUuid s_buildTargetId(QStringLiteral("{6d8a4c1e-2a56-4f0b-9a39-1f4c2b7e5d10}"));
+
+static const char s_builds[] = R"([
+    {
+        "build": 42,
+        "buildTargetName": "Android",
+        "buildStatus": "success",
+        "created": "2019-03-01T10:20:30.400Z",
+        "platform": "android",
+        "links": {
+            "icon": { "method": "get", "href": "https://example.com/icon.png" },
+            "artifacts": [
+                {
+                    "key": "primary",
+                    "files": [
+                        { "filename": "game.apk", "size": 123456, "href": "https://example.com/game.apk", "md5sum": "0123456789abcdef" },
+                        { "filename": "other.apk", "size": 1, "href": "https://example.com/other.apk" }
+                    ]
+                }
+            ]
+        }
+    },
+    {
+        "build": 41,
+        "buildTargetName": "Android",
+        "buildStatus": "failure",
+        "created": "2019-02-28T08:00:00.000Z",
+        "links": {}
+    }
+])";
+
+static QVector<Build> parse(const QByteArray &json, int chunkSize, bool *ok)
+{
+    BuildListParser parser(s_buildTargetId);
+    for (int i = 0; i < json.size(); i += chunkSize)
+        parser.feed(json.mid(i, chunkSize));
+    *ok = parser.finish();
+    return parser.takeBuilds();
+}
+
+// a build list shaped like the recorded responses, with one primary and one secondary artifact per build
+static QByteArray buildList(int count)
+{
+    QByteArray json("[");
+    for (int i = count; i > 0; --i)
+    {
+        const QByteArray id = QByteArray::number(i);
+        json += R"({"build":)" + id + R"(,"buildTargetName":"Android","buildStatus":"success",)"
+                R"("created":"2019-03-01T10:20:30.400Z","platform":"android","links":{)"
+                R"("icon":{"method":"get","href":"https://example.com/icon.png"},"artifacts":[)"
+                R"({"key":"symbols","files":[{"filename":"symbols.zip","size":1024,"href":"https://example.com/)" + id + R"(/symbols.zip"}]},)"
+                R"({"key":"primary","files":[{"filename":"game.apk","size":123456789,"href":"https://example.com/)" + id + R"(/game.apk","md5sum":"0123456789abcdef"}]})"
+                R"(]}})";
+        if (i > 1)
+            json += ',';
+    }
+    json += ']';
+    return json;
+}
+
+// the document based parsing the streaming parser replaced, kept as the baseline of the benchmarks
+static QVector<Build> parseDocument(const QByteArray &json)
+{
+    QVector<Build> builds;
+    const auto jsonBuilds = QJsonDocument::fromJson(json).array();
+    for (QJsonValue value : jsonBuilds)
+    {
+        Build build;
+        build.setId(value["build"].toInt());
+        build.setBuildTargetId(s_buildTargetId);
+        build.setName(value["buildTargetName"].toString());
+        build.setStatus(Build::statusFromString(value["buildStatus"].toString()));
+        build.setCreateTime(value["created"].toVariant().toDateTime());
+        auto links = value["links"];
+        if (links.isObject())
+        {
+            auto icon = links["icon"];
+            if (icon.isObject())
+                build.setIconPath(icon["href"].toString());
+            const auto artifacts = links["artifacts"].toArray();
+            for (QJsonValue artifact : artifacts)
+            {
+                if (artifact["key"].toString() != QStringLiteral("primary"))
+                    continue;
+                const auto files = artifact["files"].toArray();
+                if (!files.isEmpty())
+                {
+                    QJsonValue file = files[0];
+                    build.setArtifactName(file["filename"].toString());
+                    build.setArtifactSize(file["size"].toVariant().toLongLong());
+                    build.setArtifactPath(file["href"].toString());
+                    build.setArtifactMd5(file["md5sum"].toString());
+                }
+                break;
+            }
+        }
+        builds.append(std::move(build));
+    }
+    return builds;
+}
+
+static void checkBuilds(const QVector<Build> &builds)
+{
+    QCOMPARE(builds.size(), 2);
+
+    const Build &first = builds.at(0);
+    QCOMPARE(first.id(), 42);
+    QCOMPARE(first.name(), QStringLiteral("Android"));
+    QCOMPARE(first.status(), Build::Status::Success);
+    QCOMPARE(first.buildTargetId(), s_buildTargetId);
+    QCOMPARE(first.createTime(), QDateTime(QDate(2019, 3, 1), QTime(10, 20, 30, 400), Qt::UTC));
+    QCOMPARE(first.iconPath(), QStringLiteral("https://example.com/icon.png"));
+    QCOMPARE(first.artifactName(), QStringLiteral("game.apk"));
+    QCOMPARE(first.artifactSize(), Q_INT64_C(123456));
+    QCOMPARE(first.artifactPath(), QStringLiteral("https://example.com/game.apk"));
+    QCOMPARE(first.artifactMd5(), QStringLiteral("0123456789abcdef"));
+
+    const Build &second = builds.at(1);
+    QCOMPARE(second.id(), 41);
+    QCOMPARE(second.status(), Build::Status::Failure);
+    QVERIFY(second.artifactName().isEmpty());
+    QCOMPARE(second.artifactSize(), Q_INT64_C(0));
+}
+
+void TestBuildListParser::parsesBuilds()
+{
+    bool ok = false;
+    const auto builds = parse(QByteArray(s_builds), sizeof(s_builds), &ok);
+    QVERIFY(ok);
+    checkBuilds(builds);
+}
+
+void TestBuildListParser::parsesByteByByte()
+{
+    bool ok = false;
+    const auto builds = parse(QByteArray(s_builds), 1, &ok);
+    QVERIFY(ok);
+    checkBuilds(builds);
+}
+
+void TestBuildListParser::decodesEscapes()
+{
+    const QByteArray json = R"([{"build":1,"buildTargetName":"iOS \"Beta\"\\\n\u00e9\ud83d\ude00","links":{"icon":{"href":"https:\/\/example.com\/i.png"}}}])";
+
+    bool ok = false;
+    const auto builds = parse(json, 3, &ok);
+    QVERIFY(ok);
+    QCOMPARE(builds.size(), 1);
+    QCOMPARE(builds.at(0).name(), QStringLiteral("iOS \"Beta\"\\\n") + QChar(0xe9) + QChar(0xd83d) + QChar(0xde00));
+    QCOMPARE(builds.at(0).iconPath(), QStringLiteral("https://example.com/i.png"));
+}
+
+void TestBuildListParser::keepsPrimaryArtifact()
+{
+    // the key of an artifact may come after its files
+    const QByteArray json = R"([{"build":7,"links":{"artifacts":[
+        {"key":"secondary","files":[{"filename":"symbols.zip","size":10}]},
+        {"files":[{"filename":"game.zip","size":20.0}],"key":"primary"},
+        {"key":"primary","files":[{"filename":"late.zip","size":30}]}
+    ]}}])";
+
+    bool ok = false;
+    const auto builds = parse(json, 5, &ok);
+    QVERIFY(ok);
+    QCOMPARE(builds.size(), 1);
+    QCOMPARE(builds.at(0).artifactName(), QStringLiteral("game.zip"));
+    QCOMPARE(builds.at(0).artifactSize(), Q_INT64_C(20));
+}
+
+void TestBuildListParser::rejectsInvalidJson()
+{
+    bool ok = true;
+    parse(R"([{"build":1 "name":"x"}])", 4, &ok);
+    QVERIFY(!ok);
+
+    parse(R"([{"build":1})", 4, &ok);
+    QVERIFY(!ok);
+
+    parse(R"([{"build":1}] [])", 4, &ok);
+    QVERIFY(!ok);
+
+    parse(R"([{"build":tru}])", 4, &ok);
+    QVERIFY(!ok);
+
+    BuildListParser parser;
+    QVERIFY(!parser.feed(R"([{"build" 1}])"));
+    QVERIFY(parser.hasError());
+    QVERIFY(!parser.feed("[]"));
+}
+
+void TestBuildListParser::benchmarkParser_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("100 builds") << 100;
+    QTest::newRow("10k builds") << 10000;
+    QTest::newRow("100k builds") << 100000;
+}
+
+void TestBuildListParser::benchmarkParser()
+{
+    QFETCH(int, count);
+    const QByteArray json = buildList(count);
+
+    QVector<Build> builds;
+    QBENCHMARK
+    {
+        bool ok = false;
+        builds = parse(json, ReadSize, &ok);
+        QVERIFY(ok);
+    }
+    QCOMPARE(builds.size(), count);
+    QCOMPARE(builds.last().artifactName(), QStringLiteral("game.apk"));
+}
+
+void TestBuildListParser::benchmarkDocument_data()
+{
+    benchmarkParser_data();
+}
+
+void TestBuildListParser::benchmarkDocument()
+{
+    QFETCH(int, count);
+    const QByteArray json = buildList(count);
+    if (QJsonDocument::fromJson(json).isNull())
+        QSKIP("The build list is too large for a QJsonDocument");
+
+    QVector<Build> builds;
+    QBENCHMARK
+    {
+        // the whole response is buffered before it is parsed
+        QByteArray response;
+        for (int i = 0; i < json.size(); i += ReadSize)
+            response += json.mid(i, ReadSize);
+        builds = parseDocument(response);
+    }
+    QCOMPARE(builds.size(), count);
+    QCOMPARE(builds.last().artifactName(), QStringLiteral("game.apk"));
+}
+
+}
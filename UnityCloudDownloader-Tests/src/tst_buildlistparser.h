@@ -0,0 +1,30 @@
+#ifndef UCD_TST_BUILDLISTPARSER_H
+#define UCD_TST_BUILDLISTPARSER_H
+
+#pragma once
+
+#include <QObject>
+
+namespace ucd
+{
+
+class TestBuildListParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesBuilds();
+    void parsesByteByByte();
+    void decodesEscapes();
+    void keepsPrimaryArtifact();
+    void rejectsInvalidJson();
+
+    void benchmarkParser_data();
+    void benchmarkParser();
+    void benchmarkDocument_data();
+    void benchmarkDocument();
+};
+
+}
+
+#endif // UCD_TST_BUILDLISTPARSER_H
@@ -0,0 +1,168 @@
+#include "tst_daos.h"
+
+#include "build.h"
+#include "builddao.h"
+#include "database.h"
+#include "downloadsdao.h"
+#include "sqlhelpers.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QtTest>
+
+namespace ucd
+{
+
+enum
+{
+    BuildCount = 1000,
+    DownloadedStatus = 1, // DownloadsDao::Downloaded
+};
+
+static const QUuid s_buildTargetId(QStringLiteral("{8b1f3e6a-4c2d-4e9b-a7f1-2d6c9e0b3a71}"));
+static const QByteArray s_digest("0123456789abcdef0123456789abcdef");
+
+// the lookup of BuildDao::build with its statement prepared on every call, as before the cache
+static Build preparedBuild(const QSqlDatabase &database, const QUuid &buildTargetId, int buildNumber)
+{
+    Build build;
+    QSqlQuery query(database);
+    query.prepare("SELECT * FROM Builds WHERE buildTargetId = :buildTargetId AND buildNumber = :buildNumber");
+    query.bindValue(":buildTargetId", uuidToSql(buildTargetId));
+    query.bindValue(":buildNumber", buildNumber);
+    if (query.exec() && query.next())
+    {
+        build.setId(query.value("buildNumber").toInt());
+        build.setBuildTargetId(uuidFromSql(query.value("buildTargetId")));
+        build.setStatus(query.value("status").toInt());
+        build.setName(query.value("name").toString());
+        build.setCreateTime(query.value("createTime").toDateTime());
+        build.setIconPath(query.value("iconPath").toString());
+        build.setArtifactName(query.value("artifactName").toString());
+        build.setArtifactSize(query.value("artifactSize").toLongLong());
+        build.setArtifactPath(query.value("artifactPath").toString());
+        build.setArtifactMd5(query.value("artifactMd5").toString());
+        build.setManualDownload(query.value("manualDownload").toBool());
+    }
+    return build;
+}
+
+// DownloadsDao::addDownload with its statements prepared on every call, as before the cache
+static bool preparedAddDownload(const QSqlDatabase &database, const BuildRef &buildRef, const QByteArray &digest)
+{
+    QSqlQuery query(database);
+    query.prepare("UPDATE Downloads SET "
+                  "status = :status, "
+                  "digest = :digest, "
+                  "attempts = 0, "
+                  "failure = 0, "
+                  "nextRetry = 0 "
+                  "WHERE buildTargetId = :buildTargetId "
+                  "AND buildNumber = :buildNumber");
+    query.bindValue(":status", int(DownloadedStatus));
+    query.bindValue(":digest", QString::fromLatin1(digest));
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
+    query.bindValue(":buildNumber", buildRef.buildNumber());
+    if (!query.exec())
+        return false;
+    if (query.numRowsAffected() > 0)
+        return true;
+
+    query.prepare("INSERT INTO Downloads (buildTargetId, buildNumber, status, digest) "
+                  "VALUES (:buildTargetId, :buildNumber, :status, :digest)");
+    query.bindValue(":buildTargetId", uuidToSql(buildRef.buildTargetId()));
+    query.bindValue(":buildNumber", buildRef.buildNumber());
+    query.bindValue(":status", int(DownloadedStatus));
+    query.bindValue(":digest", QString::fromLatin1(digest));
+    return query.exec();
+}
+
+TestDaos::TestDaos() = default;
+
+TestDaos::~TestDaos() = default;
+
+void TestDaos::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_database = std::make_unique<Database>(m_dir.path());
+    m_database->init();
+
+    QVector<Build> builds;
+    for (int i = 1; i <= BuildCount; ++i)
+    {
+        Build build;
+        build.setId(i);
+        build.setBuildTargetId(s_buildTargetId);
+        build.setStatus(Build::Success);
+        build.setName(QStringLiteral("Android"));
+        build.setCreateTime(QDateTime(QDate(2019, 3, 1), QTime(10, 20, 30), Qt::UTC));
+        build.setIconPath(QStringLiteral("https://example.com/icon.png"));
+        build.setArtifactName(QStringLiteral("game.apk"));
+        build.setArtifactSize(123456789);
+        build.setArtifactPath(QStringLiteral("https://example.com/%1/game.apk").arg(i));
+        build.setArtifactMd5(QString::fromLatin1(s_digest));
+        builds.append(build);
+    }
+    auto database = m_database->sqlDatabase();
+    BuildDao(database).upsertBuilds(builds);
+
+    // every build has its download row, the benchmarks time the update of a known download
+    QVERIFY(database.transaction());
+    for (int i = 1; i <= BuildCount; ++i)
+        DownloadsDao(database).addDownload(BuildRef(s_buildTargetId, i), s_digest);
+    QVERIFY(database.commit());
+}
+
+void TestDaos::cleanupTestCase()
+{
+    m_database.reset();
+}
+
+void TestDaos::benchmarkBuild_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("prepared per call") << false;
+    QTest::newRow("cached statement") << true;
+}
+
+void TestDaos::benchmarkBuild()
+{
+    QFETCH(bool, cached);
+    auto database = m_database->sqlDatabase();
+
+    int buildNumber = 0;
+    Build build;
+    QBENCHMARK
+    {
+        buildNumber = buildNumber % BuildCount + 1;
+        build = cached ? BuildDao(database).build(s_buildTargetId, buildNumber)
+                       : preparedBuild(database, s_buildTargetId, buildNumber);
+    }
+    QCOMPARE(build.id(), buildNumber);
+    QCOMPARE(build.artifactName(), QStringLiteral("game.apk"));
+}
+
+void TestDaos::benchmarkAddDownload_data()
+{
+    benchmarkBuild_data();
+}
+
+void TestDaos::benchmarkAddDownload()
+{
+    QFETCH(bool, cached);
+    auto database = m_database->sqlDatabase();
+
+    int buildNumber = 0;
+    QBENCHMARK
+    {
+        buildNumber = buildNumber % BuildCount + 1;
+        if (cached)
+            DownloadsDao(database).addDownload(BuildRef(s_buildTargetId, buildNumber), s_digest);
+        else
+            QVERIFY(preparedAddDownload(database, BuildRef(s_buildTargetId, buildNumber), s_digest));
+    }
+    QCOMPARE(DownloadsDao(database).downloadedBuilds(s_buildTargetId).size(), int(BuildCount));
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef UCD_TST_DAOS_H
+#define UCD_TST_DAOS_H
+
+#pragma once
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include <memory>
+
+namespace ucd
+{
+
+class Database;
+
+class TestDaos : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestDaos();
+    ~TestDaos() override;
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkBuild_data();
+    void benchmarkBuild();
+    void benchmarkAddDownload_data();
+    void benchmarkAddDownload();
+
+private:
+    QTemporaryDir m_dir;
+    std::unique_ptr<Database> m_database;
+};
+
+}
+
+#endif // UCD_TST_DAOS_H
@@ -0,0 +1,157 @@
+#include "tst_downloadqueue.h"
+
+#include "build.h"
+#include "downloadqueue.h"
+
+#include <QtTest>
+
+namespace ucd
+{
+
+static const QUuid s_targetA(QStringLiteral("{0b3c7f2e-8d41-4a6e-b1f5-3c9e2d7a4b01}"));
+static const QUuid s_targetB(QStringLiteral("{0b3c7f2e-8d41-4a6e-b1f5-3c9e2d7a4b02}"));
+static const QUuid s_targetC(QStringLiteral("{0b3c7f2e-8d41-4a6e-b1f5-3c9e2d7a4b03}"));
+
+static Build makeBuild(const QUuid &buildTargetId, int buildNumber, qint64 createTime, qint64 size = 0)
+{
+    Build build;
+    build.setBuildTargetId(buildTargetId);
+    build.setId(buildNumber);
+    build.setCreateTime(QDateTime::fromMSecsSinceEpoch(createTime, Qt::UTC));
+    build.setArtifactSize(size);
+    return build;
+}
+
+static QVector<BuildRef> queued(const DownloadQueue &queue)
+{
+    QVector<BuildRef> builds;
+    for (const auto &entry : queue)
+        builds.append(entry.build);
+    return builds;
+}
+
+static QVector<BuildRef> takeAll(DownloadQueue &queue)
+{
+    QVector<BuildRef> builds;
+    while (!queue.isEmpty())
+    {
+        builds.append(queue.begin()->build);
+        queue.take(queue.begin());
+    }
+    return builds;
+}
+
+void TestDownloadQueue::parsesPolicy()
+{
+    QCOMPARE(DownloadQueue::parsePolicy(QStringLiteral("smallest")), DownloadQueue::Policy::SmallestFirst);
+    QCOMPARE(DownloadQueue::parsePolicy(QStringLiteral("Smallest")), DownloadQueue::Policy::SmallestFirst);
+    QCOMPARE(DownloadQueue::parsePolicy(QStringLiteral("newest")), DownloadQueue::Policy::NewestFirst);
+    QCOMPARE(DownloadQueue::parsePolicy(QString()), DownloadQueue::Policy::NewestFirst);
+
+    QTest::ignoreMessage(QtWarningMsg, "Unknown download queue policy largest");
+    QCOMPARE(DownloadQueue::parsePolicy(QStringLiteral("largest")), DownloadQueue::Policy::NewestFirst);
+}
+
+void TestDownloadQueue::servesManualFirst()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 3, 300), DownloadQueue::Priority::Latest));
+    QVERIFY(queue.push(makeBuild(s_targetA, 1, 100), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetB, 1, 50), DownloadQueue::Priority::Manual));
+    QVERIFY(queue.push(makeBuild(s_targetA, 2, 200), DownloadQueue::Priority::Manual));
+    QVERIFY(!queue.push(makeBuild(s_targetA, 2, 200), DownloadQueue::Priority::Manual));
+
+    // manual downloads keep the request order
+    QCOMPARE(takeAll(queue), (QVector<BuildRef>{
+                 BuildRef(s_targetB, 1), BuildRef(s_targetA, 2), BuildRef(s_targetA, 3), BuildRef(s_targetA, 1)}));
+}
+
+void TestDownloadQueue::demotesOlderLatest()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 5, 500), DownloadQueue::Priority::Latest));
+    QVERIFY(queue.push(makeBuild(s_targetB, 1, 100), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetA, 7, 700), DownloadQueue::Priority::Latest));
+    QVERIFY(queue.push(makeBuild(s_targetA, 6, 600), DownloadQueue::Priority::Latest));
+
+    const auto builds = queued(queue);
+    QCOMPARE(builds.first(), BuildRef(s_targetA, 7));
+    QCOMPARE(queue.position(BuildRef(s_targetA, 7)), 0);
+    for (const auto &entry : queue)
+    {
+        if (!(entry.build == BuildRef(s_targetA, 7)))
+            QCOMPARE(entry.priority, DownloadQueue::Priority::Backfill);
+    }
+}
+
+void TestDownloadQueue::targetsTakeTurns()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 1, 100), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetA, 2, 200), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetA, 3, 300), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetB, 1, 50), DownloadQueue::Priority::Backfill));
+
+    // the lone build of B is served in the first round
+    QCOMPARE(queue.position(BuildRef(s_targetB, 1)), 1);
+    QCOMPARE(takeAll(queue), (QVector<BuildRef>{
+                 BuildRef(s_targetA, 1), BuildRef(s_targetB, 1), BuildRef(s_targetA, 2), BuildRef(s_targetA, 3)}));
+}
+
+void TestDownloadQueue::newTargetJoinsCurrentRound()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 1, 100), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetA, 2, 200), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetA, 3, 300), DownloadQueue::Priority::Backfill));
+    queue.take(queue.begin());
+    queue.take(queue.begin());
+
+    // a target queued later doesn't jump ahead of the rounds already served
+    QVERIFY(queue.push(makeBuild(s_targetC, 1, 10), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetC, 2, 20), DownloadQueue::Priority::Backfill));
+    QCOMPARE(takeAll(queue), (QVector<BuildRef>{
+                 BuildRef(s_targetC, 1), BuildRef(s_targetA, 3), BuildRef(s_targetC, 2)}));
+}
+
+void TestDownloadQueue::ordersByPolicy()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 1, 100, 3000), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetB, 1, 300, 2000), DownloadQueue::Priority::Backfill));
+    QVERIFY(queue.push(makeBuild(s_targetC, 1, 200, 1000), DownloadQueue::Priority::Backfill));
+
+    QCOMPARE(queue.policy(), DownloadQueue::Policy::NewestFirst);
+    QCOMPARE(queued(queue), (QVector<BuildRef>{
+                 BuildRef(s_targetB, 1), BuildRef(s_targetC, 1), BuildRef(s_targetA, 1)}));
+
+    queue.setPolicy(DownloadQueue::Policy::SmallestFirst);
+    QCOMPARE(queued(queue), (QVector<BuildRef>{
+                 BuildRef(s_targetC, 1), BuildRef(s_targetB, 1), BuildRef(s_targetA, 1)}));
+    QCOMPARE(queue.position(BuildRef(s_targetA, 1)), 2);
+}
+
+void TestDownloadQueue::removesBuilds()
+{
+    DownloadQueue queue;
+    QVERIFY(queue.push(makeBuild(s_targetA, 2, 200), DownloadQueue::Priority::Latest));
+    QVERIFY(queue.push(makeBuild(s_targetA, 1, 100), DownloadQueue::Priority::Backfill));
+
+    QVERIFY(!queue.remove(BuildRef(s_targetB, 1)));
+    QCOMPARE(queue.position(BuildRef(s_targetB, 1)), -1);
+
+    QVERIFY(queue.remove(BuildRef(s_targetA, 2)));
+    QVERIFY(!queue.contains(BuildRef(s_targetA, 2)));
+    QCOMPARE(queue.size(), 1);
+
+    // the removed build no longer holds the Latest class of its target
+    QVERIFY(queue.push(makeBuild(s_targetA, 3, 300), DownloadQueue::Priority::Latest));
+    QCOMPARE(queue.begin()->priority, DownloadQueue::Priority::Latest);
+    QCOMPARE(queue.begin()->build, BuildRef(s_targetA, 3));
+
+    QVERIFY(queue.remove(BuildRef(s_targetA, 1)));
+    QVERIFY(queue.remove(BuildRef(s_targetA, 3)));
+    QVERIFY(queue.isEmpty());
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef UCD_TST_DOWNLOADQUEUE_H
+#define UCD_TST_DOWNLOADQUEUE_H
+
+#pragma once
+
+#include <QObject>
+
+namespace ucd
+{
+
+class TestDownloadQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesPolicy();
+    void servesManualFirst();
+    void demotesOlderLatest();
+    void targetsTakeTurns();
+    void newTargetJoinsCurrentRound();
+    void ordersByPolicy();
+    void removesBuilds();
+};
+
+}
+
+#endif // UCD_TST_DOWNLOADQUEUE_H
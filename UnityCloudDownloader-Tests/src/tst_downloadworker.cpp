@@ -0,0 +1,323 @@
+#include "tst_downloadworker.h"
+
+#include "bandwidthlimiter.h"
+#include "build.h"
+#include "buildtarget.h"
+#include "buildtargetdao.h"
+#include "database.h"
+#include "downloadsdao.h"
+#include "downloadworker.h"
+#include "httpstandin.h"
+#include "profile.h"
+#include "profiledao.h"
+#include "project.h"
+#include "projectdao.h"
+#include "servicelocator.h"
+#include "testarchive.h"
+#include "zipstreamextractor.h"
+
+#include <QCryptographicHash>
+#include <QEventLoop>
+#include <QThread>
+#include <QTimer>
+#include <QtTest>
+
+#include <memory>
+#include <vector>
+
+namespace ucd
+{
+
+enum
+{
+    ArtifactSize = 64 * 1024 * 1024,
+    ConnectionCap = 8 * 1024 * 1024, // bytes per second and connection
+    ProgressInterval = 300, // as requested by the synchronizer
+    WorkerCount = 4,
+    DeltaFileCount = 40,
+    DeltaChangedCount = 4, // a tenth of the files change between consecutive builds
+    EntrySize = 1024 * 1024,
+    DownloadTimeout = 5 * 60 * 1000,
+};
+
+static const QUuid s_profileId(QStringLiteral("{3c7e1a9d-6b2f-4d8e-9a1c-5e4f7b2d8c01}"));
+static const QUuid s_projectId(QStringLiteral("{3c7e1a9d-6b2f-4d8e-9a1c-5e4f7b2d8c02}"));
+static const QUuid s_buildTargetId(QStringLiteral("{3c7e1a9d-6b2f-4d8e-9a1c-5e4f7b2d8c03}"));
+
+// bytes that don't repeat within a segment, so a misplaced write changes the digest
+static QByteArray makeArtifact(qint64 size, quint32 seed)
+{
+    QByteArray artifact(static_cast<int>(size), Qt::Uninitialized);
+    quint32 state = seed;
+    for (int i = 0; i < artifact.size(); ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        artifact[i] = static_cast<char>(state >> 24);
+    }
+    return artifact;
+}
+
+static Build makeBuild(int id, const QUrl &url, const QString &artifactName, const QByteArray &artifact)
+{
+    Build build;
+    build.setId(id);
+    build.setBuildTargetId(s_buildTargetId);
+    build.setStatus(Build::Success);
+    build.setArtifactName(artifactName);
+    build.setArtifactSize(artifact.size());
+    build.setArtifactPath(url.toString());
+    build.setArtifactMd5(QString::fromLatin1(QCryptographicHash::hash(artifact, QCryptographicHash::Md5).toHex()));
+    return build;
+}
+
+/**
+ * @brief Download the builds, one per worker, and wait until every download ends.
+ *
+ * The progress is requested periodically like the synchronizer does, it is
+ * what makes a worker adapt its segments.
+ * @return true if every download completed.
+ */
+static bool runDownloads(const QVector<DownloadWorker*> &workers, const QVector<Build> &builds)
+{
+    int completed = 0;
+    int ended = 0;
+    QEventLoop loop;
+    for (auto *worker : workers)
+    {
+        QObject::connect(worker, &DownloadWorker::downloadCompleted, &loop, [&]()
+        {
+            ++completed;
+            if (++ended == builds.size())
+                loop.quit();
+        });
+        QObject::connect(worker, &DownloadWorker::downloadFailed, &loop, [&]()
+        {
+            if (++ended == builds.size())
+                loop.quit();
+        });
+    }
+
+    QTimer progress;
+    progress.setInterval(ProgressInterval);
+    QObject::connect(&progress, &QTimer::timeout, &loop, [&workers]()
+    {
+        for (auto *worker : workers)
+            worker->requestProgress();
+    });
+    QTimer::singleShot(DownloadTimeout, &loop, &QEventLoop::quit);
+
+    for (int i = 0; i < builds.size(); ++i)
+        workers.at(i)->download(builds.at(i));
+    progress.start();
+    loop.exec();
+    return completed == builds.size();
+}
+
+TestDownloadWorker::TestDownloadWorker() = default;
+
+TestDownloadWorker::~TestDownloadWorker() = default;
+
+void TestDownloadWorker::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_database = std::make_unique<Database>(m_dir.path());
+    m_database->init();
+    ServiceLocator::setDatabaseProvier(m_database.get());
+
+    auto database = m_database->sqlDatabase();
+    Profile profile;
+    profile.setUuid(s_profileId);
+    profile.setName(QStringLiteral("Benchmark"));
+    profile.setRootPath(QDir(m_dir.path()).filePath(QStringLiteral("builds")));
+    ProfileDao(database).addProfile(profile);
+
+    Project project;
+    project.setId(s_projectId);
+    project.setProfileId(s_profileId);
+    project.setCloudId(QStringLiteral("project"));
+    project.setName(QStringLiteral("Project"));
+    ProjectDao(database).addProject(project);
+
+    BuildTarget buildTarget;
+    buildTarget.setId(s_buildTargetId);
+    buildTarget.setProjectId(s_projectId);
+    buildTarget.setCloudId(QStringLiteral("target"));
+    buildTarget.setName(QStringLiteral("Target"));
+    BuildTargetDao(database).addBuildTarget(buildTarget);
+}
+
+void TestDownloadWorker::cleanupTestCase()
+{
+    ServiceLocator::setDatabaseProvier(nullptr);
+    m_database.reset();
+}
+
+QString TestDownloadWorker::targetPath() const
+{
+    return QDir(m_dir.path()).filePath(QStringLiteral("builds/project/target"));
+}
+
+void TestDownloadWorker::benchmarkSegmentedDownload_data()
+{
+    QTest::addColumn<bool>("rangesSupported");
+
+    QTest::newRow("single connection") << false;
+    QTest::newRow("segmented") << true;
+}
+
+void TestDownloadWorker::benchmarkSegmentedDownload()
+{
+    QFETCH(bool, rangesSupported);
+    const QByteArray artifact = makeArtifact(ArtifactSize, 1);
+
+    // each connection is capped, only more connections make the transfer faster
+    HttpStandIn standIn;
+    standIn.addResource(QStringLiteral("/game.apk"), artifact);
+    standIn.setRangesSupported(rangesSupported);
+    standIn.setBandwidthCap(ConnectionCap);
+    QVERIFY(standIn.start());
+
+    BandwidthLimiter bandwidthLimiter;
+    DownloadWorker worker(&bandwidthLimiter);
+    const Build build = makeBuild(1, standIn.url(QStringLiteral("/game.apk")), QStringLiteral("game.apk"), artifact);
+    QBENCHMARK
+    {
+        QVERIFY(QDir(targetPath()).removeRecursively());
+        standIn.resetCounters();
+        QVERIFY(runDownloads({&worker}, {build}));
+    }
+    QCOMPARE(QFileInfo(QDir(targetPath()).filePath(QStringLiteral("1/game.apk"))).size(), qint64(ArtifactSize));
+    if (rangesSupported)
+        QVERIFY(standIn.requestCount() > 1);
+}
+
+void TestDownloadWorker::benchmarkWorkerThreads_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    QTest::newRow("shared thread") << 1;
+    QTest::newRow("thread per worker") << int(WorkerCount);
+}
+
+void TestDownloadWorker::benchmarkWorkerThreads()
+{
+    QFETCH(int, threadCount);
+    // the artifacts share their bytes, the server holds a single copy
+    const QByteArray artifact = makeArtifact(ArtifactSize, 2);
+
+    // without a cap the transfers are bound by the socket reads, hashing and writes of the workers
+    HttpStandIn standIn;
+    for (int i = 1; i <= WorkerCount; ++i)
+        standIn.addResource(QStringLiteral("/%1/game.apk").arg(i), artifact);
+    QVERIFY(standIn.start());
+    QVector<Build> builds;
+    for (int i = 1; i <= WorkerCount; ++i)
+        builds.append(makeBuild(i, standIn.url(QStringLiteral("/%1/game.apk").arg(i)), QStringLiteral("game.apk"), artifact));
+
+    // the workers are spread over the threads like the synchronizer places them
+    BandwidthLimiter bandwidthLimiter;
+    std::vector<std::unique_ptr<QThread>> threads;
+    QVector<DownloadWorker*> workers;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.push_back(std::make_unique<QThread>());
+        threads.back()->start();
+    }
+    for (int i = 0; i < WorkerCount; ++i)
+    {
+        auto *worker = new DownloadWorker(&bandwidthLimiter);
+        QThread *thread = threads.at(static_cast<size_t>(i % threadCount)).get();
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        workers.append(worker);
+    }
+
+    // nothing may return from the test before the threads are joined
+    bool completed = false;
+    QBENCHMARK
+    {
+        completed = QDir(targetPath()).removeRecursively() && runDownloads(workers, builds);
+        if (!completed)
+            break;
+    }
+
+    // the workers are deleted as their thread finishes
+    for (const auto &thread : threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+    QVERIFY(completed);
+    for (int i = 1; i <= WorkerCount; ++i)
+        QCOMPARE(QFileInfo(QDir(targetPath()).filePath(QStringLiteral("%1/game.apk").arg(i))).size(), qint64(ArtifactSize));
+}
+
+void TestDownloadWorker::benchmarkDeltaDownload_data()
+{
+    QTest::addColumn<bool>("seeded");
+
+    QTest::newRow("full download") << false;
+    QTest::newRow("delta download") << true;
+}
+
+void TestDownloadWorker::benchmarkDeltaDownload()
+{
+    QFETCH(bool, seeded);
+
+    // the entries are stored and don't compress, so the archives are large enough for a delta
+    QVector<TestEntry> entries;
+    for (int i = 0; i < DeltaFileCount; ++i)
+        entries.append({QStringLiteral("data/%1.bin").arg(i), makeArtifact(EntrySize, static_cast<quint32>(i + 1)), false, 0});
+    const QByteArray previous = makeArchive(entries);
+    for (int i = 0; i < DeltaChangedCount; ++i)
+        entries[i * (DeltaFileCount / DeltaChangedCount)].content = makeArtifact(EntrySize, static_cast<quint32>(DeltaFileCount + i + 1));
+    const QByteArray artifact = makeArchive(entries);
+
+    HttpStandIn standIn;
+    standIn.addResource(QStringLiteral("/2/game.zip"), artifact);
+    QVERIFY(standIn.start());
+    const Build build = makeBuild(2, standIn.url(QStringLiteral("/2/game.zip")), QStringLiteral("game.zip"), artifact);
+
+    // the previous build seeds the delta once it is extracted and recorded as downloaded
+    QVERIFY(QDir(targetPath()).removeRecursively());
+    auto database = m_database->sqlDatabase();
+    const BuildRef seedRef(s_buildTargetId, 1);
+    if (seeded)
+    {
+        const QString seedPath = QDir(targetPath()).filePath(QStringLiteral("1"));
+        QVERIFY(QDir().mkpath(seedPath));
+        ZipStreamExtractor extractor(seedPath);
+        QVERIFY2(extractor.write(previous.constData(), previous.size()) && extractor.finish(), qPrintable(extractor.errorString()));
+        DownloadsDao(database).addDownload(seedRef);
+    }
+    else
+    {
+        DownloadsDao(database).removeDownload(seedRef);
+    }
+
+    BandwidthLimiter bandwidthLimiter;
+    DownloadWorker worker(&bandwidthLimiter);
+    QDir buildDir(QDir(targetPath()).filePath(QStringLiteral("2")));
+    bool completed = false;
+    QBENCHMARK
+    {
+        standIn.resetCounters();
+        completed = buildDir.removeRecursively() && runDownloads({&worker}, {build});
+        if (!completed)
+            break;
+    }
+    DownloadsDao(database).removeDownload(seedRef);
+    QVERIFY(completed);
+
+    qInfo("Served %lld bytes for an artifact of %d bytes", standIn.servedBytes(), artifact.size());
+    for (const auto &entry : entries)
+    {
+        QFile file(buildDir.filePath(entry.name));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QVERIFY(file.readAll() == entry.content);
+    }
+    if (seeded)
+        QVERIFY(standIn.servedBytes() < artifact.size() / 2);
+}
+
+}
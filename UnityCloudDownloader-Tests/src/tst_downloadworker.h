@@ -0,0 +1,44 @@
+#ifndef UCD_TST_DOWNLOADWORKER_H
+#define UCD_TST_DOWNLOADWORKER_H
+
+#pragma once
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include <memory>
+
+namespace ucd
+{
+
+class Database;
+
+class TestDownloadWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestDownloadWorker();
+    ~TestDownloadWorker() override;
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkSegmentedDownload_data();
+    void benchmarkSegmentedDownload();
+    void benchmarkWorkerThreads_data();
+    void benchmarkWorkerThreads();
+    void benchmarkDeltaDownload_data();
+    void benchmarkDeltaDownload();
+
+private:
+    QString targetPath() const;
+
+    QTemporaryDir m_dir;
+    std::unique_ptr<Database> m_database;
+};
+
+}
+
+#endif // UCD_TST_DOWNLOADWORKER_H
@@ -0,0 +1,144 @@
+#include "tst_schemamigrations.h"
+
+#include "schemamigrations.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+#include <QtTest>
+
+namespace ucd
+{
+
+enum
+{
+    LatestVersion = 2,
+};
+
+static const QUuid s_profileId(QStringLiteral("{5f2d9c4a-1e7b-4c3d-8a6f-0b9e8d7c6a51}"));
+static const QUuid s_projectId(QStringLiteral("{5f2d9c4a-1e7b-4c3d-8a6f-0b9e8d7c6a52}"));
+static const QUuid s_buildTargetId(QStringLiteral("{5f2d9c4a-1e7b-4c3d-8a6f-0b9e8d7c6a53}"));
+
+static bool exec(QSqlQuery &query, const QString &statement)
+{
+    if (query.exec(statement))
+        return true;
+    qWarning("%s: %s", statement.toUtf8().data(), query.lastError().text().toUtf8().data());
+    return false;
+}
+
+/**
+ * @brief Create the tables the DAOs make, with ids stored as braced text like before the migrations.
+ */
+static bool createTables(const QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    const QString profileId = s_profileId.toString();
+    const QString projectId = s_projectId.toString();
+    const QString buildTargetId = s_buildTargetId.toString();
+    return exec(query, QStringLiteral("CREATE TABLE Profiles (profileId)"))
+            && exec(query, QStringLiteral("CREATE TABLE Projects (projectId, profileId)"))
+            && exec(query, QStringLiteral("CREATE TABLE BuildTargets (buildTargetId, projectId)"))
+            && exec(query, QStringLiteral("CREATE TABLE Builds (buildNumber, buildTargetId, PRIMARY KEY (buildNumber, buildTargetId))"))
+            && exec(query, QStringLiteral("CREATE TABLE Downloads (buildTargetId, status)"))
+            && exec(query, QStringLiteral("INSERT INTO Profiles VALUES ('%1')").arg(profileId))
+            && exec(query, QStringLiteral("INSERT INTO Projects VALUES ('%1', '%2')").arg(projectId, profileId))
+            && exec(query, QStringLiteral("INSERT INTO BuildTargets VALUES ('%1', '%2')").arg(buildTargetId, projectId))
+            && exec(query, QStringLiteral("INSERT INTO Builds VALUES (1, '%1'), (2, '%1')").arg(buildTargetId))
+            && exec(query, QStringLiteral("INSERT INTO Downloads VALUES ('%1', 0)").arg(buildTargetId));
+}
+
+static QStringList indexes(const QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    QStringList names;
+    if (exec(query, QStringLiteral("SELECT name FROM sqlite_master WHERE type = 'index' AND sql IS NOT NULL ORDER BY name")))
+    {
+        while (query.next())
+            names.append(query.value(0).toString());
+    }
+    return names;
+}
+
+static void checkBinaryId(const QSqlDatabase &database, const char *table, const char *column, const QUuid &id)
+{
+    QSqlQuery query(database);
+    QVERIFY(exec(query, QStringLiteral("SELECT typeof(%2), %2 FROM %1").arg(QLatin1String(table), QLatin1String(column))));
+    int rows = 0;
+    while (query.next())
+    {
+        QCOMPARE(query.value(0).toString(), QStringLiteral("blob"));
+        QCOMPARE(query.value(1).toByteArray(), id.toRfc4122());
+        ++rows;
+    }
+    QVERIFY(rows > 0);
+}
+
+void TestSchemaMigrations::init()
+{
+    m_connectionName = QUuid::createUuid().toString();
+    auto database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_connectionName);
+    database.setDatabaseName(QStringLiteral(":memory:"));
+    QVERIFY(database.open());
+    QVERIFY(createTables(database));
+}
+
+void TestSchemaMigrations::cleanup()
+{
+    QSqlDatabase::database(m_connectionName).close();
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+void TestSchemaMigrations::migratesToLatest()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    QCOMPARE(schemaVersion(database), 0);
+
+    migrateSchema(database);
+    QCOMPARE(schemaVersion(database), int(LatestVersion));
+    QCOMPARE(indexes(database), (QStringList{
+                 QStringLiteral("BuildTargetsByProject"), QStringLiteral("BuildsByTarget"),
+                 QStringLiteral("DownloadsByStatus"), QStringLiteral("ProjectsByProfile")}));
+
+    checkBinaryId(database, "Profiles", "profileId", s_profileId);
+    checkBinaryId(database, "Projects", "projectId", s_projectId);
+    checkBinaryId(database, "Projects", "profileId", s_profileId);
+    checkBinaryId(database, "BuildTargets", "buildTargetId", s_buildTargetId);
+    checkBinaryId(database, "BuildTargets", "projectId", s_projectId);
+    checkBinaryId(database, "Builds", "buildTargetId", s_buildTargetId);
+    checkBinaryId(database, "Downloads", "buildTargetId", s_buildTargetId);
+}
+
+void TestSchemaMigrations::migratesOnce()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    // a text id written after the migration is left alone by the next runs
+    QSqlQuery query(database);
+    QVERIFY(exec(query, QStringLiteral("INSERT INTO Profiles VALUES ('late')")));
+    migrateSchema(database);
+    QCOMPARE(schemaVersion(database), int(LatestVersion));
+
+    QVERIFY(exec(query, QStringLiteral("SELECT COUNT(*) FROM Profiles WHERE profileId = 'late'")));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 1);
+    query.finish();
+    checkBinaryId(database, "Builds", "buildTargetId", s_buildTargetId);
+}
+
+void TestSchemaMigrations::keepsNewerSchema()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    QSqlQuery query(database);
+    QVERIFY(exec(query, QStringLiteral("PRAGMA user_version = %1").arg(LatestVersion + 1)));
+
+    QTest::ignoreMessage(QtWarningMsg, qPrintable(QStringLiteral("The database schema (version %1) is newer than this application (version %2)")
+                                                  .arg(LatestVersion + 1).arg(LatestVersion)));
+    migrateSchema(database);
+    QCOMPARE(schemaVersion(database), LatestVersion + 1);
+    QVERIFY(indexes(database).isEmpty());
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef UCD_TST_SCHEMAMIGRATIONS_H
+#define UCD_TST_SCHEMAMIGRATIONS_H
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+namespace ucd
+{
+
+class TestSchemaMigrations : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void migratesToLatest();
+    void migratesOnce();
+    void keepsNewerSchema();
+
+private:
+    QString m_connectionName;
+};
+
+}
+
+#endif // UCD_TST_SCHEMAMIGRATIONS_H
@@ -0,0 +1,241 @@
+#include "tst_syntheticdatabase.h"
+
+#include "build.h"
+#include "builddao.h"
+#include "buildtarget.h"
+#include "buildtargetdao.h"
+#include "cachedquery.h"
+#include "downloadsdao.h"
+#include "profiledao.h"
+#include "project.h"
+#include "projectdao.h"
+#include "schemamigrations.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QUuid>
+#include <QtTest>
+
+namespace ucd
+{
+
+enum
+{
+    ProfileCount = 100, // with one project each
+    TargetCount = 50, // per project
+    BuildCount = 1000, // per target
+    DownloadCount = 10, // latest builds of a target with a download row, the oldest one failed
+    DownloadedStatus = 1, // DownloadsDao::Downloaded
+    FailedStatus = 2, // DownloadsDao::Failed
+};
+
+enum class Kind : ushort
+{
+    Profile = 1,
+    Project,
+    BuildTarget,
+};
+
+// ids are derived from their position so the benchmarks can look them up
+static QUuid makeId(Kind kind, int profile, int target = 0)
+{
+    return QUuid(uint(profile), ushort(target), ushort(0x4000 | int(kind)), 0x80, 0, 0, 0, 0, 0, 0, 0);
+}
+
+// ids are stored as braced text like in a database created before the migrations
+static QString textId(Kind kind, int profile, int target = 0)
+{
+    return makeId(kind, profile, target).toString();
+}
+
+static bool exec(QSqlQuery &query)
+{
+    if (query.exec())
+        return true;
+    qWarning("%s: %s", query.lastQuery().toUtf8().data(), query.lastError().text().toUtf8().data());
+    return false;
+}
+
+static bool fill(const QSqlDatabase &database)
+{
+    QSqlQuery profile(database);
+    profile.prepare("INSERT INTO Profiles (profileId, name, rootPath) VALUES (:profileId, :name, :rootPath)");
+    QSqlQuery project(database);
+    project.prepare("INSERT INTO Projects (projectId, profileId, cloudId, name) VALUES (:projectId, :profileId, :cloudId, :name)");
+    QSqlQuery buildTarget(database);
+    buildTarget.prepare("INSERT INTO BuildTargets (buildTargetId, projectId, cloudId, name, platform, sync) "
+                        "VALUES (:buildTargetId, :projectId, :cloudId, :name, :platform, 1)");
+    QSqlQuery build(database);
+    build.prepare("INSERT INTO Builds (buildNumber, buildTargetId, status, name, createTime, artifactName, artifactSize) "
+                  "VALUES (:buildNumber, :buildTargetId, :status, :name, :createTime, :artifactName, :artifactSize)");
+    QSqlQuery download(database);
+    download.prepare("INSERT INTO Downloads (buildTargetId, buildNumber, status) VALUES (:buildTargetId, :buildNumber, :status)");
+
+    const QDateTime createTime(QDate(2019, 3, 1), QTime(10, 20, 30), Qt::UTC);
+    for (int p = 1; p <= ProfileCount; ++p)
+    {
+        const QString profileId = textId(Kind::Profile, p);
+        const QString projectId = textId(Kind::Project, p);
+        profile.bindValue(":profileId", profileId);
+        profile.bindValue(":name", QStringLiteral("Profile %1").arg(p));
+        profile.bindValue(":rootPath", QStringLiteral("/builds/%1").arg(p));
+        project.bindValue(":projectId", projectId);
+        project.bindValue(":profileId", profileId);
+        project.bindValue(":cloudId", QStringLiteral("project-%1").arg(p));
+        project.bindValue(":name", QStringLiteral("Project %1").arg(p));
+        if (!exec(profile) || !exec(project))
+            return false;
+
+        for (int t = 1; t <= TargetCount; ++t)
+        {
+            const QString buildTargetId = textId(Kind::BuildTarget, p, t);
+            buildTarget.bindValue(":buildTargetId", buildTargetId);
+            buildTarget.bindValue(":projectId", projectId);
+            buildTarget.bindValue(":cloudId", QStringLiteral("target-%1").arg(t));
+            buildTarget.bindValue(":name", QStringLiteral("Target %1").arg(t));
+            buildTarget.bindValue(":platform", QStringLiteral("android"));
+            if (!exec(buildTarget))
+                return false;
+
+            for (int b = 1; b <= BuildCount; ++b)
+            {
+                build.bindValue(":buildNumber", b);
+                build.bindValue(":buildTargetId", buildTargetId);
+                build.bindValue(":status", int(Build::Success));
+                build.bindValue(":name", QStringLiteral("Target %1").arg(t));
+                build.bindValue(":createTime", createTime.addSecs(b * 3600));
+                build.bindValue(":artifactName", QStringLiteral("game.apk"));
+                build.bindValue(":artifactSize", Q_INT64_C(123456789));
+                if (!exec(build))
+                    return false;
+            }
+
+            for (int b = BuildCount - DownloadCount + 1; b <= BuildCount; ++b)
+            {
+                download.bindValue(":buildTargetId", buildTargetId);
+                download.bindValue(":buildNumber", b);
+                download.bindValue(":status", b == BuildCount - DownloadCount + 1 ? int(FailedStatus) : int(DownloadedStatus));
+                if (!exec(download))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void TestSyntheticDatabase::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_connectionName = QUuid::createUuid().toString();
+    auto database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_connectionName);
+    database.setDatabaseName(m_dir.filePath(QStringLiteral("data.sqlite")));
+    QVERIFY(database.open());
+
+    ProfileDao(database).init();
+    ProjectDao(database).init();
+    BuildTargetDao(database).init();
+    BuildDao(database).init();
+    DownloadsDao(database).init();
+
+    QVERIFY(database.transaction());
+    QVERIFY(fill(database));
+    QVERIFY(database.commit());
+}
+
+void TestSyntheticDatabase::cleanupTestCase()
+{
+    CachedQuery::clear(m_connectionName);
+    QSqlDatabase::database(m_connectionName).close();
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+void TestSyntheticDatabase::benchmarkMigration()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    QCOMPARE(schemaVersion(database), 0);
+
+    // the migration only runs once, it takes the ids to binary and indexes the lookups
+    QBENCHMARK_ONCE
+    {
+        migrateSchema(database);
+    }
+    QVERIFY(schemaVersion(database) > 0);
+}
+
+void TestSyntheticDatabase::benchmarkProjectsOfProfile()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    int profile = 0;
+    QVector<Project> projects;
+    QBENCHMARK
+    {
+        profile = profile % ProfileCount + 1;
+        projects = ProjectDao(database).projects(makeId(Kind::Profile, profile));
+    }
+    QCOMPARE(projects.size(), 1);
+}
+
+void TestSyntheticDatabase::benchmarkTargetsOfProject()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    int profile = 0;
+    QVector<BuildTarget> buildTargets;
+    QBENCHMARK
+    {
+        profile = profile % ProfileCount + 1;
+        buildTargets = BuildTargetDao(database).buildTargets(makeId(Kind::Project, profile));
+    }
+    QCOMPARE(buildTargets.size(), int(TargetCount));
+}
+
+void TestSyntheticDatabase::benchmarkBuildsOfTarget()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    int target = 0;
+    QVector<Build> builds;
+    QBENCHMARK
+    {
+        target = target % (ProfileCount * TargetCount);
+        builds = BuildDao(database).builds(makeId(Kind::BuildTarget, target / TargetCount + 1, target % TargetCount + 1));
+        ++target;
+    }
+    QCOMPARE(builds.size(), int(BuildCount));
+}
+
+void TestSyntheticDatabase::benchmarkSettledBuildNumber()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    int target = 0;
+    int settled = 0;
+    QBENCHMARK
+    {
+        target = target % (ProfileCount * TargetCount);
+        settled = BuildDao(database).settledBuildNumber(makeId(Kind::BuildTarget, target / TargetCount + 1, target % TargetCount + 1));
+        ++target;
+    }
+    QCOMPARE(settled, int(BuildCount));
+}
+
+void TestSyntheticDatabase::benchmarkDownloadedBuilds()
+{
+    auto database = QSqlDatabase::database(m_connectionName);
+    migrateSchema(database);
+
+    QVector<BuildRef> builds;
+    QBENCHMARK
+    {
+        builds = DownloadsDao(database).downloadedBuilds();
+    }
+    QCOMPARE(builds.size(), ProfileCount * TargetCount * (DownloadCount - 1));
+}
+
+}
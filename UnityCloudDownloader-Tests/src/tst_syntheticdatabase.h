@@ -0,0 +1,35 @@
+#ifndef UCD_TST_SYNTHETICDATABASE_H
+#define UCD_TST_SYNTHETICDATABASE_H
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+
+namespace ucd
+{
+
+class TestSyntheticDatabase : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkMigration();
+    void benchmarkProjectsOfProfile();
+    void benchmarkTargetsOfProject();
+    void benchmarkBuildsOfTarget();
+    void benchmarkSettledBuildNumber();
+    void benchmarkDownloadedBuilds();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_connectionName;
+};
+
+}
+
+#endif // UCD_TST_SYNTHETICDATABASE_H
@@ -0,0 +1,350 @@
+#include "tst_zip.h"
+
+#include "archiveextractor.h"
+#include "contentstore.h"
+#include "filesystem.h"
+#include "testarchive.h"
+#include "ziparchive.h"
+#include "zipformat.h"
+#include "zipstreamextractor.h"
+
+#include <algorithm>
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace ucd
+{
+
+namespace
+{
+
+enum
+{
+    ChunkSize = 7,
+    ReadSize = 64 * 1024, // bytes a download hands over at once
+    BenchmarkFileCount = 32,
+    ExtractionTimeout = 60 * 1000,
+    RegularMode = 0100644,
+    ExecutableMode = 0100755,
+    LinkMode = 0120777,
+};
+
+QByteArray largeContent()
+{
+    // larger than the inflate output buffers, so they fill up more than once
+    QByteArray content;
+    for (int i = 0; content.size() < 1024 * 1024; ++i)
+        content += QByteArray::number(i) + ' ';
+    return content;
+}
+
+QVector<TestEntry> sampleEntries()
+{
+    return {
+        {QStringLiteral("folder/"), QByteArray(), false, 0},
+        {QStringLiteral("folder/readme.txt"), QByteArrayLiteral("hello archive"), false, RegularMode},
+        {QStringLiteral("folder/data.bin"), largeContent(), true, 0},
+        {QStringLiteral("run.sh"), QByteArrayLiteral("#!/bin/sh\necho run\n"), true, ExecutableMode},
+        {QStringLiteral("link"), QByteArrayLiteral("folder/readme.txt"), false, LinkMode},
+    };
+}
+
+QVector<TestEntry> benchmarkEntries()
+{
+    const QByteArray content = largeContent();
+    QVector<TestEntry> entries;
+    for (int i = 0; i < BenchmarkFileCount; ++i)
+        entries.append({QStringLiteral("data/%1.bin").arg(i), QByteArray::number(i) + content, true, 0});
+    return entries;
+}
+
+bool stream(ZipStreamExtractor &extractor, const QByteArray &archive)
+{
+    for (int i = 0; i < archive.size(); i += ChunkSize)
+    {
+        if (!extractor.write(archive.constData() + i, std::min<int>(ChunkSize, archive.size() - i)))
+            return false;
+    }
+    return extractor.finish();
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void checkSample(const QString &destinationPath)
+{
+    QDir destination(destinationPath);
+    QVERIFY(QFileInfo(destination.filePath(QStringLiteral("folder"))).isDir());
+    QCOMPARE(readFile(destination.filePath(QStringLiteral("folder/readme.txt"))), QByteArrayLiteral("hello archive"));
+    QCOMPARE(readFile(destination.filePath(QStringLiteral("folder/data.bin"))), largeContent());
+    QCOMPARE(readFile(destination.filePath(QStringLiteral("run.sh"))), QByteArrayLiteral("#!/bin/sh\necho run\n"));
+
+#ifndef Q_OS_WIN
+    QVERIFY(QFileInfo(destination.filePath(QStringLiteral("run.sh"))).permissions() & QFileDevice::ExeOwner);
+    QVERIFY(!(QFileInfo(destination.filePath(QStringLiteral("folder/readme.txt"))).permissions() & QFileDevice::ExeOwner));
+
+    const QFileInfo link(destination.filePath(QStringLiteral("link")));
+    QVERIFY(link.isSymLink());
+    QCOMPARE(link.canonicalFilePath(), QFileInfo(destination.filePath(QStringLiteral("folder/readme.txt"))).canonicalFilePath());
+#endif
+}
+
+QString writeArchive(const QTemporaryDir &dir, const QByteArray &archive)
+{
+    const QString path = QDir(dir.path()).filePath(QStringLiteral("archive.zip"));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(archive) != archive.size())
+        return QString();
+    return path;
+}
+
+}
+
+void TestZip::streamsArchive()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipStreamExtractor extractor(dir.path());
+    QVERIFY2(stream(extractor, makeArchive(sampleEntries())), qPrintable(extractor.errorString()));
+    QCOMPARE(extractor.entryCount(), 5);
+    checkSample(dir.path());
+}
+
+void TestZip::streamRejectsUnsafePath()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString destinationPath = QDir(dir.path()).filePath(QStringLiteral("build"));
+    QVERIFY(QDir().mkpath(destinationPath));
+
+    ZipStreamExtractor extractor(destinationPath);
+    QVERIFY(!stream(extractor, makeArchive({{QStringLiteral("../evil.txt"), QByteArrayLiteral("evil"), false, 0}})));
+    QVERIFY(extractor.errorString().startsWith(QStringLiteral("Unsafe entry path")));
+    QVERIFY(!QFileInfo::exists(QDir(dir.path()).filePath(QStringLiteral("evil.txt"))));
+}
+
+void TestZip::streamRejectsUnsafeLink()
+{
+#ifdef Q_OS_WIN
+    QSKIP("Links are extracted as regular files on Windows");
+#else
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZipStreamExtractor extractor(dir.path());
+    QVERIFY(!stream(extractor, makeArchive({{QStringLiteral("link"), QByteArrayLiteral("../outside"), false, LinkMode}})));
+    QVERIFY(extractor.errorString().startsWith(QStringLiteral("Unsafe link")));
+    QVERIFY(!QFileInfo(QDir(dir.path()).filePath(QStringLiteral("link"))).isSymLink());
+#endif
+}
+
+void TestZip::streamDetectsCorruption()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QByteArray archive = makeArchive(sampleEntries());
+    archive[archive.indexOf("hello archive")] = 'j';
+
+    ZipStreamExtractor extractor(dir.path());
+    QVERIFY(!stream(extractor, archive));
+    QCOMPARE(extractor.errorString(), QStringLiteral("Entry folder/readme.txt is corrupted"));
+}
+
+void TestZip::extractsArchive()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString archivePath = writeArchive(dir, makeArchive(sampleEntries()));
+    QVERIFY(!archivePath.isEmpty());
+    const QString destinationPath = QDir(dir.path()).filePath(QStringLiteral("build"));
+
+    ZipArchive archive(archivePath);
+    QVERIFY2(archive.open(), qPrintable(archive.errorString()));
+    QCOMPARE(archive.entries().size(), 5);
+    QCOMPARE(archive.entries().at(3).unixMode, quint32(ExecutableMode));
+    QVERIFY(zip::isSymLink(archive.entries().at(4).unixMode));
+
+    QDir destination(destinationPath);
+    for (const auto &entry : archive.entries())
+    {
+        if (entry.isDirectory())
+        {
+            QVERIFY(destination.mkpath(entry.path));
+            continue;
+        }
+        QVERIFY(destination.mkpath(QFileInfo(destination.filePath(entry.path)).path()));
+        const QString error = archive.extract(entry, destinationPath);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+    }
+    for (const auto &entry : archive.entries())
+    {
+        const QString error = ZipArchive::linkEntry(entry, destinationPath);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+    }
+    checkSample(destinationPath);
+}
+
+void TestZip::archiveRejectsUnsafePath()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString archivePath = writeArchive(dir, makeArchive({
+        {QStringLiteral("safe.txt"), QByteArrayLiteral("safe"), false, 0},
+        {QStringLiteral("folder/../../evil.txt"), QByteArrayLiteral("evil"), false, 0},
+    }));
+    QVERIFY(!archivePath.isEmpty());
+
+    ZipArchive archive(archivePath);
+    QVERIFY(!archive.open());
+    QVERIFY(archive.errorString().startsWith(QStringLiteral("Unsafe entry path folder/../../evil.txt")));
+    QVERIFY(archive.entries().isEmpty());
+}
+
+void TestZip::archiveDetectsCorruption()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QByteArray bytes = makeArchive(sampleEntries());
+    bytes[bytes.indexOf("hello archive")] = 'j';
+    const QString archivePath = writeArchive(dir, bytes);
+    QVERIFY(!archivePath.isEmpty());
+
+    ZipArchive archive(archivePath);
+    QVERIFY2(archive.open(), qPrintable(archive.errorString()));
+    QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("folder")));
+    QCOMPARE(archive.extract(archive.entries().at(1), dir.path()), QStringLiteral("Entry folder/readme.txt is corrupted"));
+
+    // entries are extracted independently, the others are intact
+    QVERIFY(archive.extract(archive.entries().at(3), dir.path()).isEmpty());
+    QCOMPARE(readFile(QDir(dir.path()).filePath(QStringLiteral("run.sh"))), QByteArrayLiteral("#!/bin/sh\necho run\n"));
+}
+
+void TestZip::replacesLinkedFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QDir root(dir.path());
+    const QString sharedPath = root.filePath(QStringLiteral("shared.txt"));
+    {
+        QFile shared(sharedPath);
+        QVERIFY(shared.open(QIODevice::WriteOnly));
+        QVERIFY(shared.write("shared content") > 0);
+    }
+
+    // a file of a previous extraction that shares its inode with the store and other builds
+    const auto linkInto = [&](const QString &destinationPath) -> bool
+    {
+        return QDir().mkpath(QDir(destinationPath).filePath(QStringLiteral("folder")))
+                && createHardLink(sharedPath, QDir(destinationPath).filePath(QStringLiteral("folder/readme.txt")));
+    };
+
+    const QString streamedPath = root.filePath(QStringLiteral("streamed"));
+    QVERIFY(linkInto(streamedPath));
+    ZipStreamExtractor extractor(streamedPath);
+    QVERIFY2(stream(extractor, makeArchive(sampleEntries())), qPrintable(extractor.errorString()));
+    QCOMPARE(readFile(QDir(streamedPath).filePath(QStringLiteral("folder/readme.txt"))), QByteArrayLiteral("hello archive"));
+    QCOMPARE(readFile(sharedPath), QByteArrayLiteral("shared content"));
+
+    const QString archivePath = writeArchive(dir, makeArchive(sampleEntries()));
+    QVERIFY(!archivePath.isEmpty());
+    ZipArchive archive(archivePath);
+    QVERIFY2(archive.open(), qPrintable(archive.errorString()));
+    const QString extractedPath = root.filePath(QStringLiteral("extracted"));
+    QVERIFY(linkInto(extractedPath));
+    const QString error = archive.extract(archive.entries().at(1), extractedPath);
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QCOMPARE(readFile(QDir(extractedPath).filePath(QStringLiteral("folder/readme.txt"))), QByteArrayLiteral("hello archive"));
+    QCOMPARE(readFile(sharedPath), QByteArrayLiteral("shared content"));
+}
+
+void TestZip::keepsModesOutOfSharedBlobs()
+{
+#ifdef Q_OS_WIN
+    QSKIP("Unix modes are not applied on Windows");
+#else
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QDir root(dir.path());
+    const ContentStore store(dir.path());
+    const QByteArray script = QByteArrayLiteral("#!/bin/sh\necho run\n");
+
+    // the same content is a plain file in one build and an executable in the next
+    const auto extractScript = [&](const QString &build, quint32 mode) -> bool
+    {
+        ZipStreamExtractor extractor(root.filePath(build), store);
+        return stream(extractor, makeArchive({{QStringLiteral("run.sh"), script, true, mode}}));
+    };
+    QVERIFY(extractScript(QStringLiteral("1"), RegularMode));
+    QVERIFY(extractScript(QStringLiteral("2"), ExecutableMode));
+    QVERIFY(extractScript(QStringLiteral("3"), RegularMode));
+
+    const QString first = root.filePath(QStringLiteral("1/run.sh"));
+    const QString second = root.filePath(QStringLiteral("2/run.sh"));
+    const QString third = root.filePath(QStringLiteral("3/run.sh"));
+    QVERIFY(!(QFile::permissions(first) & QFileDevice::ExeOwner));
+    QVERIFY(QFile::permissions(second) & QFileDevice::ExeOwner);
+    QVERIFY(!(QFile::permissions(third) & QFileDevice::ExeOwner));
+    QCOMPARE(readFile(second), script);
+
+    // builds with the same mode still share the blob
+    QCOMPARE(hardLinkCount(first), 3);
+    QCOMPARE(hardLinkCount(second), 2);
+#endif
+}
+
+void TestZip::benchmarkExtraction_data()
+{
+    QTest::addColumn<bool>("streaming");
+
+    QTest::newRow("download then extract") << false;
+    QTest::newRow("streaming") << true;
+}
+
+void TestZip::benchmarkExtraction()
+{
+    QFETCH(bool, streaming);
+    const QByteArray archive = makeArchive(benchmarkEntries());
+
+    // the download is the archive written in reads, the extraction either follows it or is fed the same reads
+    QBENCHMARK
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString archivePath = QDir(dir.path()).filePath(QStringLiteral("archive.zip"));
+        const QString destinationPath = QDir(dir.path()).filePath(QStringLiteral("build"));
+        QVERIFY(QDir().mkpath(destinationPath));
+
+        QFile file(archivePath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        ZipStreamExtractor extractor(destinationPath);
+        for (int i = 0; i < archive.size(); i += ReadSize)
+        {
+            const int size = std::min<int>(ReadSize, archive.size() - i);
+            QCOMPARE(file.write(archive.constData() + i, size), qint64(size));
+            if (streaming)
+                QVERIFY2(extractor.write(archive.constData() + i, size), qPrintable(extractor.errorString()));
+        }
+        file.close();
+
+        if (streaming)
+        {
+            QVERIFY2(extractor.finish(), qPrintable(extractor.errorString()));
+        }
+        else
+        {
+            ArchiveExtractor archiveExtractor(archivePath, destinationPath, ContentStore());
+            QSignalSpy finished(&archiveExtractor, &ArchiveExtractor::finished);
+            archiveExtractor.start();
+            QVERIFY(finished.wait(ExtractionTimeout));
+            QVERIFY(finished.first().first().toBool());
+        }
+    }
+}
+
+}
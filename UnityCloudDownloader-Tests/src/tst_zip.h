@@ -0,0 +1,32 @@
+#ifndef UCD_TST_ZIP_H
+#define UCD_TST_ZIP_H
+
+#pragma once
+
+#include <QObject>
+
+namespace ucd
+{
+
+class TestZip : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void streamsArchive();
+    void streamRejectsUnsafePath();
+    void streamRejectsUnsafeLink();
+    void streamDetectsCorruption();
+    void extractsArchive();
+    void archiveRejectsUnsafePath();
+    void archiveDetectsCorruption();
+    void replacesLinkedFiles();
+    void keepsModesOutOfSharedBlobs();
+
+    void benchmarkExtraction_data();
+    void benchmarkExtraction();
+};
+
+}
+
+#endif // UCD_TST_ZIP_H
@@ -2,7 +2,8 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     UnityCloudDownloader-Core \
-    UnityCloudDownloader-Desktop
+    UnityCloudDownloader-Desktop \
+    UnityCloudDownloader-Tests
 
 UnityCloudDownloader-Desktop.depends = UnityCloudDownloader-Core
 